@@ -3,7 +3,7 @@
 cls
 
 set SourceFiles=..\src\Win32Platform.cpp ..\external\imgui\imgui_impl.cpp
-set CompilerFlags= -nologo -Gm- -GR- -Oi -EHa- -W4 -wd4201 -wd4100 -wd4996 -wd4063 -FC -Z7 -I ..\external\ -DIS_MSVC=1 -DTARGET_WINDOWS -std:c++20 -arch:AVX2
+set CompilerFlags= -nologo -Gm- -GR- -Oi -EHa- -W4 -wd4201 -wd4100 -wd4996 -wd4063 -FC -Z7 -I ..\external\ -DIS_MSVC=1 -DTARGET_WINDOWS -std:c++20 -arch:AVX2 -fp:precise
 set LinkerFlags=-opt:ref -incremental:no -debug:full
 set Libraries=user32.lib winmm.lib shell32.lib opengl32.lib gdi32.lib
 
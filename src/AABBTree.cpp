@@ -0,0 +1,423 @@
+inline AABB AABBUnion(AABB a, AABB b)
+{
+	AABB result;
+	result.min = { Min(a.min.x, b.min.x), Min(a.min.y, b.min.y), Min(a.min.z, b.min.z) };
+	result.max = { Max(a.max.x, b.max.x), Max(a.max.y, b.max.y), Max(a.max.z, b.max.z) };
+	return result;
+}
+
+inline f32 AABBSurfaceArea(AABB aabb)
+{
+	v3 size = aabb.max - aabb.min;
+	return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+inline bool AABBContains(AABB outer, AABB inner)
+{
+	return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+		outer.max.x >= inner.max.x && outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+}
+
+inline bool AABBOverlap(AABB a, AABB b)
+{
+	return a.min.x <= b.max.x && b.min.x <= a.max.x &&
+		a.min.y <= b.max.y && b.min.y <= a.max.y &&
+		a.min.z <= b.max.z && b.min.z <= a.max.z;
+}
+
+void AABBTreeInit(AABBTree *tree, u32 capacity)
+{
+	ArrayInit(&tree->nodes, capacity);
+	tree->root = AABB_TREE_NULL;
+	tree->freeList = AABB_TREE_NULL;
+	memset(tree->entityLeaves, 0xFF, sizeof(tree->entityLeaves));
+}
+
+inline bool AABBTreeIsLeaf(const AABBTreeNode *node)
+{
+	return node->children[0] == AABB_TREE_NULL;
+}
+
+u32 AABBTreeAllocateNode(AABBTree *tree)
+{
+	u32 nodeIdx;
+	if (tree->freeList != AABB_TREE_NULL)
+	{
+		nodeIdx = tree->freeList;
+		tree->freeList = tree->nodes[nodeIdx].next;
+	}
+	else
+	{
+		nodeIdx = tree->nodes.count;
+		ArrayAdd(&tree->nodes);
+	}
+
+	AABBTreeNode *node = &tree->nodes[nodeIdx];
+	node->parent = AABB_TREE_NULL;
+	node->children[0] = AABB_TREE_NULL;
+	node->children[1] = AABB_TREE_NULL;
+	node->entityId = ENTITY_ID_INVALID;
+	node->height = 0;
+	return nodeIdx;
+}
+
+void AABBTreeFreeNode(AABBTree *tree, u32 nodeIdx)
+{
+	AABBTreeNode *node = &tree->nodes[nodeIdx];
+	node->next = tree->freeList;
+	node->height = -1;
+	tree->freeList = nodeIdx;
+}
+
+// Refresh box and height of an internal node from its children.
+inline void AABBTreeRecompute(AABBTree *tree, u32 nodeIdx)
+{
+	AABBTreeNode *node = &tree->nodes[nodeIdx];
+	const AABBTreeNode *child0 = &tree->nodes[node->children[0]];
+	const AABBTreeNode *child1 = &tree->nodes[node->children[1]];
+	node->aabb = AABBUnion(child0->aabb, child1->aabb);
+	node->height = 1 + Max(child0->height, child1->height);
+}
+
+// If one child of the node is two or more levels taller than the other, rotate it up to take the
+// node's place. Returns the index of the node now at this position.
+u32 AABBTreeBalance(AABBTree *tree, u32 nodeIdx)
+{
+	AABBTreeNode *node = &tree->nodes[nodeIdx];
+	if (AABBTreeIsLeaf(node) || node->height < 2)
+		return nodeIdx;
+
+	s32 balance = tree->nodes[node->children[1]].height - tree->nodes[node->children[0]].height;
+	if (balance >= -1 && balance <= 1)
+		return nodeIdx;
+
+	int tallSide = balance > 0 ? 1 : 0;
+	u32 tallIdx = node->children[tallSide];
+	AABBTreeNode *tall = &tree->nodes[tallIdx];
+
+	// Tall child takes the node's place
+	tall->parent = node->parent;
+	if (tall->parent != AABB_TREE_NULL)
+	{
+		AABBTreeNode *parent = &tree->nodes[tall->parent];
+		if (parent->children[0] == nodeIdx)
+			parent->children[0] = tallIdx;
+		else
+			parent->children[1] = tallIdx;
+	}
+	else
+		tree->root = tallIdx;
+
+	// Keep the taller grandchild up with the tall child, hand the other one down to the node.
+	u32 grandchild0 = tall->children[0];
+	u32 grandchild1 = tall->children[1];
+	u32 keepIdx = grandchild0, giveIdx = grandchild1;
+	if (tree->nodes[grandchild1].height > tree->nodes[grandchild0].height)
+	{
+		keepIdx = grandchild1;
+		giveIdx = grandchild0;
+	}
+
+	tall->children[0] = nodeIdx;
+	tall->children[1] = keepIdx;
+	node->parent = tallIdx;
+	node->children[tallSide] = giveIdx;
+	tree->nodes[giveIdx].parent = nodeIdx;
+
+	AABBTreeRecompute(tree, nodeIdx);
+	AABBTreeRecompute(tree, tallIdx);
+	return tallIdx;
+}
+
+void AABBTreeRefitAncestors(AABBTree *tree, u32 nodeIdx)
+{
+	while (nodeIdx != AABB_TREE_NULL)
+	{
+		AABBTreeRecompute(tree, nodeIdx);
+		nodeIdx = AABBTreeBalance(tree, nodeIdx);
+		nodeIdx = tree->nodes[nodeIdx].parent;
+	}
+}
+
+void AABBTreeInsertLeaf(AABBTree *tree, u32 leafIdx)
+{
+	if (tree->root == AABB_TREE_NULL)
+	{
+		tree->root = leafIdx;
+		tree->nodes[leafIdx].parent = AABB_TREE_NULL;
+		return;
+	}
+
+	// Descend towards the sibling that grows the tree's surface area the least
+	const AABB leafAABB = tree->nodes[leafIdx].aabb;
+	u32 siblingIdx = tree->root;
+	while (!AABBTreeIsLeaf(&tree->nodes[siblingIdx]))
+	{
+		const AABBTreeNode *node = &tree->nodes[siblingIdx];
+		f32 area = AABBSurfaceArea(node->aabb);
+		f32 combinedArea = AABBSurfaceArea(AABBUnion(node->aabb, leafAABB));
+
+		// Cost of pairing the leaf with this node, and the growth every descendant pays on top
+		f32 cost = 2.0f * combinedArea;
+		f32 inheritanceCost = 2.0f * (combinedArea - area);
+
+		f32 childCosts[2];
+		for (int i = 0; i < 2; ++i)
+		{
+			const AABBTreeNode *child = &tree->nodes[node->children[i]];
+			f32 childCombinedArea = AABBSurfaceArea(AABBUnion(child->aabb, leafAABB));
+			if (AABBTreeIsLeaf(child))
+				childCosts[i] = childCombinedArea + inheritanceCost;
+			else
+				childCosts[i] = childCombinedArea - AABBSurfaceArea(child->aabb) + inheritanceCost;
+		}
+
+		if (cost < childCosts[0] && cost < childCosts[1])
+			break;
+
+		siblingIdx = childCosts[0] < childCosts[1] ? node->children[0] : node->children[1];
+	}
+
+	u32 oldParentIdx = tree->nodes[siblingIdx].parent;
+	u32 newParentIdx = AABBTreeAllocateNode(tree);
+	AABBTreeNode *newParent = &tree->nodes[newParentIdx];
+	newParent->parent = oldParentIdx;
+	newParent->children[0] = siblingIdx;
+	newParent->children[1] = leafIdx;
+	tree->nodes[siblingIdx].parent = newParentIdx;
+	tree->nodes[leafIdx].parent = newParentIdx;
+
+	if (oldParentIdx != AABB_TREE_NULL)
+	{
+		AABBTreeNode *oldParent = &tree->nodes[oldParentIdx];
+		if (oldParent->children[0] == siblingIdx)
+			oldParent->children[0] = newParentIdx;
+		else
+			oldParent->children[1] = newParentIdx;
+	}
+	else
+		tree->root = newParentIdx;
+
+	AABBTreeRefitAncestors(tree, newParentIdx);
+}
+
+void AABBTreeRemoveLeaf(AABBTree *tree, u32 leafIdx)
+{
+	if (tree->root == leafIdx)
+	{
+		tree->root = AABB_TREE_NULL;
+		return;
+	}
+
+	u32 parentIdx = tree->nodes[leafIdx].parent;
+	AABBTreeNode *parent = &tree->nodes[parentIdx];
+	u32 grandparentIdx = parent->parent;
+	u32 siblingIdx = parent->children[0] == leafIdx ? parent->children[1] : parent->children[0];
+
+	// Sibling takes the parent's place
+	tree->nodes[siblingIdx].parent = grandparentIdx;
+	if (grandparentIdx != AABB_TREE_NULL)
+	{
+		AABBTreeNode *grandparent = &tree->nodes[grandparentIdx];
+		if (grandparent->children[0] == parentIdx)
+			grandparent->children[0] = siblingIdx;
+		else
+			grandparent->children[1] = siblingIdx;
+	}
+	else
+		tree->root = siblingIdx;
+
+	AABBTreeFreeNode(tree, parentIdx);
+	AABBTreeRefitAncestors(tree, grandparentIdx);
+}
+
+inline AABB AABBTreeFatten(AABB aabb)
+{
+	const v3 margin = { AABB_TREE_FAT_MARGIN, AABB_TREE_FAT_MARGIN, AABB_TREE_FAT_MARGIN };
+	return { aabb.min - margin, aabb.max + margin };
+}
+
+void AABBTreeInsert(AABBTree *tree, u32 entityId, AABB aabb)
+{
+	ASSERT(tree->entityLeaves[entityId] == AABB_TREE_NULL);
+
+	u32 leafIdx = AABBTreeAllocateNode(tree);
+	AABBTreeNode *leaf = &tree->nodes[leafIdx];
+	leaf->aabb = AABBTreeFatten(aabb);
+	leaf->entityId = entityId;
+	AABBTreeInsertLeaf(tree, leafIdx);
+
+	tree->entityLeaves[entityId] = leafIdx;
+}
+
+void AABBTreeRemove(AABBTree *tree, u32 entityId)
+{
+	u32 leafIdx = tree->entityLeaves[entityId];
+	ASSERT(leafIdx != AABB_TREE_NULL);
+
+	AABBTreeRemoveLeaf(tree, leafIdx);
+	AABBTreeFreeNode(tree, leafIdx);
+
+	tree->entityLeaves[entityId] = AABB_TREE_NULL;
+}
+
+bool AABBTreeUpdate(AABBTree *tree, u32 entityId, AABB aabb)
+{
+	u32 leafIdx = tree->entityLeaves[entityId];
+	if (leafIdx == AABB_TREE_NULL)
+	{
+		AABBTreeInsert(tree, entityId, aabb);
+		return true;
+	}
+
+	if (AABBContains(tree->nodes[leafIdx].aabb, aabb))
+		return false;
+
+	AABBTreeRemoveLeaf(tree, leafIdx);
+	tree->nodes[leafIdx].aabb = AABBTreeFatten(aabb);
+	AABBTreeInsertLeaf(tree, leafIdx);
+	return true;
+}
+
+void AABBTreeQueryAABB(const AABBTree *tree, AABB aabb, DynamicArray<u32, FrameAllocator> *entityIds)
+{
+	if (tree->root == AABB_TREE_NULL)
+		return;
+
+	FixedArray<u32, 256> stack;
+	stack.count = 0;
+	*FixedArrayAdd(&stack) = tree->root;
+	while (stack.count)
+	{
+		const AABBTreeNode *node = &tree->nodes[stack[--stack.count]];
+		if (!AABBOverlap(node->aabb, aabb))
+			continue;
+
+		if (AABBTreeIsLeaf(node))
+			*DynamicArrayAdd(entityIds) = node->entityId;
+		else
+		{
+			*FixedArrayAdd(&stack) = node->children[0];
+			*FixedArrayAdd(&stack) = node->children[1];
+		}
+	}
+}
+
+inline bool RayAABBIntersection(v3 rayOrigin, v3 invRayDir, f32 maxT, AABB aabb)
+{
+	// Slab test, only forwards.
+	f32 tMin = 0;
+	f32 tMax = maxT;
+	for (int i = 0; i < 3; ++i)
+	{
+		f32 t0 = (aabb.min.v[i] - rayOrigin.v[i]) * invRayDir.v[i];
+		f32 t1 = (aabb.max.v[i] - rayOrigin.v[i]) * invRayDir.v[i];
+		tMin = Max(tMin, Min(t0, t1));
+		tMax = Min(tMax, Max(t0, t1));
+	}
+	return tMin <= tMax;
+}
+
+void AABBTreeQueryRay(const AABBTree *tree, v3 rayOrigin, v3 rayDir,
+		DynamicArray<u32, FrameAllocator> *entityIds, f32 maxT)
+{
+	if (tree->root == AABB_TREE_NULL)
+		return;
+
+	const v3 invRayDir = { 1.0f / rayDir.x, 1.0f / rayDir.y, 1.0f / rayDir.z };
+
+	FixedArray<u32, 256> stack;
+	stack.count = 0;
+	*FixedArrayAdd(&stack) = tree->root;
+	while (stack.count)
+	{
+		const AABBTreeNode *node = &tree->nodes[stack[--stack.count]];
+		if (!RayAABBIntersection(rayOrigin, invRayDir, maxT, node->aabb))
+			continue;
+
+		if (AABBTreeIsLeaf(node))
+			*DynamicArrayAdd(entityIds) = node->entityId;
+		else
+		{
+			*FixedArrayAdd(&stack) = node->children[0];
+			*FixedArrayAdd(&stack) = node->children[1];
+		}
+	}
+}
+
+void AABBTreeQueryRayPacket(const AABBTree *tree, const RayPacket *packet,
+		DynamicArray<AABBTreeRayPacketLeaf, FrameAllocator> *leaves)
+{
+	if (tree->root == AABB_TREE_NULL)
+		return;
+
+	const __m256 origin[3] = { _mm256_loadu_ps(packet->originX), _mm256_loadu_ps(packet->originY),
+		_mm256_loadu_ps(packet->originZ) };
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 invDir[3] = { _mm256_div_ps(one, _mm256_loadu_ps(packet->dirX)),
+		_mm256_div_ps(one, _mm256_loadu_ps(packet->dirY)),
+		_mm256_div_ps(one, _mm256_loadu_ps(packet->dirZ)) };
+	const __m256 maxT = _mm256_loadu_ps(packet->maxT);
+
+	FixedArray<u32, 256> stack;
+	stack.count = 0;
+	*FixedArrayAdd(&stack) = tree->root;
+	while (stack.count)
+	{
+		const AABBTreeNode *node = &tree->nodes[stack[--stack.count]];
+		int laneMask;
+		RayPacketAABBEntryAVX2(origin, invDir, maxT, node->aabb, &laneMask);
+		if (!laneMask)
+			continue;
+
+		if (AABBTreeIsLeaf(node))
+			*DynamicArrayAdd(leaves) = { node->entityId, (u32)laneMask };
+		else
+		{
+			*FixedArrayAdd(&stack) = node->children[0];
+			*FixedArrayAdd(&stack) = node->children[1];
+		}
+	}
+}
+
+AABBTreeMetrics AABBTreeGetMetrics(const AABBTree *tree)
+{
+	AABBTreeMetrics metrics = {};
+	if (tree->root == AABB_TREE_NULL)
+		return metrics;
+
+	metrics.height = tree->nodes[tree->root].height;
+
+	struct StackEntry
+	{
+		u32 nodeIdx;
+		u32 depth;
+	};
+	FixedArray<StackEntry, 256> stack;
+	stack.count = 0;
+	*FixedArrayAdd(&stack) = { tree->root, 0 };
+
+	f32 internalArea = 0;
+	u64 leafDepthSum = 0;
+	while (stack.count)
+	{
+		StackEntry entry = stack[--stack.count];
+		const AABBTreeNode *node = &tree->nodes[entry.nodeIdx];
+		if (AABBTreeIsLeaf(node))
+		{
+			++metrics.leafCount;
+			leafDepthSum += entry.depth;
+			continue;
+		}
+
+		internalArea += AABBSurfaceArea(node->aabb);
+		*FixedArrayAdd(&stack) = { node->children[0], entry.depth + 1 };
+		*FixedArrayAdd(&stack) = { node->children[1], entry.depth + 1 };
+	}
+
+	metrics.averageLeafDepth = (f32)leafDepthSum / (f32)metrics.leafCount;
+	f32 rootArea = AABBSurfaceArea(tree->nodes[tree->root].aabb);
+	if (rootArea > 0)
+		metrics.SAHCost = internalArea / rootArea;
+	return metrics;
+}
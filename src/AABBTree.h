@@ -0,0 +1,58 @@
+// Incremental bounding volume hierarchy over colliders. Leaves store enlarged ("fat") boxes so a
+// body can move a bit before its leaf needs to be reinserted.
+const u32 AABB_TREE_NULL = U32_MAX;
+const f32 AABB_TREE_FAT_MARGIN = 0.1f;
+
+struct AABBTreeNode
+{
+	AABB aabb;
+	union
+	{
+		u32 parent;
+		// Next node in the free list, when not in use.
+		u32 next;
+	};
+	u32 children[2];
+	// Only meaningful for leaves.
+	u32 entityId;
+	// Leaves have height 0, free nodes -1.
+	s32 height;
+};
+
+struct AABBTree
+{
+	Array<AABBTreeNode, TransientAllocator> nodes;
+	u32 root;
+	u32 freeList;
+	u32 entityLeaves[MAX_ENTITIES];
+};
+
+struct AABBTreeRayPacketLeaf
+{
+	u32 entityId;
+	// Rays of the packet that get into the leaf, a bit per lane.
+	u32 laneMask;
+};
+
+struct AABBTreeMetrics
+{
+	u32 leafCount;
+	u32 height;
+	f32 averageLeafDepth;
+	// Sum of internal node areas over root area, lower is better.
+	f32 SAHCost;
+};
+
+void AABBTreeInit(AABBTree *tree, u32 capacity);
+void AABBTreeInsert(AABBTree *tree, u32 entityId, AABB aabb);
+void AABBTreeRemove(AABBTree *tree, u32 entityId);
+// Returns true if the leaf had to be reinserted.
+bool AABBTreeUpdate(AABBTree *tree, u32 entityId, AABB aabb);
+void AABBTreeQueryAABB(const AABBTree *tree, AABB aabb, DynamicArray<u32, FrameAllocator> *entityIds);
+// Leaves hit by the ray between rayOrigin and rayOrigin + rayDir * maxT.
+void AABBTreeQueryRay(const AABBTree *tree, v3 rayOrigin, v3 rayDir,
+		DynamicArray<u32, FrameAllocator> *entityIds, f32 maxT = INFINITY);
+// Leaves any ray of the packet gets into before its maxT.
+void AABBTreeQueryRayPacket(const AABBTree *tree, const RayPacket *packet,
+		DynamicArray<AABBTreeRayPacketLeaf, FrameAllocator> *leaves);
+AABBTreeMetrics AABBTreeGetMetrics(const AABBTree *tree);
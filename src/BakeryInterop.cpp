@@ -4,7 +4,9 @@ template <typename T, typename Allocator>
 inline T* AllocAndCopy(u64 count, const u8 *fileBuffer, u64 offset)
 {
 	const u64 blobSize = sizeof(T) * count;
-	void *mem = Allocator::Alloc(blobSize, alignof(T));
+	// The allocators ignore alignment, round up by hand.
+	u8 *mem = (u8 *)Allocator::Alloc(blobSize + alignof(T) - 1, alignof(T));
+	mem = (u8 *)(((u64)mem + alignof(T) - 1) & ~(u64)(alignof(T) - 1));
 	memcpy(mem, fileBuffer + offset, blobSize);
 	return (T*)mem;
 }
@@ -102,9 +104,17 @@ void ReadSkinnedMesh(const u8 *fileBuffer, ResourceSkinnedMesh *skinnedMesh, Ski
 	*materialFilename = (const char *)(fileBuffer + header->materialNameOffset);
 }
 
-void ReadTriangleGeometry(const u8 *fileBuffer, ResourceGeometryGrid *geometryGrid)
+// Fails without touching geometryGrid if the file is from another version of the bakery.
+bool ReadTriangleGeometry(const u8 *fileBuffer, ResourceGeometryGrid *geometryGrid)
 {
 	BakeryTriangleDataHeader *header = (BakeryTriangleDataHeader *)fileBuffer;
+	if (header->magic != BAKERY_TRIANGLE_DATA_MAGIC || header->version != BAKERY_TRIANGLE_DATA_VERSION)
+	{
+		Log("ERROR! Level geometry file isn't version %u, it needs rebaking\n",
+				BAKERY_TRIANGLE_DATA_VERSION);
+		return false;
+	}
+
 	geometryGrid->lowCorner = header->lowCorner;
 	geometryGrid->highCorner = header->highCorner;
 	geometryGrid->cellsSide = header->cellsSide;
@@ -117,7 +127,29 @@ void ReadTriangleGeometry(const u8 *fileBuffer, ResourceGeometryGrid *geometryGr
 	geometryGrid->positions = AllocAndCopy<v3, TransientAllocator>(positionCount, fileBuffer, header->positionsBlobOffset);
 
 	u32 triangleCount = geometryGrid->offsets[offsetCount - 1];
-	geometryGrid->triangles = AllocAndCopy<IndexTriangle, TransientAllocator>(triangleCount, fileBuffer, header->trianglesBlobOffset);
+	if (header->indexSize == 4)
+		geometryGrid->triangles = AllocAndCopy<IndexTriangle32, TransientAllocator>(triangleCount, fileBuffer, header->trianglesBlobOffset);
+	else
+	{
+		ASSERT(header->indexSize == 2);
+		const IndexTriangle *narrow = (const IndexTriangle *)(fileBuffer + header->trianglesBlobOffset);
+		geometryGrid->triangles = ALLOC_N(TransientAllocator, IndexTriangle32, triangleCount);
+		for (u32 triIdx = 0; triIdx < triangleCount; ++triIdx)
+		{
+			IndexTriangle32 *wide = &geometryGrid->triangles[triIdx];
+			wide->a = narrow[triIdx].a;
+			wide->b = narrow[triIdx].b;
+			wide->c = narrow[triIdx].c;
+			wide->normal = narrow[triIdx].normal;
+		}
+	}
+
+	geometryGrid->bvhNodeCount = header->bvhNodeCount;
+	geometryGrid->bvhNodes = AllocAndCopy<LevelBVHNode, TransientAllocator>(header->bvhNodeCount, fileBuffer, header->bvhNodesBlobOffset);
+	geometryGrid->bvhTriangleBlockCount = header->bvhTriangleBlockCount;
+	geometryGrid->bvhTriangleCount = header->bvhTriangleCount;
+	geometryGrid->bvhTriangleBlocks = AllocAndCopy<LevelTriangleBlock, TransientAllocator>(header->bvhTriangleBlockCount, fileBuffer, header->bvhTriangleBlocksBlobOffset);
+	return true;
 }
 
 void ReadCollisionMesh(const u8 *fileBuffer, ResourceCollisionMesh *collisionMesh)
@@ -131,6 +163,149 @@ void ReadCollisionMesh(const u8 *fileBuffer, ResourceCollisionMesh *collisionMes
 	u32 triangleCount = header->triangleCount;
 	collisionMesh->triangleCount = triangleCount;
 	collisionMesh->triangleData = AllocAndCopy<IndexTriangle, TransientAllocator>(triangleCount, fileBuffer, header->trianglesBlobOffset);
+
+	u32 *adjacencyOffsets = AllocAndCopy<u32, TransientAllocator>(positionCount + 1, fileBuffer, header->adjacencyOffsetsBlobOffset);
+	u32 adjacencyCount = adjacencyOffsets[positionCount];
+	collisionMesh->adjacencyOffsets = adjacencyOffsets;
+	collisionMesh->adjacencyData = AllocAndCopy<u16, TransientAllocator>(adjacencyCount, fileBuffer, header->adjacencyBlobOffset);
+
+	u32 hullFaceCount = header->hullFaceCount;
+	collisionMesh->hullFaceCount = hullFaceCount;
+	collisionMesh->hullFacePlanes = AllocAndCopy<v4, TransientAllocator>(hullFaceCount, fileBuffer, header->hullFacePlanesBlobOffset);
+	u32 *hullFaceOffsets = AllocAndCopy<u32, TransientAllocator>(hullFaceCount + 1, fileBuffer, header->hullFaceOffsetsBlobOffset);
+	collisionMesh->hullFaceOffsets = hullFaceOffsets;
+	collisionMesh->hullFaceVertices = AllocAndCopy<u16, TransientAllocator>(hullFaceOffsets[hullFaceCount], fileBuffer, header->hullFaceVerticesBlobOffset);
+	collisionMesh->hullEdgeCount = header->hullEdgeCount;
+	collisionMesh->hullEdges = AllocAndCopy<HullEdge, TransientAllocator>(header->hullEdgeCount, fileBuffer, header->hullEdgesBlobOffset);
+
+	collisionMesh->hullStartVertex = 0;
+	while (adjacencyOffsets[collisionMesh->hullStartVertex] ==
+			adjacencyOffsets[collisionMesh->hullStartVertex + 1])
+		++collisionMesh->hullStartVertex;
+	ASSERT(collisionMesh->hullStartVertex < positionCount);
+
+	u32 paddedCount = (positionCount + 7) & ~7;
+	f32 *soa = AllocAndCopy<f32, TransientAllocator>(paddedCount * 3, fileBuffer, header->positionsSoABlobOffset);
+	collisionMesh->positionsX = soa;
+	collisionMesh->positionsY = soa + paddedCount;
+	collisionMesh->positionsZ = soa + paddedCount * 2;
+	collisionMesh->paddedPositionCount = paddedCount;
+}
+
+// Appends a blob at the next 8 byte boundary and returns its offset in the file.
+u64 BakeryAppendBlob(DynamicArray<u8, FrameAllocator> *file, const void *data, u64 size)
+{
+	u64 oldCount = file->count;
+	u64 offset = (oldCount + 7) & ~(u64)7;
+	DynamicArrayAddMany(file, (s64)(offset + size - oldCount));
+	memset(file->data + oldCount, 0, offset - oldCount);
+	memcpy(file->data + offset, data, size);
+	return offset;
+}
+
+void BakeryWriteFile(const char *filename, const DynamicArray<u8, FrameAllocator> *file)
+{
+	FileHandle handle = PlatformOpenForWrite(filename);
+	PlatformWriteToFile(handle, file->data, file->count);
+	PlatformCloseFile(handle);
+}
+
+// indexSize is 4 for 32 bit indices in the file, or 2 for 16 bit ones.
+void WriteTriangleGeometry(const char *filename, const ResourceGeometryGrid *geometryGrid, u32 indexSize)
+{
+	DynamicArray<u8, FrameAllocator> file;
+	DynamicArrayInit(&file, 4096);
+	DynamicArrayAddMany(&file, sizeof(BakeryTriangleDataHeader));
+
+	BakeryTriangleDataHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = BAKERY_TRIANGLE_DATA_MAGIC;
+	header.version = BAKERY_TRIANGLE_DATA_VERSION;
+
+	header.lowCorner = geometryGrid->lowCorner;
+	header.highCorner = geometryGrid->highCorner;
+	header.cellsSide = geometryGrid->cellsSide;
+	u32 offsetCount = geometryGrid->cellsSide * geometryGrid->cellsSide + 1;
+	header.offsetsBlobOffset = BakeryAppendBlob(&file, geometryGrid->offsets, sizeof(u32) * offsetCount);
+
+	header.positionCount = geometryGrid->positionCount;
+	header.positionsBlobOffset = BakeryAppendBlob(&file, geometryGrid->positions,
+			sizeof(v3) * geometryGrid->positionCount);
+
+	u32 triangleCount = geometryGrid->offsets[offsetCount - 1];
+	header.indexSize = indexSize;
+	if (indexSize == 4)
+		header.trianglesBlobOffset = BakeryAppendBlob(&file, geometryGrid->triangles,
+				sizeof(IndexTriangle32) * triangleCount);
+	else
+	{
+		ASSERT(indexSize == 2);
+		ASSERT(geometryGrid->positionCount <= U16_MAX + 1);
+		IndexTriangle *narrow = ALLOC_N(FrameAllocator, IndexTriangle, triangleCount);
+		for (u32 triIdx = 0; triIdx < triangleCount; ++triIdx)
+		{
+			const IndexTriangle32 *wide = &geometryGrid->triangles[triIdx];
+			narrow[triIdx].a = (u16)wide->a;
+			narrow[triIdx].b = (u16)wide->b;
+			narrow[triIdx].c = (u16)wide->c;
+			narrow[triIdx].normal = wide->normal;
+		}
+		header.trianglesBlobOffset = BakeryAppendBlob(&file, narrow, sizeof(IndexTriangle) * triangleCount);
+	}
+
+	header.bvhNodeCount = geometryGrid->bvhNodeCount;
+	header.bvhNodesBlobOffset = BakeryAppendBlob(&file, geometryGrid->bvhNodes,
+			sizeof(LevelBVHNode) * geometryGrid->bvhNodeCount);
+	header.bvhTriangleBlockCount = geometryGrid->bvhTriangleBlockCount;
+	header.bvhTriangleCount = geometryGrid->bvhTriangleCount;
+	header.bvhTriangleBlocksBlobOffset = BakeryAppendBlob(&file, geometryGrid->bvhTriangleBlocks,
+			sizeof(LevelTriangleBlock) * geometryGrid->bvhTriangleBlockCount);
+
+	memcpy(file.data, &header, sizeof(header));
+	BakeryWriteFile(filename, &file);
+}
+
+void WriteCollisionMesh(const char *filename, const ResourceCollisionMesh *collisionMesh)
+{
+	DynamicArray<u8, FrameAllocator> file;
+	DynamicArrayInit(&file, 4096);
+	DynamicArrayAddMany(&file, sizeof(BakeryCollisionMeshHeader));
+
+	BakeryCollisionMeshHeader header;
+	memset(&header, 0, sizeof(header));
+
+	u32 positionCount = collisionMesh->positionCount;
+	header.positionCount = positionCount;
+	header.positionsBlobOffset = BakeryAppendBlob(&file, collisionMesh->positionData, sizeof(v3) * positionCount);
+	header.triangleCount = collisionMesh->triangleCount;
+	header.trianglesBlobOffset = BakeryAppendBlob(&file, collisionMesh->triangleData,
+			sizeof(IndexTriangle) * collisionMesh->triangleCount);
+
+	header.adjacencyOffsetsBlobOffset = BakeryAppendBlob(&file, collisionMesh->adjacencyOffsets,
+			sizeof(u32) * (positionCount + 1));
+	header.adjacencyBlobOffset = BakeryAppendBlob(&file, collisionMesh->adjacencyData,
+			sizeof(u16) * collisionMesh->adjacencyOffsets[positionCount]);
+
+	u32 hullFaceCount = collisionMesh->hullFaceCount;
+	header.hullFaceCount = hullFaceCount;
+	header.hullFacePlanesBlobOffset = BakeryAppendBlob(&file, collisionMesh->hullFacePlanes, sizeof(v4) * hullFaceCount);
+	header.hullFaceOffsetsBlobOffset = BakeryAppendBlob(&file, collisionMesh->hullFaceOffsets,
+			sizeof(u32) * (hullFaceCount + 1));
+	header.hullFaceVerticesBlobOffset = BakeryAppendBlob(&file, collisionMesh->hullFaceVertices,
+			sizeof(u16) * collisionMesh->hullFaceOffsets[hullFaceCount]);
+	header.hullEdgeCount = collisionMesh->hullEdgeCount;
+	header.hullEdgesBlobOffset = BakeryAppendBlob(&file, collisionMesh->hullEdges,
+			sizeof(HullEdge) * collisionMesh->hullEdgeCount);
+
+	// Padded counts are multiples of 8 so the three arrays end up back to back.
+	u64 soaSize = sizeof(f32) * collisionMesh->paddedPositionCount;
+	header.positionsSoABlobOffset = BakeryAppendBlob(&file, collisionMesh->positionsX, soaSize);
+	BakeryAppendBlob(&file, collisionMesh->positionsY, soaSize);
+	BakeryAppendBlob(&file, collisionMesh->positionsZ, soaSize);
+	ASSERT(file.count == header.positionsSoABlobOffset + soaSize * 3);
+
+	memcpy(file.data, &header, sizeof(header));
+	BakeryWriteFile(filename, &file);
 }
 
 void ReadImage(const u8 *fileBuffer, const u8 **imageData, u32 *width, u32 *height, u32 *components)
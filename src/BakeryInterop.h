@@ -40,8 +40,16 @@ struct BakerySkinnedMeshAnimationChannelHeader
 	u64 transformsBlobOffset;
 };
 
+// "GRID", and what version of the layout below follows it. Files with anything else there need
+// rebaking.
+const u32 BAKERY_TRIANGLE_DATA_MAGIC = 0x44495247;
+const u32 BAKERY_TRIANGLE_DATA_VERSION = 2;
+
 struct BakeryTriangleDataHeader
 {
+	u32 magic;
+	u32 version;
+
 	v2 lowCorner;
 	v2 highCorner;
 	u32 cellsSide;
@@ -50,7 +58,16 @@ struct BakeryTriangleDataHeader
 	u32 positionCount;
 	u64 positionsBlobOffset;
 
+	// 4 for IndexTriangle32s in the triangles blob, 2 for IndexTriangles.
+	u32 indexSize;
 	u64 trianglesBlobOffset;
+
+	// The level BVH, see ResourceGeometryGrid. Blobs of LevelBVHNodes and LevelTriangleBlocks.
+	u32 bvhNodeCount;
+	u64 bvhNodesBlobOffset;
+	u32 bvhTriangleBlockCount;
+	u32 bvhTriangleCount;
+	u64 bvhTriangleBlocksBlobOffset;
 };
 
 struct BakeryCollisionMeshHeader
@@ -59,6 +76,26 @@ struct BakeryCollisionMeshHeader
 	u64 positionsBlobOffset;
 	u32 triangleCount;
 	u64 trianglesBlobOffset;
+
+	// Edges of the convex hull of the positions. positionCount + 1 u32 offsets into an array of u16
+	// vertex indices, vertices inside the hull have no neighbours.
+	u64 adjacencyOffsetsBlobOffset;
+	u64 adjacencyBlobOffset;
+
+	// Faces of the hull with coplanar triangles merged. One v4 plane per face (outward normal and
+	// distance), then hullFaceCount + 1 u32 offsets into an array of u16 vertex indices that go
+	// counter-clockwise around each face.
+	u32 hullFaceCount;
+	u64 hullFacePlanesBlobOffset;
+	u64 hullFaceOffsetsBlobOffset;
+	u64 hullFaceVerticesBlobOffset;
+	// Every hull edge once, as HullEdge.
+	u32 hullEdgeCount;
+	u64 hullEdgesBlobOffset;
+
+	// Positions again as arrays of x, then y, then z, each padded to a multiple of 8 entries by
+	// repeating the first position.
+	u64 positionsSoABlobOffset;
 };
 
 struct BakeryShaderHeader
@@ -0,0 +1,899 @@
+// Bake steps for the derived parts of baked files, worked out from what the bakery exports. The
+// debug menu can rebake the files in data/ with these, and the benchmarks check the shipped
+// files against them.
+
+struct BakeHullTriangle
+{
+	u32 a, b, c;
+	bool removed;
+};
+
+inline f64 BakeAbs64(f64 n)
+{
+	return n < 0 ? -n : n;
+}
+
+// Positive when d is on the side (b - a) x (c - a) points to. Anything too close to call in
+// doubles comes out as 0, so points coplanar up to rounding are treated as coplanar.
+f64 BakeOrient(v3 a, v3 b, v3 c, v3 d)
+{
+	f64 ux = (f64)b.x - a.x, uy = (f64)b.y - a.y, uz = (f64)b.z - a.z;
+	f64 vx = (f64)c.x - a.x, vy = (f64)c.y - a.y, vz = (f64)c.z - a.z;
+	f64 wx = (f64)d.x - a.x, wy = (f64)d.y - a.y, wz = (f64)d.z - a.z;
+
+	f64 det = ux * (vy * wz - vz * wy) + uy * (vz * wx - vx * wz) + uz * (vx * wy - vy * wx);
+	f64 permanent = BakeAbs64(ux) * (BakeAbs64(vy * wz) + BakeAbs64(vz * wy)) +
+		BakeAbs64(uy) * (BakeAbs64(vz * wx) + BakeAbs64(vx * wz)) +
+		BakeAbs64(uz) * (BakeAbs64(vx * wy) + BakeAbs64(vy * wx));
+	// Error bound of the sum above, from Shewchuk's orient3d filter.
+	if (BakeAbs64(det) <= permanent * 8e-16)
+		return 0;
+	return det;
+}
+
+bool BakeCollinear(v3 a, v3 b, v3 c)
+{
+	f64 ux = (f64)b.x - a.x, uy = (f64)b.y - a.y, uz = (f64)b.z - a.z;
+	f64 vx = (f64)c.x - a.x, vy = (f64)c.y - a.y, vz = (f64)c.z - a.z;
+	const f64 bound = 3e-16;
+	return BakeAbs64(uy * vz - uz * vy) <= (BakeAbs64(uy * vz) + BakeAbs64(uz * vy)) * bound &&
+		BakeAbs64(uz * vx - ux * vz) <= (BakeAbs64(uz * vx) + BakeAbs64(ux * vz)) * bound &&
+		BakeAbs64(ux * vy - uy * vx) <= (BakeAbs64(ux * vy) + BakeAbs64(uy * vx)) * bound;
+}
+
+// Incremental convex hull. Triangles are counter-clockwise seen from outside. The result only
+// depends on the order points are added in, which is the order they come in, so the way coplanar
+// faces get split into triangles is reproducible.
+DynamicArray<BakeHullTriangle, FrameAllocator> BakeHullTriangles(const v3 *positions, u32 positionCount)
+{
+	DynamicArray<BakeHullTriangle, FrameAllocator> triangles;
+	DynamicArrayInit(&triangles, 256);
+
+	// First tetrahedron: the first point, the first one different from it, the first one off the
+	// line through those, and the first one off the plane through all three.
+	u32 i0 = 0;
+	u32 i1 = 1;
+	while (i1 < positionCount && positions[i1] == positions[i0])
+		++i1;
+	u32 i2 = 0;
+	while (i1 < positionCount && i2 < positionCount &&
+			BakeCollinear(positions[i0], positions[i1], positions[i2]))
+		++i2;
+	u32 i3 = 0;
+	while (i2 < positionCount && i3 < positionCount &&
+			BakeOrient(positions[i0], positions[i1], positions[i2], positions[i3]) == 0)
+		++i3;
+	if (i1 >= positionCount || i2 >= positionCount || i3 >= positionCount)
+	{
+		Log("ERROR! Can't bake the hull of %u points that are all on one plane\n", positionCount);
+		ASSERT(false);
+		return triangles;
+	}
+	if (BakeOrient(positions[i0], positions[i1], positions[i2], positions[i3]) > 0)
+	{
+		u32 tmp = i1;
+		i1 = i2;
+		i2 = tmp;
+	}
+	*DynamicArrayAdd(&triangles) = { i0, i1, i2, false };
+	*DynamicArrayAdd(&triangles) = { i0, i3, i1, false };
+	*DynamicArrayAdd(&triangles) = { i1, i3, i2, false };
+	*DynamicArrayAdd(&triangles) = { i2, i3, i0, false };
+
+	DynamicArray<u32, FrameAllocator> visible;
+	DynamicArrayInit(&visible, 64);
+	for (u32 pointIdx = 0; pointIdx < positionCount; ++pointIdx)
+	{
+		if (pointIdx == i0 || pointIdx == i1 || pointIdx == i2 || pointIdx == i3)
+			continue;
+
+		v3 point = positions[pointIdx];
+		visible.count = 0;
+		for (u32 triIdx = 0; triIdx < triangles.count; ++triIdx)
+		{
+			BakeHullTriangle *tri = &triangles[triIdx];
+			if (!tri->removed && BakeOrient(positions[tri->a], positions[tri->b], positions[tri->c], point) > 0)
+				*DynamicArrayAdd(&visible) = triIdx;
+		}
+		if (!visible.count)
+			continue;
+
+		// Edges of visible triangles whose other side isn't visible go around the hole the point
+		// gets connected to.
+		u32 oldCount = (u32)triangles.count;
+		for (u32 visibleIdx = 0; visibleIdx < visible.count; ++visibleIdx)
+		{
+			BakeHullTriangle tri = triangles[visible[visibleIdx]];
+			u32 corners[3] = { tri.a, tri.b, tri.c };
+			for (u32 edgeIdx = 0; edgeIdx < 3; ++edgeIdx)
+			{
+				u32 from = corners[edgeIdx];
+				u32 to = corners[(edgeIdx + 1) % 3];
+				bool horizon = true;
+				for (u32 otherIdx = 0; otherIdx < visible.count && horizon; ++otherIdx)
+				{
+					BakeHullTriangle other = triangles[visible[otherIdx]];
+					horizon = !((other.a == to && other.b == from) || (other.b == to && other.c == from) ||
+							(other.c == to && other.a == from));
+				}
+				if (horizon)
+					*DynamicArrayAdd(&triangles) = { from, to, pointIdx, false };
+			}
+		}
+		ASSERT(triangles.count > oldCount);
+		for (u32 visibleIdx = 0; visibleIdx < visible.count; ++visibleIdx)
+			triangles[visible[visibleIdx]].removed = true;
+	}
+
+	u32 keptCount = 0;
+	for (u32 triIdx = 0; triIdx < triangles.count; ++triIdx)
+	{
+		if (!triangles[triIdx].removed)
+			triangles[keptCount++] = triangles[triIdx];
+	}
+	triangles.count = keptCount;
+	return triangles;
+}
+
+// Index of the triangle with the edge from -> to, going through the triangles around 'from'.
+u32 BakeHullTriangleWithEdge(const BakeHullTriangle *triangles, const u32 *incidentOffsets,
+		const u32 *incident, u32 from, u32 to)
+{
+	for (u32 i = incidentOffsets[from]; i < incidentOffsets[from + 1]; ++i)
+	{
+		const BakeHullTriangle *tri = &triangles[incident[i]];
+		if ((tri->a == from && tri->b == to) || (tri->b == from && tri->c == to) ||
+				(tri->c == from && tri->a == to))
+			return incident[i];
+	}
+	ASSERT(false);
+	return U32_MAX;
+}
+
+void BakeInsertionSort(u32 *keys, u32 *values, u32 count)
+{
+	for (u32 i = 1; i < count; ++i)
+	{
+		u32 key = keys[i];
+		u32 value = values[i];
+		u32 j = i;
+		for (; j > 0 && keys[j - 1] > key; --j)
+		{
+			keys[j] = keys[j - 1];
+			values[j] = values[j - 1];
+		}
+		keys[j] = key;
+		values[j] = value;
+	}
+}
+
+// Fills in the hull adjacency, merged hull faces, hull edges and SoA positions of a collision mesh
+// from its positions. Everything comes out in a canonical order: neighbours and edges sorted,
+// face loops starting at their lowest vertex and faces sorted by their first edge.
+template <typename Allocator>
+void BakeCollisionMeshHull(ResourceCollisionMesh *collisionMesh)
+{
+	const v3 *positions = collisionMesh->positionData;
+	const u32 positionCount = collisionMesh->positionCount;
+	ASSERT(positionCount <= U16_MAX);
+
+	DynamicArray<BakeHullTriangle, FrameAllocator> hull = BakeHullTriangles(positions, positionCount);
+	const BakeHullTriangle *triangles = hull.data;
+	const u32 triangleCount = (u32)hull.count;
+
+	// Triangles around each vertex, laid out like the adjacency.
+	u32 *incidentOffsets = ALLOC_N(FrameAllocator, u32, (positionCount + 1));
+	memset(incidentOffsets, 0, sizeof(u32) * (positionCount + 1));
+	for (u32 triIdx = 0; triIdx < triangleCount; ++triIdx)
+	{
+		++incidentOffsets[triangles[triIdx].a + 1];
+		++incidentOffsets[triangles[triIdx].b + 1];
+		++incidentOffsets[triangles[triIdx].c + 1];
+	}
+	for (u32 vertexIdx = 0; vertexIdx < positionCount; ++vertexIdx)
+		incidentOffsets[vertexIdx + 1] += incidentOffsets[vertexIdx];
+	u32 *incident = ALLOC_N(FrameAllocator, u32, triangleCount * 3);
+	u32 *incidentFill = ALLOC_N(FrameAllocator, u32, positionCount);
+	memcpy(incidentFill, incidentOffsets, sizeof(u32) * positionCount);
+	for (u32 triIdx = 0; triIdx < triangleCount; ++triIdx)
+	{
+		incident[incidentFill[triangles[triIdx].a]++] = triIdx;
+		incident[incidentFill[triangles[triIdx].b]++] = triIdx;
+		incident[incidentFill[triangles[triIdx].c]++] = triIdx;
+	}
+
+	// Every hull edge leaves a vertex in exactly one triangle, so the corners after a vertex in the
+	// triangles around it are its neighbours, each once.
+	u32 *adjacencyOffsets = ALLOC_N(Allocator, u32, (positionCount + 1));
+	memcpy(adjacencyOffsets, incidentOffsets, sizeof(u32) * (positionCount + 1));
+	u16 *adjacencyData = ALLOC_N(Allocator, u16, triangleCount * 3);
+	u32 *sortKeys = ALLOC_N(FrameAllocator, u32, triangleCount * 3);
+	u32 *sortValues = ALLOC_N(FrameAllocator, u32, triangleCount * 3);
+	for (u32 vertexIdx = 0; vertexIdx < positionCount; ++vertexIdx)
+	{
+		u32 first = incidentOffsets[vertexIdx];
+		u32 count = incidentOffsets[vertexIdx + 1] - first;
+		for (u32 i = 0; i < count; ++i)
+		{
+			const BakeHullTriangle *tri = &triangles[incident[first + i]];
+			sortKeys[i] = tri->a == vertexIdx ? tri->b : (tri->b == vertexIdx ? tri->c : tri->a);
+			sortValues[i] = 0;
+		}
+		BakeInsertionSort(sortKeys, sortValues, count);
+		for (u32 i = 0; i < count; ++i)
+			adjacencyData[first + i] = (u16)sortKeys[i];
+	}
+
+	// Flood coplanar neighbours into faces.
+	u32 *triangleFaces = ALLOC_N(FrameAllocator, u32, triangleCount);
+	memset(triangleFaces, 0xFF, sizeof(u32) * triangleCount);
+	u32 *faceSeeds = ALLOC_N(FrameAllocator, u32, triangleCount);
+	u32 *floodStack = ALLOC_N(FrameAllocator, u32, triangleCount);
+	u32 faceCount = 0;
+	for (u32 seedIdx = 0; seedIdx < triangleCount; ++seedIdx)
+	{
+		if (triangleFaces[seedIdx] != U32_MAX)
+			continue;
+
+		const BakeHullTriangle *seed = &triangles[seedIdx];
+		u32 faceIdx = faceCount++;
+		faceSeeds[faceIdx] = seedIdx;
+		triangleFaces[seedIdx] = faceIdx;
+		u32 stackSize = 0;
+		floodStack[stackSize++] = seedIdx;
+		while (stackSize)
+		{
+			const BakeHullTriangle *tri = &triangles[floodStack[--stackSize]];
+			u32 corners[3] = { tri->a, tri->b, tri->c };
+			for (u32 edgeIdx = 0; edgeIdx < 3; ++edgeIdx)
+			{
+				u32 neighbourIdx = BakeHullTriangleWithEdge(triangles, incidentOffsets, incident,
+						corners[(edgeIdx + 1) % 3], corners[edgeIdx]);
+				if (triangleFaces[neighbourIdx] != U32_MAX)
+					continue;
+				const BakeHullTriangle *neighbour = &triangles[neighbourIdx];
+				if (BakeOrient(positions[seed->a], positions[seed->b], positions[seed->c], positions[neighbour->a]) == 0 &&
+					BakeOrient(positions[seed->a], positions[seed->b], positions[seed->c], positions[neighbour->b]) == 0 &&
+					BakeOrient(positions[seed->a], positions[seed->b], positions[seed->c], positions[neighbour->c]) == 0)
+				{
+					triangleFaces[neighbourIdx] = faceIdx;
+					floodStack[stackSize++] = neighbourIdx;
+				}
+			}
+		}
+	}
+	ASSERT(faceCount <= U16_MAX);
+
+	// Walk the outline of each face from its lowest vertex, then drop vertices in the middle of
+	// straight runs.
+	u32 *loopOffsets = ALLOC_N(FrameAllocator, u32, (faceCount + 1));
+	u32 *loopVertices = ALLOC_N(FrameAllocator, u32, triangleCount * 3);
+	u32 *nextOnOutline = ALLOC_N(FrameAllocator, u32, positionCount);
+	memset(nextOnOutline, 0xFF, sizeof(u32) * positionCount);
+	DynamicArray<u32, FrameAllocator> faceTriangles;
+	DynamicArrayInit(&faceTriangles, 64);
+	u32 loopVertexCount = 0;
+	for (u32 faceIdx = 0; faceIdx < faceCount; ++faceIdx)
+	{
+		faceTriangles.count = 0;
+		for (u32 triIdx = faceSeeds[faceIdx]; triIdx < triangleCount; ++triIdx)
+		{
+			if (triangleFaces[triIdx] == faceIdx)
+				*DynamicArrayAdd(&faceTriangles) = triIdx;
+		}
+
+		u32 start = U32_MAX;
+		u32 outlineCount = 0;
+		for (u32 i = 0; i < faceTriangles.count; ++i)
+		{
+			const BakeHullTriangle *tri = &triangles[faceTriangles[i]];
+			u32 corners[3] = { tri->a, tri->b, tri->c };
+			for (u32 edgeIdx = 0; edgeIdx < 3; ++edgeIdx)
+			{
+				u32 from = corners[edgeIdx];
+				u32 to = corners[(edgeIdx + 1) % 3];
+				u32 otherSide = BakeHullTriangleWithEdge(triangles, incidentOffsets, incident, to, from);
+				if (triangleFaces[otherSide] == faceIdx)
+					continue;
+				ASSERT(nextOnOutline[from] == U32_MAX);
+				nextOnOutline[from] = to;
+				start = Min(start, from);
+				++outlineCount;
+			}
+		}
+
+		u32 *loop = &loopVertices[loopVertexCount];
+		u32 loopCount = 0;
+		u32 vertex = start;
+		do
+		{
+			loop[loopCount++] = vertex;
+			u32 next = nextOnOutline[vertex];
+			nextOnOutline[vertex] = U32_MAX;
+			vertex = next;
+		} while (vertex != start && loopCount <= outlineCount);
+		ASSERT(loopCount == outlineCount);
+
+		bool changed = true;
+		while (changed && loopCount > 3)
+		{
+			changed = false;
+			for (u32 i = 0; i < loopCount; ++i)
+			{
+				u32 prev = loop[(i + loopCount - 1) % loopCount];
+				u32 next = loop[(i + 1) % loopCount];
+				if (BakeCollinear(positions[prev], positions[loop[i]], positions[next]))
+				{
+					memmove(&loop[i], &loop[i + 1], sizeof(u32) * (loopCount - i - 1));
+					--loopCount;
+					changed = true;
+					break;
+				}
+			}
+		}
+
+		loopOffsets[faceIdx] = loopVertexCount;
+		loopVertexCount += loopCount;
+	}
+	loopOffsets[faceCount] = loopVertexCount;
+
+	// Faces in order of their first edge, which no two faces share.
+	u32 *faceOrder = ALLOC_N(FrameAllocator, u32, faceCount);
+	for (u32 faceIdx = 0; faceIdx < faceCount; ++faceIdx)
+	{
+		const u32 *loop = &loopVertices[loopOffsets[faceIdx]];
+		sortKeys[faceIdx] = (loop[0] << 16) | loop[1];
+		faceOrder[faceIdx] = faceIdx;
+	}
+	BakeInsertionSort(sortKeys, faceOrder, faceCount);
+
+	v4 *hullFacePlanes = ALLOC_N(Allocator, v4, faceCount);
+	u32 *hullFaceOffsets = ALLOC_N(Allocator, u32, (faceCount + 1));
+	u16 *hullFaceVertices = ALLOC_N(Allocator, u16, loopVertexCount);
+	u32 hullFaceVertexCount = 0;
+	for (u32 faceIdx = 0; faceIdx < faceCount; ++faceIdx)
+	{
+		u32 oldFaceIdx = faceOrder[faceIdx];
+		const BakeHullTriangle *seed = &triangles[faceSeeds[oldFaceIdx]];
+		v3 a = positions[seed->a];
+		v3 b = positions[seed->b];
+		v3 c = positions[seed->c];
+		f64 ux = (f64)b.x - a.x, uy = (f64)b.y - a.y, uz = (f64)b.z - a.z;
+		f64 vx = (f64)c.x - a.x, vy = (f64)c.y - a.y, vz = (f64)c.z - a.z;
+		f64 nx = uy * vz - uz * vy, ny = uz * vx - ux * vz, nz = ux * vy - uy * vx;
+		f64 length = sqrt(nx * nx + ny * ny + nz * nz);
+		v3 normal = { (f32)(nx / length), (f32)(ny / length), (f32)(nz / length) };
+
+		hullFaceOffsets[faceIdx] = hullFaceVertexCount;
+		f64 distance = -1e300;
+		for (u32 i = loopOffsets[oldFaceIdx]; i < loopOffsets[oldFaceIdx + 1]; ++i)
+		{
+			v3 p = positions[loopVertices[i]];
+			distance = Max(distance, (f64)normal.x * p.x + (f64)normal.y * p.y + (f64)normal.z * p.z);
+			hullFaceVertices[hullFaceVertexCount++] = (u16)loopVertices[i];
+		}
+		hullFacePlanes[faceIdx] = { normal.x, normal.y, normal.z, (f32)distance };
+	}
+	hullFaceOffsets[faceCount] = hullFaceVertexCount;
+
+	// Each face outline edge, by the vertex it leaves, with the face it goes around.
+	u32 *outEdgeOffsets = ALLOC_N(FrameAllocator, u32, (positionCount + 1));
+	memset(outEdgeOffsets, 0, sizeof(u32) * (positionCount + 1));
+	for (u32 i = 0; i < hullFaceVertexCount; ++i)
+		++outEdgeOffsets[hullFaceVertices[i] + 1];
+	for (u32 vertexIdx = 0; vertexIdx < positionCount; ++vertexIdx)
+		outEdgeOffsets[vertexIdx + 1] += outEdgeOffsets[vertexIdx];
+	u32 *outEdgeTo = ALLOC_N(FrameAllocator, u32, hullFaceVertexCount);
+	u32 *outEdgeFace = ALLOC_N(FrameAllocator, u32, hullFaceVertexCount);
+	memcpy(incidentFill, outEdgeOffsets, sizeof(u32) * positionCount);
+	for (u32 faceIdx = 0; faceIdx < faceCount; ++faceIdx)
+	{
+		u32 first = hullFaceOffsets[faceIdx];
+		u32 count = hullFaceOffsets[faceIdx + 1] - first;
+		for (u32 i = 0; i < count; ++i)
+		{
+			u32 from = hullFaceVertices[first + i];
+			u32 slot = incidentFill[from]++;
+			outEdgeTo[slot] = hullFaceVertices[first + (i + 1) % count];
+			outEdgeFace[slot] = faceIdx;
+		}
+	}
+
+	u32 hullEdgeCount = hullFaceVertexCount / 2;
+	HullEdge *hullEdges = ALLOC_N(Allocator, HullEdge, hullEdgeCount);
+	u32 edgeIdx = 0;
+	for (u32 vertexIdx = 0; vertexIdx < positionCount; ++vertexIdx)
+	{
+		u32 count = 0;
+		for (u32 i = outEdgeOffsets[vertexIdx]; i < outEdgeOffsets[vertexIdx + 1]; ++i)
+		{
+			if (outEdgeTo[i] < vertexIdx)
+				continue;
+			sortKeys[count] = outEdgeTo[i];
+			sortValues[count] = outEdgeFace[i];
+			++count;
+		}
+		BakeInsertionSort(sortKeys, sortValues, count);
+		for (u32 i = 0; i < count; ++i)
+		{
+			u32 to = sortKeys[i];
+			u32 otherFace = U32_MAX;
+			for (u32 j = outEdgeOffsets[to]; j < outEdgeOffsets[to + 1]; ++j)
+			{
+				if (outEdgeTo[j] == vertexIdx)
+					otherFace = outEdgeFace[j];
+			}
+			ASSERT(otherFace != U32_MAX);
+			ASSERT(edgeIdx < hullEdgeCount);
+			hullEdges[edgeIdx++] = { (u16)vertexIdx, (u16)to, (u16)sortValues[i], (u16)otherFace };
+		}
+	}
+	ASSERT(edgeIdx == hullEdgeCount);
+
+	u32 paddedCount = (positionCount + 7) & ~7;
+	f32 *soa = ALLOC_N(Allocator, f32, paddedCount * 3);
+	for (u32 i = 0; i < paddedCount; ++i)
+	{
+		v3 p = positions[i < positionCount ? i : 0];
+		soa[i] = p.x;
+		soa[paddedCount + i] = p.y;
+		soa[paddedCount * 2 + i] = p.z;
+	}
+
+	collisionMesh->adjacencyOffsets = adjacencyOffsets;
+	collisionMesh->adjacencyData = adjacencyData;
+	collisionMesh->hullStartVertex = 0;
+	while (adjacencyOffsets[collisionMesh->hullStartVertex] ==
+			adjacencyOffsets[collisionMesh->hullStartVertex + 1])
+		++collisionMesh->hullStartVertex;
+	collisionMesh->hullFacePlanes = hullFacePlanes;
+	collisionMesh->hullFaceOffsets = hullFaceOffsets;
+	collisionMesh->hullFaceVertices = hullFaceVertices;
+	collisionMesh->hullFaceCount = faceCount;
+	collisionMesh->hullEdges = hullEdges;
+	collisionMesh->hullEdgeCount = hullEdgeCount;
+	collisionMesh->positionsX = soa;
+	collisionMesh->positionsY = soa + paddedCount;
+	collisionMesh->positionsZ = soa + paddedCount * 2;
+	collisionMesh->paddedPositionCount = paddedCount;
+}
+
+// Whether the hull data in two collision meshes with the same positions is the same, bit for bit.
+bool BakeCollisionMeshHullEqual(const ResourceCollisionMesh *a, const ResourceCollisionMesh *b)
+{
+	if (a->positionCount != b->positionCount || a->hullFaceCount != b->hullFaceCount ||
+			a->hullEdgeCount != b->hullEdgeCount || a->paddedPositionCount != b->paddedPositionCount ||
+			a->hullStartVertex != b->hullStartVertex)
+		return false;
+
+	u32 positionCount = a->positionCount;
+	u32 faceCount = a->hullFaceCount;
+	return !memcmp(a->adjacencyOffsets, b->adjacencyOffsets, sizeof(u32) * (positionCount + 1)) &&
+		!memcmp(a->adjacencyData, b->adjacencyData, sizeof(u16) * a->adjacencyOffsets[positionCount]) &&
+		!memcmp(a->hullFacePlanes, b->hullFacePlanes, sizeof(v4) * faceCount) &&
+		!memcmp(a->hullFaceOffsets, b->hullFaceOffsets, sizeof(u32) * (faceCount + 1)) &&
+		!memcmp(a->hullFaceVertices, b->hullFaceVertices, sizeof(u16) * a->hullFaceOffsets[faceCount]) &&
+		!memcmp(a->hullEdges, b->hullEdges, sizeof(HullEdge) * a->hullEdgeCount) &&
+		!memcmp(a->positionsX, b->positionsX, sizeof(f32) * a->paddedPositionCount) &&
+		!memcmp(a->positionsY, b->positionsY, sizeof(f32) * a->paddedPositionCount) &&
+		!memcmp(a->positionsZ, b->positionsZ, sizeof(f32) * a->paddedPositionCount);
+}
+
+const char *BAKED_COLLISION_MESH_FILENAMES[] = { "anvil_collision.b", "teapot_collision.b",
+	"editor_arrow_collision.b", "editor_circle_collision.b" };
+
+// Rewrites the collision meshes in data/ with hull data baked from their positions and triangles.
+void BakeRebakeCollisionMeshes()
+{
+	for (u32 fileIdx = 0; fileIdx < ArrayCount(BAKED_COLLISION_MESH_FILENAMES); ++fileIdx)
+	{
+		const char *path = TPrintF("data/%s", BAKED_COLLISION_MESH_FILENAMES[fileIdx]).data;
+		u8 *fileBuffer;
+		u64 fileSize;
+		if (!PlatformReadEntireFile(path, &fileBuffer, &fileSize, FrameAllocator::Alloc))
+		{
+			Log("ERROR! Couldn't read %s to rebake it\n", path);
+			continue;
+		}
+
+		const BakeryCollisionMeshHeader *header = (const BakeryCollisionMeshHeader *)fileBuffer;
+		ResourceCollisionMesh collisionMesh = {};
+		collisionMesh.positionCount = header->positionCount;
+		collisionMesh.positionData = (v3 *)(fileBuffer + header->positionsBlobOffset);
+		collisionMesh.triangleCount = header->triangleCount;
+		collisionMesh.triangleData = (IndexTriangle *)(fileBuffer + header->trianglesBlobOffset);
+		BakeCollisionMeshHull<FrameAllocator>(&collisionMesh);
+
+		WriteCollisionMesh(path, &collisionMesh);
+		Log("Rebaked %s: %u hull faces, %u hull edges\n", path, collisionMesh.hullFaceCount,
+				collisionMesh.hullEdgeCount);
+	}
+}
+
+// Stops splitting the level BVH past this depth, traversal stacks never need more.
+const u32 LEVEL_BVH_MAX_DEPTH = 48;
+
+// A leaf's triangles fill one LevelTriangleBlock, they're tested all at once.
+const u32 LEVEL_BVH_MAX_LEAF_TRIANGLES = 8;
+const int LEVEL_BVH_BIN_COUNT = 12;
+
+inline f32 LevelBVHSurfaceArea(const AABB &aabb)
+{
+	v3 size = aabb.max - aabb.min;
+	return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+inline void LevelBVHGrow(AABB *aabb, const AABB &other)
+{
+	aabb->min = { Min(aabb->min.x, other.min.x), Min(aabb->min.y, other.min.y),
+		Min(aabb->min.z, other.min.z) };
+	aabb->max = { Max(aabb->max.x, other.max.x), Max(aabb->max.y, other.max.y),
+		Max(aabb->max.z, other.max.z) };
+}
+
+// The grid files every triangle under each cell it touches. Takes each one once and builds a BVH
+// over them, splitting on the cheapest of LEVEL_BVH_BIN_COUNT centroid bins per axis by the surface
+// area heuristic, then lays the leaves' triangles out in blocks.
+template <typename Allocator>
+void BakeLevelBVH(ResourceGeometryGrid *geometryGrid)
+{
+	const u32 gridTriangleCount = geometryGrid->offsets[geometryGrid->cellsSide *
+		geometryGrid->cellsSide];
+
+	// Drop the copies, with an open addressing set of triangle indices + 1 hashed by corners.
+	u32 setCapacity = 16;
+	while (setCapacity < gridTriangleCount * 2)
+		setCapacity <<= 1;
+	u32 *set = ALLOC_N(FrameAllocator, u32, setCapacity);
+	memset(set, 0, sizeof(u32) * setCapacity);
+	u32 *unique = ALLOC_N(FrameAllocator, u32, gridTriangleCount);
+	u32 triangleCount = 0;
+	for (u32 triIdx = 0; triIdx < gridTriangleCount; ++triIdx)
+	{
+		const IndexTriangle32 *tri = &geometryGrid->triangles[triIdx];
+		u64 hash = ((u64)tri->a * 0x9E3779B97F4A7C15ull) ^ ((u64)tri->b * 0xC2B2AE3D27D4EB4Full) ^
+			((u64)tri->c * 0x165667B19E3779F9ull);
+		u32 slot = (u32)(hash >> 32) & (setCapacity - 1);
+		bool found = false;
+		while (set[slot])
+		{
+			const IndexTriangle32 *other = &geometryGrid->triangles[set[slot] - 1];
+			if (other->a == tri->a && other->b == tri->b && other->c == tri->c)
+			{
+				found = true;
+				break;
+			}
+			slot = (slot + 1) & (setCapacity - 1);
+		}
+		if (found)
+			continue;
+		set[slot] = triIdx + 1;
+		unique[triangleCount++] = triIdx;
+	}
+
+	if (!triangleCount)
+	{
+		geometryGrid->bvhNodes = nullptr;
+		geometryGrid->bvhNodeCount = 0;
+		geometryGrid->bvhTriangleBlocks = nullptr;
+		geometryGrid->bvhTriangleBlockCount = 0;
+		geometryGrid->bvhTriangleCount = 0;
+		return;
+	}
+
+	AABB *triangleAABBs = ALLOC_N(FrameAllocator, AABB, triangleCount);
+	v3 *centroids = ALLOC_N(FrameAllocator, v3, triangleCount);
+	for (u32 i = 0; i < triangleCount; ++i)
+	{
+		const IndexTriangle32 *tri = &geometryGrid->triangles[unique[i]];
+		v3 a = geometryGrid->positions[tri->a];
+		v3 b = geometryGrid->positions[tri->b];
+		v3 c = geometryGrid->positions[tri->c];
+		triangleAABBs[i].min = { Min(a.x, Min(b.x, c.x)), Min(a.y, Min(b.y, c.y)),
+			Min(a.z, Min(b.z, c.z)) };
+		triangleAABBs[i].max = { Max(a.x, Max(b.x, c.x)), Max(a.y, Max(b.y, c.y)),
+			Max(a.z, Max(b.z, c.z)) };
+		centroids[i] = (triangleAABBs[i].min + triangleAABBs[i].max) * 0.5f;
+	}
+
+	// Indices into unique, reordered in place so each node's triangles end up contiguous.
+	u32 *order = ALLOC_N(FrameAllocator, u32, triangleCount);
+	for (u32 i = 0; i < triangleCount; ++i)
+		order[i] = i;
+
+	const u32 maxNodeCount = triangleCount * 2 - 1;
+	LevelBVHNode *nodes = ALLOC_N(Allocator, LevelBVHNode, maxNodeCount);
+	u32 nodeCount = 0;
+
+	struct BuildTask
+	{
+		u32 parentIdx;
+		u32 begin;
+		u32 end;
+		u32 depth;
+		bool isSecondChild;
+	};
+	DynamicArray<BuildTask, FrameAllocator> tasks;
+	DynamicArrayInit(&tasks, 64);
+	*DynamicArrayAdd(&tasks) = { U32_MAX, 0, triangleCount, 0, false };
+	while (tasks.count)
+	{
+		// Taking the last task first makes nodes come out depth first.
+		BuildTask task = tasks[--tasks.count];
+		u32 nodeIdx = nodeCount++;
+		if (task.isSecondChild)
+			nodes[task.parentIdx].offset = nodeIdx;
+
+		LevelBVHNode *node = &nodes[nodeIdx];
+		node->aabb = { { INFINITY, INFINITY, INFINITY }, { -INFINITY, -INFINITY, -INFINITY } };
+		AABB centroidBounds = node->aabb;
+		for (u32 i = task.begin; i < task.end; ++i)
+		{
+			LevelBVHGrow(&node->aabb, triangleAABBs[order[i]]);
+			LevelBVHGrow(&centroidBounds, { centroids[order[i]], centroids[order[i]] });
+		}
+
+		// Whatever fits in a block is a leaf, testing it costs about as much as testing the boxes
+		// of two children would.
+		u32 count = task.end - task.begin;
+		u32 middle = task.begin;
+		if (count > LEVEL_BVH_MAX_LEAF_TRIANGLES && task.depth < LEVEL_BVH_MAX_DEPTH)
+		{
+			int bestAxis = -1;
+			int bestSplit = 0;
+			f32 bestCost = INFINITY;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				f32 axisMin = centroidBounds.min.v[axis];
+				f32 axisExtent = centroidBounds.max.v[axis] - axisMin;
+				if (axisExtent <= 0)
+					continue;
+
+				AABB binAABBs[LEVEL_BVH_BIN_COUNT];
+				u32 binCounts[LEVEL_BVH_BIN_COUNT] = {};
+				for (int bin = 0; bin < LEVEL_BVH_BIN_COUNT; ++bin)
+					binAABBs[bin] = { { INFINITY, INFINITY, INFINITY },
+						{ -INFINITY, -INFINITY, -INFINITY } };
+				for (u32 i = task.begin; i < task.end; ++i)
+				{
+					int bin = Min(LEVEL_BVH_BIN_COUNT - 1, (int)((centroids[order[i]].v[axis] - axisMin) /
+								axisExtent * LEVEL_BVH_BIN_COUNT));
+					LevelBVHGrow(&binAABBs[bin], triangleAABBs[order[i]]);
+					++binCounts[bin];
+				}
+
+				// Area and count on each side of every split between bins.
+				f32 leftAreas[LEVEL_BVH_BIN_COUNT - 1];
+				u32 leftCounts[LEVEL_BVH_BIN_COUNT - 1];
+				AABB left = binAABBs[0];
+				u32 leftCount = 0;
+				for (int split = 0; split < LEVEL_BVH_BIN_COUNT - 1; ++split)
+				{
+					LevelBVHGrow(&left, binAABBs[split]);
+					leftCount += binCounts[split];
+					leftAreas[split] = leftCount ? LevelBVHSurfaceArea(left) : 0;
+					leftCounts[split] = leftCount;
+				}
+				AABB right = binAABBs[LEVEL_BVH_BIN_COUNT - 1];
+				u32 rightCount = 0;
+				for (int split = LEVEL_BVH_BIN_COUNT - 2; split >= 0; --split)
+				{
+					LevelBVHGrow(&right, binAABBs[split + 1]);
+					rightCount += binCounts[split + 1];
+					if (!leftCounts[split] || !rightCount)
+						continue;
+					f32 cost = leftAreas[split] * leftCounts[split] +
+						LevelBVHSurfaceArea(right) * rightCount;
+					if (cost < bestCost)
+					{
+						bestCost = cost;
+						bestAxis = axis;
+						bestSplit = split;
+					}
+				}
+			}
+
+			if (bestAxis >= 0)
+			{
+				f32 axisMin = centroidBounds.min.v[bestAxis];
+				f32 axisExtent = centroidBounds.max.v[bestAxis] - axisMin;
+				u32 *scanBegin = order + task.begin;
+				u32 *scanEnd = order + task.end;
+				while (scanBegin < scanEnd)
+				{
+					int bin = Min(LEVEL_BVH_BIN_COUNT - 1, (int)((centroids[*scanBegin].v[bestAxis] -
+									axisMin) / axisExtent * LEVEL_BVH_BIN_COUNT));
+					if (bin <= bestSplit)
+						++scanBegin;
+					else
+					{
+						u32 tmp = *scanBegin;
+						*scanBegin = *--scanEnd;
+						*scanEnd = tmp;
+					}
+				}
+				middle = (u32)(scanBegin - order);
+			}
+			else
+				// All centroids in the same spot, just halve it.
+				middle = task.begin + count / 2;
+		}
+
+		if (middle == task.begin || middle == task.end)
+		{
+			// Where its triangles start in order for now, blocks get handed out below.
+			node->offset = task.begin;
+			node->triangleCount = count;
+			continue;
+		}
+
+		node->triangleCount = 0;
+		*DynamicArrayAdd(&tasks) = { nodeIdx, middle, task.end, task.depth + 1, true };
+		*DynamicArrayAdd(&tasks) = { nodeIdx, task.begin, middle, task.depth + 1, false };
+	}
+	ASSERT(nodeCount <= maxNodeCount);
+
+	// Every leaf starts on a block of its own. Leaves past the depth limit can take more than one.
+	u32 blockCount = 0;
+	for (u32 nodeIdx = 0; nodeIdx < nodeCount; ++nodeIdx)
+		blockCount += (nodes[nodeIdx].triangleCount + 7) / 8;
+	// The allocators ignore alignment, round up to a cache line by hand.
+	const u64 blockAlignment = alignof(LevelTriangleBlock);
+	u8 *blockMemory = (u8 *)Allocator::Alloc(sizeof(LevelTriangleBlock) * blockCount + blockAlignment - 1,
+			blockAlignment);
+	LevelTriangleBlock *blocks = (LevelTriangleBlock *)(((u64)blockMemory + blockAlignment - 1) &
+			~(blockAlignment - 1));
+	memset(blocks, 0, sizeof(LevelTriangleBlock) * blockCount);
+	u32 blockIdx = 0;
+	for (u32 nodeIdx = 0; nodeIdx < nodeCount; ++nodeIdx)
+	{
+		LevelBVHNode *node = &nodes[nodeIdx];
+		if (!node->triangleCount)
+			continue;
+
+		const u32 begin = node->offset;
+		node->offset = blockIdx;
+		for (u32 i = 0; i < node->triangleCount; ++i)
+		{
+			LevelTriangleBlock *block = &blocks[blockIdx + i / 8];
+			const u32 lane = i % 8;
+			const IndexTriangle32 *tri = &geometryGrid->triangles[unique[order[begin + i]]];
+			v3 a = geometryGrid->positions[tri->a];
+			v3 edge1 = geometryGrid->positions[tri->b] - a;
+			v3 edge2 = geometryGrid->positions[tri->c] - a;
+			block->v0X[lane] = a.x;
+			block->v0Y[lane] = a.y;
+			block->v0Z[lane] = a.z;
+			block->edge1X[lane] = edge1.x;
+			block->edge1Y[lane] = edge1.y;
+			block->edge1Z[lane] = edge1.z;
+			block->edge2X[lane] = edge2.x;
+			block->edge2Y[lane] = edge2.y;
+			block->edge2Z[lane] = edge2.z;
+			block->normalX[lane] = tri->normal.x;
+			block->normalY[lane] = tri->normal.y;
+			block->normalZ[lane] = tri->normal.z;
+		}
+		blockIdx += (node->triangleCount + 7) / 8;
+	}
+
+	geometryGrid->bvhNodes = nodes;
+	geometryGrid->bvhNodeCount = nodeCount;
+	geometryGrid->bvhTriangleBlocks = blocks;
+	geometryGrid->bvhTriangleBlockCount = blockCount;
+	geometryGrid->bvhTriangleCount = triangleCount;
+}
+
+
+// Bit for bit comparison of the BVHs of two grids.
+bool BakeLevelBVHEqual(const ResourceGeometryGrid *a, const ResourceGeometryGrid *b)
+{
+	return a->bvhNodeCount == b->bvhNodeCount && a->bvhTriangleBlockCount == b->bvhTriangleBlockCount &&
+		a->bvhTriangleCount == b->bvhTriangleCount &&
+		!memcmp(a->bvhNodes, b->bvhNodes, sizeof(LevelBVHNode) * a->bvhNodeCount) &&
+		!memcmp(a->bvhTriangleBlocks, b->bvhTriangleBlocks,
+				sizeof(LevelTriangleBlock) * a->bvhTriangleBlockCount);
+}
+
+// data/level_test.b: a bumpy side x side heightfield, filed into a 16 x 16 grid the way the bakery
+// does it, under every cell each triangle's XY bounds touch.
+template <typename Allocator>
+void BakeTestLevel(ResourceGeometryGrid *geometryGrid, u32 side)
+{
+	const u32 vertexSide = side + 1;
+	const u32 cellsSide = 16;
+	const f32 halfSide = side * 0.5f;
+	const f32 cellSize = (f32)side / cellsSide;
+
+	geometryGrid->lowCorner = { -halfSide, -halfSide };
+	geometryGrid->highCorner = { halfSide, halfSide };
+	geometryGrid->cellsSide = cellsSide;
+	geometryGrid->positionCount = vertexSide * vertexSide;
+	geometryGrid->positions = ALLOC_N(Allocator, v3, geometryGrid->positionCount);
+	for (u32 y = 0; y < vertexSide; ++y)
+	{
+		for (u32 x = 0; x < vertexSide; ++x)
+		{
+			f32 height = 2.0f * Sin(x * 0.3f) * Cos(y * 0.2f) + ((x * 7 + y * 13) % 5) * 0.1f;
+			geometryGrid->positions[x + y * vertexSide] = { (f32)x - halfSide, (f32)y - halfSide, height };
+		}
+	}
+
+	// Two triangles per quad.
+	const u32 triangleCount = side * side * 2;
+	IndexTriangle32 *triangles = ALLOC_N(FrameAllocator, IndexTriangle32, triangleCount);
+	for (u32 y = 0; y < side; ++y)
+	{
+		for (u32 x = 0; x < side; ++x)
+		{
+			u32 a = x + y * vertexSide;
+			u32 b = a + 1;
+			u32 c = b + vertexSide;
+			u32 d = a + vertexSide;
+			IndexTriangle32 *quad = &triangles[(x + y * side) * 2];
+			quad[0].a = a; quad[0].b = b; quad[0].c = c;
+			quad[1].a = a; quad[1].b = c; quad[1].c = d;
+			for (int i = 0; i < 2; ++i)
+			{
+				v3 p0 = geometryGrid->positions[quad[i].a];
+				v3 p1 = geometryGrid->positions[quad[i].b];
+				v3 p2 = geometryGrid->positions[quad[i].c];
+				quad[i].normal = V3Normalize(V3Cross(p1 - p0, p2 - p0));
+			}
+		}
+	}
+
+	// Count what goes under each cell first, then file the triangles in order.
+	const u32 cellCount = cellsSide * cellsSide;
+	u32 *offsets = ALLOC_N(Allocator, u32, (cellCount + 1));
+	memset(offsets, 0, sizeof(u32) * (cellCount + 1));
+	u32 *cellFill = ALLOC_N(FrameAllocator, u32, cellCount);
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		if (pass == 1)
+		{
+			for (u32 cellIdx = 0; cellIdx < cellCount; ++cellIdx)
+				offsets[cellIdx + 1] += offsets[cellIdx];
+			memcpy(cellFill, offsets, sizeof(u32) * cellCount);
+			geometryGrid->triangles = ALLOC_N(Allocator, IndexTriangle32, offsets[cellCount]);
+		}
+
+		for (u32 triIdx = 0; triIdx < triangleCount; ++triIdx)
+		{
+			const IndexTriangle32 *tri = &triangles[triIdx];
+			v3 p0 = geometryGrid->positions[tri->a];
+			v3 p1 = geometryGrid->positions[tri->b];
+			v3 p2 = geometryGrid->positions[tri->c];
+			int x0 = (int)Floor((Min(p0.x, Min(p1.x, p2.x)) + halfSide) / cellSize);
+			int x1 = (int)Floor((Max(p0.x, Max(p1.x, p2.x)) + halfSide) / cellSize);
+			int y0 = (int)Floor((Min(p0.y, Min(p1.y, p2.y)) + halfSide) / cellSize);
+			int y1 = (int)Floor((Max(p0.y, Max(p1.y, p2.y)) + halfSide) / cellSize);
+			for (int cellY = Max(0, y0); cellY <= Min((int)cellsSide - 1, y1); ++cellY)
+			{
+				for (int cellX = Max(0, x0); cellX <= Min((int)cellsSide - 1, x1); ++cellX)
+				{
+					u32 cellIdx = cellX + cellY * cellsSide;
+					if (pass == 0)
+						++offsets[cellIdx + 1];
+					else
+						geometryGrid->triangles[cellFill[cellIdx]++] = *tri;
+				}
+			}
+		}
+	}
+	geometryGrid->offsets = offsets;
+
+	BakeLevelBVH<Allocator>(geometryGrid);
+}
+
+const u32 TEST_LEVEL_SIDE = 24;
+
+// Rewrites data/level_test.b from BakeTestLevel, with 32 bit indices.
+void BakeRebakeTestLevel()
+{
+	ResourceGeometryGrid geometryGrid = {};
+	BakeTestLevel<FrameAllocator>(&geometryGrid, TEST_LEVEL_SIDE);
+	WriteTriangleGeometry("data/level_test.b", &geometryGrid, 4);
+	Log("Rebaked data/level_test.b: %u triangles, %u BVH nodes\n", geometryGrid.bvhTriangleCount,
+			geometryGrid.bvhNodeCount);
+}
@@ -0,0 +1,749 @@
+void BroadphaseInit(Broadphase *broadphase)
+{
+	broadphase->mode = BROADPHASE_DEFAULT_MODE;
+	broadphase->hashGrid.cellSize = HASH_GRID_DEFAULT_CELL_SIZE;
+	ArrayInit(&broadphase->sweepAndPrune.endpoints, MAX_ENTITIES * 2);
+	AABBTreeInit(&broadphase->tree, MAX_ENTITIES * 2);
+	broadphase->treeOutdated = true;
+	broadphase->stats = {};
+}
+
+void BroadphaseAddCollider(GameState *gameState, EntityHandle entityHandle)
+{
+	SweepAndPrune *sap = &gameState->broadphase.sweepAndPrune;
+
+	// Values get filled on the next update and the insertion sort moves them into place.
+	*ArrayAdd(&sap->endpoints) = { INFINITY, entityHandle.id };
+	*ArrayAdd(&sap->endpoints) = { INFINITY, entityHandle.id | SAP_ENDPOINT_MAX_BIT };
+	gameState->broadphase.treeOutdated = true;
+}
+
+void BroadphaseRemoveCollider(GameState *gameState, EntityHandle entityHandle)
+{
+	SweepAndPrune *sap = &gameState->broadphase.sweepAndPrune;
+
+	// Remove both endpoints keeping the rest in order.
+	u32 writeIdx = 0;
+	for (u32 readIdx = 0; readIdx < sap->endpoints.count; ++readIdx)
+	{
+		SAPEndpoint endpoint = sap->endpoints[readIdx];
+		if ((endpoint.data & ~SAP_ENDPOINT_MAX_BIT) != entityHandle.id)
+			sap->endpoints[writeIdx++] = endpoint;
+	}
+	ASSERT(sap->endpoints.count - writeIdx == 2);
+	sap->endpoints.count = writeIdx;
+
+	// Leaves are only created on the first update after the collider is added.
+	AABBTree *tree = &gameState->broadphase.tree;
+	if (tree->entityLeaves[entityHandle.id] != AABB_TREE_NULL)
+		AABBTreeRemove(tree, entityHandle.id);
+	gameState->broadphase.treeOutdated = true;
+}
+
+// Allocators don't honor alignment, so over-allocate and align by hand.
+inline f32 *AllocF32Aligned32(u32 count)
+{
+	u64 memory = (u64)FrameAllocator::Alloc(sizeof(f32) * count + 31, 32);
+	return (f32 *)((memory + 31) & ~31ull);
+}
+
+// Room for count boxes, the padding up to a multiple of 8 is already filled with empty boxes.
+AABBSoA AABBSoAAlloc(u32 count)
+{
+	AABBSoA soa;
+	soa.count = count;
+	u32 paddedCount = (count + 7) & ~7;
+	soa.minX = AllocF32Aligned32(paddedCount);
+	soa.minY = AllocF32Aligned32(paddedCount);
+	soa.minZ = AllocF32Aligned32(paddedCount);
+	soa.maxX = AllocF32Aligned32(paddedCount);
+	soa.maxY = AllocF32Aligned32(paddedCount);
+	soa.maxZ = AllocF32Aligned32(paddedCount);
+	for (u32 i = count; i < paddedCount; ++i)
+	{
+		soa.minX[i] = INFINITY;
+		soa.minY[i] = INFINITY;
+		soa.minZ[i] = INFINITY;
+		soa.maxX[i] = -INFINITY;
+		soa.maxY[i] = -INFINITY;
+		soa.maxZ[i] = -INFINITY;
+	}
+	return soa;
+}
+
+inline void AABBSoASet(AABBSoA *soa, u32 idx, AABB aabb)
+{
+	soa->minX[idx] = aabb.min.x;
+	soa->minY[idx] = aabb.min.y;
+	soa->minZ[idx] = aabb.min.z;
+	soa->maxX[idx] = aabb.max.x;
+	soa->maxY[idx] = aabb.max.y;
+	soa->maxZ[idx] = aabb.max.z;
+}
+
+AABBSoA AABBSoAFromArray(ArrayView<const AABB> AABBs)
+{
+	AABBSoA soa = AABBSoAAlloc(AABBs.count);
+	for (u32 i = 0; i < AABBs.count; ++i)
+		AABBSoASet(&soa, i, AABBs[i]);
+	return soa;
+}
+
+const u32 BROADPHASE_AABBS_PER_JOB = 256;
+
+AABBSoA BroadphaseComputeAABBs(GameState *gameState, f32 deltaTime)
+{
+	AABBSoA AABBs = AABBSoAAlloc(gameState->colliders.count);
+	ParallelFor(g_jobSystem, AABBs.count, BROADPHASE_AABBS_PER_JOB,
+			[gameState, &AABBs, deltaTime](u32 beginIdx, u32 endIdx)
+	{
+		for (u32 colliderIdx = beginIdx; colliderIdx < endIdx; ++colliderIdx)
+		{
+			Collider *collider = &gameState->colliders[colliderIdx];
+			Transform *transform = GetEntityTransform(gameState, collider->entityHandle);
+			ASSERT(transform); // There should never be an orphaned collider.
+			AABB aabb;
+			GetAABB(transform, collider, &aabb.min, &aabb.max);
+
+			const RigidBody *rigidBody = GetEntityRigidBody(gameState, collider->entityHandle);
+			if (deltaTime > 0 && rigidBody && rigidBody->continuousCollision && !rigidBody->sleeping)
+			{
+				// Add the box moved to where it'll end up, gravity included, grown by how far any
+				// of it can get from turning.
+				const RigidBodyMotion *rigidBodyMotion = &gameState->rigidBodyMotion;
+				const u32 rigidBodyIdx = RigidBodyIndex(gameState, rigidBody);
+				v3 motion = V3SoAGet(&rigidBodyMotion->velocity, rigidBodyIdx) * deltaTime;
+				motion.z -= GRAVITY * deltaTime * deltaTime;
+				f32 turn = V3Length(V3SoAGet(&rigidBodyMotion->angularVelocity, rigidBodyIdx)) *
+					deltaTime * ColliderBoundingRadius(collider);
+				v3 endMin = aabb.min + motion - v3{ turn, turn, turn };
+				v3 endMax = aabb.max + motion + v3{ turn, turn, turn };
+				aabb.min = { Min(aabb.min.x, endMin.x), Min(aabb.min.y, endMin.y),
+					Min(aabb.min.z, endMin.z) };
+				aabb.max = { Max(aabb.max.x, endMax.x), Max(aabb.max.y, endMax.y),
+					Max(aabb.max.z, endMax.z) };
+			}
+			AABBSoASet(&AABBs, colliderIdx, aabb);
+		}
+	});
+	return AABBs;
+}
+
+void BroadphaseUpdateTree(GameState *gameState, const AABBSoA *AABBs)
+{
+	AABBTree *tree = &gameState->broadphase.tree;
+	u32 reinsertCount = 0;
+	for (u32 colliderIdx = 0; colliderIdx < AABBs->count; ++colliderIdx)
+	{
+		u32 entityId = gameState->colliders[colliderIdx].entityHandle.id;
+		if (AABBTreeUpdate(tree, entityId, AABBSoAGet(AABBs, colliderIdx)))
+			++reinsertCount;
+	}
+	gameState->broadphase.stats.treeReinsertCount = reinsertCount;
+}
+
+void BroadphaseRefreshTree(GameState *gameState)
+{
+	if (!gameState->broadphase.treeOutdated)
+		return;
+	AABBSoA AABBs = BroadphaseComputeAABBs(gameState);
+	BroadphaseUpdateTree(gameState, &AABBs);
+	gameState->broadphase.treeOutdated = false;
+}
+
+u32 AABBOverlapBatch(const AABBSoA *soa, u32 beginIdx, u32 endIdx, AABB aabb, u32 *outIndices)
+{
+	ASSERT(endIdx <= soa->count);
+	if (beginIdx >= endIdx)
+		return 0;
+
+	const __m256 minX = _mm256_set1_ps(aabb.min.x);
+	const __m256 minY = _mm256_set1_ps(aabb.min.y);
+	const __m256 minZ = _mm256_set1_ps(aabb.min.z);
+	const __m256 maxX = _mm256_set1_ps(aabb.max.x);
+	const __m256 maxY = _mm256_set1_ps(aabb.max.y);
+	const __m256 maxZ = _mm256_set1_ps(aabb.max.z);
+
+	u32 outCount = 0;
+	// Start at the group beginIdx falls in, and mask off what's outside the range.
+	for (u32 groupIdx = beginIdx & ~7; groupIdx < endIdx; groupIdx += 8)
+	{
+		__m256 test = _mm256_and_ps(
+				_mm256_cmp_ps(minX, *(__m256 *)&soa->maxX[groupIdx], _CMP_LE_OQ),
+				_mm256_cmp_ps(*(__m256 *)&soa->minX[groupIdx], maxX, _CMP_LE_OQ));
+		test = _mm256_and_ps(test, _mm256_cmp_ps(minY, *(__m256 *)&soa->maxY[groupIdx], _CMP_LE_OQ));
+		test = _mm256_and_ps(test, _mm256_cmp_ps(*(__m256 *)&soa->minY[groupIdx], maxY, _CMP_LE_OQ));
+		test = _mm256_and_ps(test, _mm256_cmp_ps(minZ, *(__m256 *)&soa->maxZ[groupIdx], _CMP_LE_OQ));
+		test = _mm256_and_ps(test, _mm256_cmp_ps(*(__m256 *)&soa->minZ[groupIdx], maxZ, _CMP_LE_OQ));
+		u32 mask = _mm256_movemask_ps(test);
+
+		if (groupIdx < beginIdx)
+			mask &= 0xFF << (beginIdx - groupIdx);
+		if (groupIdx + 8 > endIdx)
+			mask &= 0xFF >> (groupIdx + 8 - endIdx);
+
+		while (mask)
+		{
+			outIndices[outCount++] = groupIdx + Ntz(mask);
+			mask &= mask - 1;
+		}
+	}
+	return outCount;
+}
+
+inline bool SAPEndpointLess(SAPEndpoint a, SAPEndpoint b)
+{
+	// On ties min endpoints go first, so touching boxes are still reported like TestAABBs does.
+	if (a.value != b.value)
+		return a.value < b.value;
+	return (a.data & SAP_ENDPOINT_MAX_BIT) < (b.data & SAP_ENDPOINT_MAX_BIT);
+}
+
+inline void BroadphaseAddPair(GameState *gameState, DynamicArray<BroadphasePair, FrameAllocator> *pairs,
+		u32 colliderAIdx, u32 colliderBIdx)
+{
+	u32 entityAId = gameState->colliders[colliderAIdx].entityHandle.id;
+	u32 entityBId = gameState->colliders[colliderBIdx].entityHandle.id;
+	if (entityAId < entityBId)
+		*DynamicArrayAdd(pairs) = { colliderAIdx, colliderBIdx };
+	else
+		*DynamicArrayAdd(pairs) = { colliderBIdx, colliderAIdx };
+}
+
+void SweepAndPruneFindPairs(GameState *gameState, const AABBSoA *AABBs,
+		DynamicArray<BroadphasePair, FrameAllocator> *pairs, BroadphaseStats *stats)
+{
+	SweepAndPrune *sap = &gameState->broadphase.sweepAndPrune;
+	ASSERT(sap->endpoints.count == AABBs->count * 2);
+
+	// Refresh endpoint values
+	for (u32 endpointIdx = 0; endpointIdx < sap->endpoints.count; ++endpointIdx)
+	{
+		SAPEndpoint *endpoint = &sap->endpoints[endpointIdx];
+		u32 entityId = endpoint->data & ~SAP_ENDPOINT_MAX_BIT;
+		u32 colliderIdx = gameState->entityColliders[entityId];
+		ASSERT(colliderIdx != ENTITY_ID_INVALID);
+		// Clamp so empty boxes can't put the max endpoint before the min.
+		f32 minX = AABBs->minX[colliderIdx];
+		endpoint->value = (endpoint->data & SAP_ENDPOINT_MAX_BIT) ?
+			Max(minX, AABBs->maxX[colliderIdx]) : minX;
+	}
+
+	// Insertion sort
+	u32 swapCount = 0;
+	SAPEndpoint *endpoints = sap->endpoints.data;
+	for (u32 i = 1; i < sap->endpoints.count; ++i)
+	{
+		SAPEndpoint endpoint = endpoints[i];
+		u32 j = i;
+		for (; j > 0 && SAPEndpointLess(endpoint, endpoints[j - 1]); --j)
+			endpoints[j] = endpoints[j - 1];
+		endpoints[j] = endpoint;
+		swapCount += i - j;
+	}
+	stats->sortSwapCount = swapCount;
+
+	// Sweep
+	u32 *activeColliders = ALLOC_N(FrameAllocator, u32, AABBs->count);
+	u32 activeCount = 0;
+	// Position of each collider in activeColliders, for constant time removal
+	u32 *activeSlots = ALLOC_N(FrameAllocator, u32, AABBs->count);
+	for (u32 endpointIdx = 0; endpointIdx < sap->endpoints.count; ++endpointIdx)
+	{
+		SAPEndpoint endpoint = endpoints[endpointIdx];
+		u32 entityId = endpoint.data & ~SAP_ENDPOINT_MAX_BIT;
+		u32 colliderIdx = gameState->entityColliders[entityId];
+
+		if (endpoint.data & SAP_ENDPOINT_MAX_BIT)
+		{
+			u32 slot = activeSlots[colliderIdx];
+			u32 lastColliderIdx = activeColliders[--activeCount];
+			activeColliders[slot] = lastColliderIdx;
+			activeSlots[lastColliderIdx] = slot;
+			continue;
+		}
+
+		// Everything in the active list overlaps on X, only check the other two axes.
+		const f32 minY = AABBs->minY[colliderIdx];
+		const f32 minZ = AABBs->minZ[colliderIdx];
+		const f32 maxY = AABBs->maxY[colliderIdx];
+		const f32 maxZ = AABBs->maxZ[colliderIdx];
+		for (u32 activeIdx = 0; activeIdx < activeCount; ++activeIdx)
+		{
+			u32 otherColliderIdx = activeColliders[activeIdx];
+			if (minY <= AABBs->maxY[otherColliderIdx] && AABBs->minY[otherColliderIdx] <= maxY &&
+				minZ <= AABBs->maxZ[otherColliderIdx] && AABBs->minZ[otherColliderIdx] <= maxZ)
+				BroadphaseAddPair(gameState, pairs, colliderIdx, otherColliderIdx);
+		}
+
+		activeSlots[colliderIdx] = activeCount;
+		activeColliders[activeCount++] = colliderIdx;
+	}
+	ASSERT(activeCount == 0);
+}
+
+void AABBTreeFindPairs(GameState *gameState, const AABBSoA *AABBs,
+		DynamicArray<BroadphasePair, FrameAllocator> *pairs)
+{
+	const AABBTree *tree = &gameState->broadphase.tree;
+	if (tree->root == AABB_TREE_NULL)
+		return;
+
+	// Traverse the tree against itself, so every overlapping pair of nodes is only visited once.
+	// A pair with the same node twice stands for that node's subtree against itself.
+	struct NodePair
+	{
+		u32 a;
+		u32 b;
+	};
+	DynamicArray<NodePair, FrameAllocator> stack;
+	DynamicArrayInit(&stack, 64);
+	*DynamicArrayAdd(&stack) = { tree->root, tree->root };
+	while (stack.count)
+	{
+		NodePair nodePair = stack[--stack.count];
+		const AABBTreeNode *nodeA = &tree->nodes[nodePair.a];
+		bool isLeafA = AABBTreeIsLeaf(nodeA);
+
+		if (nodePair.a == nodePair.b)
+		{
+			if (isLeafA)
+				continue;
+			*DynamicArrayAdd(&stack) = { nodeA->children[0], nodeA->children[0] };
+			*DynamicArrayAdd(&stack) = { nodeA->children[1], nodeA->children[1] };
+			*DynamicArrayAdd(&stack) = { nodeA->children[0], nodeA->children[1] };
+			continue;
+		}
+
+		const AABBTreeNode *nodeB = &tree->nodes[nodePair.b];
+		if (!AABBOverlap(nodeA->aabb, nodeB->aabb))
+			continue;
+
+		bool isLeafB = AABBTreeIsLeaf(nodeB);
+		if (isLeafA && isLeafB)
+		{
+			// Leaves are fat, test against the actual boxes.
+			u32 colliderAIdx = gameState->entityColliders[nodeA->entityId];
+			u32 colliderBIdx = gameState->entityColliders[nodeB->entityId];
+			if (AABBOverlap(AABBSoAGet(AABBs, colliderAIdx), AABBSoAGet(AABBs, colliderBIdx)))
+				BroadphaseAddPair(gameState, pairs, colliderAIdx, colliderBIdx);
+		}
+		// Descend into the bigger node
+		else if (isLeafB || (!isLeafA && nodeA->height >= nodeB->height))
+		{
+			*DynamicArrayAdd(&stack) = { nodeA->children[0], nodePair.b };
+			*DynamicArrayAdd(&stack) = { nodeA->children[1], nodePair.b };
+		}
+		else
+		{
+			*DynamicArrayAdd(&stack) = { nodePair.a, nodeB->children[0] };
+			*DynamicArrayAdd(&stack) = { nodePair.a, nodeB->children[1] };
+		}
+	}
+}
+
+// Parallel pair finding keeps pairs per ParallelFor chunk, appending the chunks in order gives the
+// same result whichever thread ran each one.
+typedef DynamicArray<BroadphasePair, FrameAllocator> BroadphaseChunkPairs;
+
+inline void BroadphaseAppendChunkPairs(DynamicArray<BroadphasePair, FrameAllocator> *pairs,
+		const BroadphaseChunkPairs *chunkPairs, u32 chunkCount)
+{
+	for (u32 chunkIdx = 0; chunkIdx < chunkCount; ++chunkIdx)
+		for (u32 pairIdx = 0; pairIdx < chunkPairs[chunkIdx].count; ++pairIdx)
+			*DynamicArrayAdd(pairs) = chunkPairs[chunkIdx][pairIdx];
+}
+
+inline u32 HashGridCellHash(s32 x, s32 y, s32 z)
+{
+	return Hash(((u32)x * 73856093) ^ ((u32)y * 19349663) ^ ((u32)z * 83492791));
+}
+
+const u32 HASH_GRID_SLOTS_PER_JOB = 1024;
+
+void HashGridFindPairs(GameState *gameState, const AABBSoA *AABBs,
+		DynamicArray<BroadphasePair, FrameAllocator> *pairs, BroadphaseStats *stats)
+{
+	const f32 invCellSize = 1.0f / gameState->broadphase.hashGrid.cellSize;
+
+	// Cell ranges
+	HashGridCellRange *cellRanges = ALLOC_N(FrameAllocator, HashGridCellRange, AABBs->count);
+	Array<u32, FrameAllocator> oversized;
+	ArrayInit(&oversized, AABBs->count);
+	bool *inGrid = ALLOC_N(FrameAllocator, bool, AABBs->count);
+	bool *isOversized = ALLOC_N(FrameAllocator, bool, AABBs->count);
+	u32 entryCount = 0;
+	for (u32 colliderIdx = 0; colliderIdx < AABBs->count; ++colliderIdx)
+	{
+		const AABB aabb = AABBSoAGet(AABBs, colliderIdx);
+		inGrid[colliderIdx] = false;
+		isOversized[colliderIdx] = false;
+
+		// Empty boxes never overlap anything
+		if (aabb.min.x > aabb.max.x || aabb.min.y > aabb.max.y || aabb.min.z > aabb.max.z)
+			continue;
+
+		bool tooBig = false;
+		for (int i = 0; i < 3; ++i)
+			tooBig = tooBig || (aabb.max.v[i] - aabb.min.v[i]) * invCellSize > HASH_GRID_MAX_CELL_SPAN;
+		if (tooBig)
+		{
+			*ArrayAdd(&oversized) = colliderIdx;
+			isOversized[colliderIdx] = true;
+			continue;
+		}
+
+		HashGridCellRange *range = &cellRanges[colliderIdx];
+		u32 cellCount = 1;
+		for (int i = 0; i < 3; ++i)
+		{
+			range->min[i] = (s32)Floor(aabb.min.v[i] * invCellSize);
+			range->max[i] = (s32)Floor(aabb.max.v[i] * invCellSize);
+			cellCount *= range->max[i] - range->min[i] + 1;
+		}
+		entryCount += cellCount;
+		inGrid[colliderIdx] = true;
+	}
+
+	// Fill the table
+	const u32 capacity = NextPowerOf2(Max(entryCount * 2, 32));
+	const u32 mask = capacity - 1;
+	HashGridCell *cells = ALLOC_N(FrameAllocator, HashGridCell, capacity);
+	for (u32 slotIdx = 0; slotIdx < capacity; ++slotIdx)
+		cells[slotIdx].firstEntry = U32_MAX;
+	HashGridEntry *entries = ALLOC_N(FrameAllocator, HashGridEntry, entryCount);
+	u32 usedEntries = 0;
+	u32 usedCells = 0;
+	for (u32 colliderIdx = 0; colliderIdx < AABBs->count; ++colliderIdx)
+	{
+		if (!inGrid[colliderIdx])
+			continue;
+
+		const HashGridCellRange *range = &cellRanges[colliderIdx];
+		for (s32 z = range->min[2]; z <= range->max[2]; ++z)
+		for (s32 y = range->min[1]; y <= range->max[1]; ++y)
+		for (s32 x = range->min[0]; x <= range->max[0]; ++x)
+		{
+			u32 slotIdx = HashGridCellHash(x, y, z) & mask;
+			HashGridCell *cell;
+			while (true)
+			{
+				cell = &cells[slotIdx];
+				if (cell->firstEntry == U32_MAX)
+				{
+					cell->x = x;
+					cell->y = y;
+					cell->z = z;
+					++usedCells;
+					break;
+				}
+				if (cell->x == x && cell->y == y && cell->z == z)
+					break;
+				slotIdx = (slotIdx + 1) & mask;
+			}
+
+			HashGridEntry *entry = &entries[usedEntries];
+			entry->colliderIdx = colliderIdx;
+			entry->next = cell->firstEntry;
+			cell->firstEntry = usedEntries++;
+		}
+	}
+	ASSERT(usedEntries == entryCount);
+
+	// Pairs within each cell
+	const u32 chunkCount = (capacity + HASH_GRID_SLOTS_PER_JOB - 1) / HASH_GRID_SLOTS_PER_JOB;
+	BroadphaseChunkPairs *chunkPairs = ALLOC_N(FrameAllocator, BroadphaseChunkPairs, chunkCount);
+	ParallelFor(g_jobSystem, capacity, HASH_GRID_SLOTS_PER_JOB,
+			[gameState, AABBs, cells, entries, cellRanges, chunkPairs](u32 beginIdx, u32 endIdx)
+	{
+		BroadphaseChunkPairs *chunk = &chunkPairs[beginIdx / HASH_GRID_SLOTS_PER_JOB];
+		DynamicArrayInit(chunk, 32);
+		for (u32 slotIdx = beginIdx; slotIdx < endIdx; ++slotIdx)
+		{
+			const HashGridCell *cell = &cells[slotIdx];
+			for (u32 entryA = cell->firstEntry; entryA != U32_MAX; entryA = entries[entryA].next)
+			{
+				u32 colliderAIdx = entries[entryA].colliderIdx;
+				const HashGridCellRange *rangeA = &cellRanges[colliderAIdx];
+				for (u32 entryB = entries[entryA].next; entryB != U32_MAX;
+						entryB = entries[entryB].next)
+				{
+					u32 colliderBIdx = entries[entryB].colliderIdx;
+					const HashGridCellRange *rangeB = &cellRanges[colliderBIdx];
+
+					// Boxes sharing several cells would be found once per cell. Only report them from
+					// the cell holding the min corner of their intersection.
+					if (Max(rangeA->min[0], rangeB->min[0]) != cell->x ||
+						Max(rangeA->min[1], rangeB->min[1]) != cell->y ||
+						Max(rangeA->min[2], rangeB->min[2]) != cell->z)
+						continue;
+
+					if (AABBOverlap(AABBSoAGet(AABBs, colliderAIdx), AABBSoAGet(AABBs, colliderBIdx)))
+						BroadphaseAddPair(gameState, chunk, colliderAIdx, colliderBIdx);
+				}
+			}
+		}
+	});
+	BroadphaseAppendChunkPairs(pairs, chunkPairs, chunkCount);
+
+	// Oversized boxes against everything else
+	u32 *overlaps = ALLOC_N(FrameAllocator, u32, AABBs->count);
+	for (u32 oversizedIdx = 0; oversizedIdx < oversized.count; ++oversizedIdx)
+	{
+		u32 colliderAIdx = oversized[oversizedIdx];
+		u32 overlapCount = AABBOverlapBatch(AABBs, 0, AABBs->count, AABBSoAGet(AABBs, colliderAIdx),
+				overlaps);
+		for (u32 overlapIdx = 0; overlapIdx < overlapCount; ++overlapIdx)
+		{
+			// Pairs of oversized boxes only once
+			u32 colliderBIdx = overlaps[overlapIdx];
+			if (!inGrid[colliderBIdx] && (!isOversized[colliderBIdx] || colliderBIdx <= colliderAIdx))
+				continue;
+
+			BroadphaseAddPair(gameState, pairs, colliderAIdx, colliderBIdx);
+		}
+	}
+
+	stats->hashGridCellCount = usedCells;
+	stats->hashGridOversizedCount = oversized.count;
+}
+
+const u32 ALL_PAIRS_BOXES_PER_JOB = 32;
+
+void AllPairsFindPairs(GameState *gameState, const AABBSoA *AABBs,
+		DynamicArray<BroadphasePair, FrameAllocator> *pairs)
+{
+	// Earlier boxes get tested against more others, small chunks let stealing even that out.
+	const u32 chunkCount = (AABBs->count + ALL_PAIRS_BOXES_PER_JOB - 1) / ALL_PAIRS_BOXES_PER_JOB;
+	BroadphaseChunkPairs *chunkPairs = ALLOC_N(FrameAllocator, BroadphaseChunkPairs, chunkCount);
+	ParallelFor(g_jobSystem, AABBs->count, ALL_PAIRS_BOXES_PER_JOB,
+			[gameState, AABBs, chunkPairs](u32 beginIdx, u32 endIdx)
+	{
+		BroadphaseChunkPairs *chunk = &chunkPairs[beginIdx / ALL_PAIRS_BOXES_PER_JOB];
+		DynamicArrayInit(chunk, 32);
+		u32 *overlaps = ALLOC_N(FrameAllocator, u32, AABBs->count);
+		for (u32 colliderAIdx = beginIdx; colliderAIdx < endIdx; ++colliderAIdx)
+		{
+			u32 overlapCount = AABBOverlapBatch(AABBs, colliderAIdx + 1, AABBs->count,
+					AABBSoAGet(AABBs, colliderAIdx), overlaps);
+			for (u32 overlapIdx = 0; overlapIdx < overlapCount; ++overlapIdx)
+				BroadphaseAddPair(gameState, chunk, colliderAIdx, overlaps[overlapIdx]);
+		}
+	});
+	BroadphaseAppendChunkPairs(pairs, chunkPairs, chunkCount);
+}
+
+#if DEBUG_BUILD
+// Check the current mode finds exactly the same pairs as testing all of them one by one.
+void BroadphaseValidatePairs(GameState *gameState, const AABBSoA *AABBs,
+		ArrayView<const BroadphasePair> pairs)
+{
+	DynamicArray<BroadphasePair, FrameAllocator> reference;
+	DynamicArrayInit(&reference, Max(pairs.count, 32));
+	for (u32 colliderAIdx = 0; colliderAIdx < AABBs->count; ++colliderAIdx)
+		for (u32 colliderBIdx = colliderAIdx + 1; colliderBIdx < AABBs->count; ++colliderBIdx)
+			if (AABBOverlap(AABBSoAGet(AABBs, colliderAIdx), AABBSoAGet(AABBs, colliderBIdx)))
+				BroadphaseAddPair(gameState, &reference, colliderAIdx, colliderBIdx);
+
+	HashSet<CollisionPair, FrameAllocator> found;
+	HashSetInit(&found, NextPowerOf2(Max(pairs.count * 2, 32)));
+	for (u32 pairIdx = 0; pairIdx < pairs.count; ++pairIdx)
+	{
+		CollisionPair key = {
+			gameState->colliders[pairs[pairIdx].colliderA].entityHandle,
+			gameState->colliders[pairs[pairIdx].colliderB].entityHandle
+		};
+		if (!HashSetAdd(&found, key))
+			Log("ERROR! Broadphase: pair %u-%u reported more than once\n", key.a.id, key.b.id);
+	}
+
+	u32 missing = 0;
+	for (u32 pairIdx = 0; pairIdx < reference.count; ++pairIdx)
+	{
+		CollisionPair key = {
+			gameState->colliders[reference[pairIdx].colliderA].entityHandle,
+			gameState->colliders[reference[pairIdx].colliderB].entityHandle
+		};
+		if (!HashSetHas(found, key))
+			++missing;
+	}
+
+	if (missing || reference.count != pairs.count)
+		Log("ERROR! Broadphase: found %u pairs, expected %u (%u missing)\n", pairs.count,
+				(u32)reference.count, missing);
+}
+#endif
+
+// Radix sorts the pairs by the entity ids of their colliders, so they come out the same whatever
+// the broadphase mode and however the collider array is laid out.
+void BroadphaseSortPairs(GameState *gameState, DynamicArray<BroadphasePair, FrameAllocator> *pairs)
+{
+	static_assert(MAX_ENTITIES <= 4096, "pair keys pack two entity ids in 24 bits");
+	const u32 pairCount = (u32)pairs->count;
+	u32 *keys = ALLOC_N(FrameAllocator, u32, pairCount);
+	u32 *sortedKeys = ALLOC_N(FrameAllocator, u32, pairCount);
+	BroadphasePair *sortedPairs = ALLOC_N(FrameAllocator, BroadphasePair, pairCount);
+	for (u32 pairIdx = 0; pairIdx < pairCount; ++pairIdx)
+	{
+		BroadphasePair pair = (*pairs)[pairIdx];
+		keys[pairIdx] = (gameState->colliders[pair.colliderA].entityHandle.id << 12) |
+			gameState->colliders[pair.colliderB].entityHandle.id;
+	}
+
+	BroadphasePair *from = pairs->data;
+	BroadphasePair *to = sortedPairs;
+	for (u32 shift = 0; shift < 24; shift += 8)
+	{
+		u32 offsets[256] = {};
+		for (u32 pairIdx = 0; pairIdx < pairCount; ++pairIdx)
+			++offsets[(keys[pairIdx] >> shift) & 0xFF];
+		u32 total = 0;
+		for (u32 bucket = 0; bucket < 256; ++bucket)
+		{
+			u32 count = offsets[bucket];
+			offsets[bucket] = total;
+			total += count;
+		}
+		for (u32 pairIdx = 0; pairIdx < pairCount; ++pairIdx)
+		{
+			u32 destIdx = offsets[(keys[pairIdx] >> shift) & 0xFF]++;
+			sortedKeys[destIdx] = keys[pairIdx];
+			to[destIdx] = from[pairIdx];
+		}
+		u32 *swapKeys = keys;
+		keys = sortedKeys;
+		sortedKeys = swapKeys;
+		BroadphasePair *swapPairs = from;
+		from = to;
+		to = swapPairs;
+	}
+	// Three passes leave the result in the scratch array.
+	memcpy(pairs->data, from, sizeof(BroadphasePair) * pairCount);
+}
+
+DynamicArray<BroadphasePair, FrameAllocator> BroadphaseFindPairs(GameState *gameState,
+		const AABBSoA *AABBs)
+{
+	BroadphaseStats *stats = &gameState->broadphase.stats;
+	u64 startCounter = PlatformGetPerformanceCounter();
+
+	DynamicArray<BroadphasePair, FrameAllocator> pairs;
+	DynamicArrayInit(&pairs, Max(AABBs->count, 32));
+
+	BroadphaseUpdateTree(gameState, AABBs);
+	// Those are this step's swept boxes, and everything's about to move.
+	gameState->broadphase.treeOutdated = true;
+
+	switch (gameState->broadphase.mode)
+	{
+	case BROADPHASE_SWEEP_AND_PRUNE:
+	{
+		SweepAndPruneFindPairs(gameState, AABBs, &pairs, stats);
+	} break;
+	case BROADPHASE_AABB_TREE:
+	{
+		AABBTreeFindPairs(gameState, AABBs, &pairs);
+	} break;
+	case BROADPHASE_HASH_GRID:
+	{
+		HashGridFindPairs(gameState, AABBs, &pairs, stats);
+	} break;
+	case BROADPHASE_ALL_PAIRS:
+	{
+		AllPairsFindPairs(gameState, AABBs, &pairs);
+	} break;
+	default:
+	{
+		ASSERT(false);
+	}
+	}
+
+	if (gameState->deterministicPhysics)
+		BroadphaseSortPairs(gameState, &pairs);
+
+	stats->colliderCount = AABBs->count;
+	stats->candidatePairCount = (u32)pairs.count;
+	stats->lastStepTime = (f32)(PlatformGetPerformanceCounter() - startCounter) /
+		(f32)PlatformGetPerformanceFrequency();
+
+#if DEBUG_BUILD
+	if (g_debugContext->validateBroadphase)
+		BroadphaseValidatePairs(gameState, AABBs, pairs);
+
+	if (g_debugContext->drawAABBs)
+	{
+		for (u32 colliderIdx = 0; colliderIdx < AABBs->count; ++colliderIdx)
+		{
+			const AABB aabb = AABBSoAGet(AABBs, colliderIdx);
+			DrawDebugWiredBox(aabb.min, aabb.max, {0.7f,0,0});
+		}
+		for (u32 pairIdx = 0; pairIdx < pairs.count; ++pairIdx)
+		{
+			const AABB aabbA = AABBSoAGet(AABBs, pairs[pairIdx].colliderA);
+			const AABB aabbB = AABBSoAGet(AABBs, pairs[pairIdx].colliderB);
+			DrawDebugWiredBox(aabbA.min, aabbA.max, {0,0.9f,0});
+			DrawDebugWiredBox(aabbB.min, aabbB.max, {0,0.9f,0});
+		}
+	}
+#endif
+
+	return pairs;
+}
+
+// Times every box against every other with each overlap test we have: scalar, the one box SSE test
+// from Collision.cpp and AABBOverlapBatch.
+void BroadphaseBenchmarkAABBKernels()
+{
+	const u32 boxCount = 2048;
+	Array<AABB, FrameAllocator> boxes;
+	ArrayInit(&boxes, boxCount);
+	u32 seed = 0x9E3779B9;
+	for (u32 boxIdx = 0; boxIdx < boxCount; ++boxIdx)
+	{
+		v3 center = v3{ XorShift32F32(&seed), XorShift32F32(&seed), XorShift32F32(&seed) } * 32.0f;
+		f32 halfSize = 0.25f + XorShift32F32(&seed);
+		*ArrayAdd(&boxes) = { center - v3{ halfSize, halfSize, halfSize },
+			center + v3{ halfSize, halfSize, halfSize } };
+	}
+	AABBSoA soa = AABBSoAFromArray(boxes);
+	u32 *overlaps = ALLOC_N(FrameAllocator, u32, boxCount);
+
+#if DEBUG_BUILD
+	// TestAABBs draws the boxes when this is on
+	bool oldDrawAABBs = g_debugContext->drawAABBs;
+	g_debugContext->drawAABBs = false;
+#endif
+
+	const f64 frequency = (f64)PlatformGetPerformanceFrequency();
+
+	u64 start = PlatformGetPerformanceCounter();
+	u64 scalarHits = 0;
+	for (u32 boxAIdx = 0; boxAIdx < boxCount; ++boxAIdx)
+		for (u32 boxBIdx = 0; boxBIdx < boxCount; ++boxBIdx)
+			scalarHits += AABBOverlap(boxes[boxAIdx], boxes[boxBIdx]);
+	f64 scalarTime = (PlatformGetPerformanceCounter() - start) / frequency;
+
+	start = PlatformGetPerformanceCounter();
+	u64 SSEHits = 0;
+	for (u32 boxAIdx = 0; boxAIdx < boxCount; ++boxAIdx)
+		for (u32 boxBIdx = 0; boxBIdx < boxCount; ++boxBIdx)
+			SSEHits += TestAABBs(boxes[boxAIdx].min, boxes[boxAIdx].max, boxes[boxBIdx].min,
+					boxes[boxBIdx].max);
+	f64 SSETime = (PlatformGetPerformanceCounter() - start) / frequency;
+
+	start = PlatformGetPerformanceCounter();
+	u64 AVX2Hits = 0;
+	for (u32 boxAIdx = 0; boxAIdx < boxCount; ++boxAIdx)
+		AVX2Hits += AABBOverlapBatch(&soa, 0, boxCount, boxes[boxAIdx], overlaps);
+	f64 AVX2Time = (PlatformGetPerformanceCounter() - start) / frequency;
+
+#if DEBUG_BUILD
+	g_debugContext->drawAABBs = oldDrawAABBs;
+#endif
+
+	Log("AABB overlap, %u x %u boxes: scalar %.3f ms, SSE %.3f ms, AVX2 batch %.3f ms\n",
+			boxCount, boxCount, scalarTime * 1000.0, SSETime * 1000.0, AVX2Time * 1000.0);
+	if (scalarHits != SSEHits || scalarHits != AVX2Hits)
+		Log("ERROR! AABB overlap kernels disagree: scalar %llu, SSE %llu, AVX2 batch %llu hits\n",
+				scalarHits, SSEHits, AVX2Hits);
+}
@@ -0,0 +1,125 @@
+struct GameState;
+
+enum BroadphaseMode
+{
+	BROADPHASE_SWEEP_AND_PRUNE,
+	BROADPHASE_AABB_TREE,
+	BROADPHASE_HASH_GRID,
+	// Tests every pair of boxes, eight at a time.
+	BROADPHASE_ALL_PAIRS,
+	BROADPHASE_MODE_COUNT
+};
+
+// Build with e.g. -DBROADPHASE_DEFAULT_MODE=BROADPHASE_HASH_GRID to start with another mode.
+#ifndef BROADPHASE_DEFAULT_MODE
+#define BROADPHASE_DEFAULT_MODE BROADPHASE_SWEEP_AND_PRUNE
+#endif
+
+// Boxes as structure of arrays, the layout every broadphase mode reads the per-step boxes in. Each
+// array is 32 byte aligned and padded to a multiple of 8 with empty boxes.
+struct AABBSoA
+{
+	f32 *minX, *minY, *minZ;
+	f32 *maxX, *maxY, *maxZ;
+	u32 count;
+};
+
+inline AABB AABBSoAGet(const AABBSoA *soa, u32 idx)
+{
+	return { { soa->minX[idx], soa->minY[idx], soa->minZ[idx] },
+		{ soa->maxX[idx], soa->maxY[idx], soa->maxZ[idx] } };
+}
+
+struct BroadphasePair
+{
+	// Indices into gameState->colliders for the current step. The collider whose entity has the
+	// lowest id always goes first, so pairs keep the same orientation across frames.
+	u32 colliderA;
+	u32 colliderB;
+};
+
+// Sort-and-sweep along the X axis. The endpoint list persists across frames, and since bodies
+// barely move from one step to the next it stays almost sorted, which makes insertion sort
+// effectively linear.
+struct SAPEndpoint
+{
+	f32 value;
+	// Entity id in the lower bits, SAP_ENDPOINT_MAX_BIT set for max endpoints.
+	u32 data;
+};
+const u32 SAP_ENDPOINT_MAX_BIT = 0x80000000;
+
+struct SweepAndPrune
+{
+	Array<SAPEndpoint, TransientAllocator> endpoints;
+};
+
+// Uniform grid hashed on integer cell coordinates, rebuilt every step. Meant for lots of bodies of
+// similar size, with cells about as big as the bodies. Anything spanning more than
+// HASH_GRID_MAX_CELL_SPAN cells on an axis is kept out of the grid and tested against everything.
+const f32 HASH_GRID_DEFAULT_CELL_SIZE = 2.0f;
+const u32 HASH_GRID_MAX_CELL_SPAN = 4;
+
+struct HashGridCell
+{
+	s32 x, y, z;
+	// Head of this cell's entry list, U32_MAX for empty slots.
+	u32 firstEntry;
+};
+
+// Cells covered by a box, inclusive.
+struct HashGridCellRange
+{
+	s32 min[3];
+	s32 max[3];
+};
+
+struct HashGridEntry
+{
+	u32 colliderIdx;
+	u32 next;
+};
+
+struct HashGrid
+{
+	f32 cellSize;
+};
+
+struct BroadphaseStats
+{
+	u32 colliderCount;
+	u32 candidatePairCount;
+	u32 sortSwapCount;
+	u32 treeReinsertCount;
+	u32 hashGridCellCount;
+	u32 hashGridOversizedCount;
+	f32 lastStepTime;
+};
+
+struct Broadphase
+{
+	BroadphaseMode mode;
+	SweepAndPrune sweepAndPrune;
+	// Kept up to date in every mode, it's also used for ray and overlap queries.
+	AABBTree tree;
+	// Something moved since the tree last matched where things are, see BroadphaseRefreshTree.
+	bool treeOutdated;
+	HashGrid hashGrid;
+	BroadphaseStats stats;
+};
+
+void BroadphaseInit(Broadphase *broadphase);
+void BroadphaseAddCollider(GameState *gameState, EntityHandle entityHandle);
+void BroadphaseRemoveCollider(GameState *gameState, EntityHandle entityHandle);
+// Bodies with continuous collision get theirs stretched over where they'll move in deltaTime.
+AABBSoA BroadphaseComputeAABBs(GameState *gameState, f32 deltaTime = 0);
+void BroadphaseUpdateTree(GameState *gameState, const AABBSoA *AABBs);
+// Brings the tree up to date with where things are for scene queries, if it's outdated.
+void BroadphaseRefreshTree(GameState *gameState);
+AABBSoA AABBSoAFromArray(ArrayView<const AABB> AABBs);
+// Writes the indices in [beginIdx, endIdx) of the boxes overlapping aabb to outIndices, which needs
+// room for endIdx - beginIdx entries. Returns how many were written.
+u32 AABBOverlapBatch(const AABBSoA *soa, u32 beginIdx, u32 endIdx, AABB aabb, u32 *outIndices);
+void BroadphaseBenchmarkAABBKernels();
+DynamicArray<BroadphasePair, FrameAllocator> BroadphaseFindPairs(GameState *gameState,
+		const AABBSoA *AABBs);
@@ -17,6 +17,10 @@ struct GJKResult
 {
 	bool hit;
 	GJKPoint points[4];
+	// Last direction searched, on a miss it's a separating axis.
+	v3 searchDir;
+	// Support evaluations, including the initial one.
+	int iterations;
 };
 
 struct EPAFace
@@ -26,12 +30,6 @@ struct EPAFace
 	GJKPoint c;
 };
 
-struct EPAEdge
-{
-	GJKPoint a;
-	GJKPoint b;
-};
-
 struct CollisionInfo
 {
 	int hitCount;
@@ -55,9 +53,11 @@ inline bool operator==(const CollisionPair& lhs, const CollisionPair& rhs)
 }
 inline u32 Hash(CollisionPair key)
 {
-	u32 hash = Hash(key.a.id);
-	hash ^= Hash(key.b.id);
-	return hash;
+	// Ids are below MAX_ENTITIES, so the generation fits in the top bits. Combined unevenly so (a, b)
+	// and (b, a) don't land on the same slot.
+	u32 hashA = Hash(key.a.id ^ ((u32)key.a.generation << 24));
+	u32 hashB = Hash(key.b.id ^ ((u32)key.b.generation << 24));
+	return hashA ^ (hashB + 0x9E3779B9 + (hashA << 6) + (hashA >> 2));
 }
 
 struct CachedHitPoint
@@ -66,12 +66,50 @@ struct CachedHitPoint
 	v3 localB;
 };
 
+// Where GJK got to the last time a pair was tested, the next test of the pair starts from here.
+struct GJKCache
+{
+	// After a hit, the simplex that enclosed the origin as points local to each collider.
+	bool hasSimplex;
+	v3 localOnA[4];
+	v3 localOnB[4];
+	// After a miss it's a separating axis.
+	v3 searchDir;
+	// Last support vertices, for colliders that are convex hulls.
+	u32 hullVertexA;
+	u32 hullVertexB;
+};
+
+// What's kept about a pair of colliders from one physics step to the next. Pairs that go a step
+// without being tested are evicted.
+struct ContactManifold
+{
+	FixedArray<CachedHitPoint, 8> hitPoints;
+	GJKCache gjkCache;
+	// Physics step the pair was last tested on.
+	u32 lastStep;
+
+	// Solver impulses from the step the pair last made contact on, for warm starting.
+	u32 impulseStep;
+	int impulseCount;
+	v3 impulseNormal;
+	v3 impulseLocalA[8];
+	f32 normalImpulses[8];
+	// World space.
+	v3 tangentImpulses[8];
+};
+
 #if DEBUG_BUILD
-void GenPolytopeMesh(ArrayView<EPAFace> polytope, DebugVertex *outputBuffer, int *vertexCount)
+// Stops at whole faces once maxVertexCount would be exceeded.
+void GenPolytopeMesh(ArrayView<EPAFace> polytope, DebugVertex *outputBuffer, int *vertexCount,
+		int maxVertexCount)
 {
 	*vertexCount = 0;
 	for (u32 faceIdx = 0; faceIdx < polytope.count; ++faceIdx)
 	{
+		if (*vertexCount + 6 > maxVertexCount)
+			break;
+
 		EPAFace *face = &polytope[faceIdx];
 		v3 normal = V3Cross(face->c.dif - face->a.dif, face->b.dif - face->a.dif);
 		f32 normalSqrlen = V3SqrLen(normal);
@@ -203,229 +241,362 @@ v3 BarycentricCoordinates(Triangle *triangle, v3 p)
 	return result;
 }
 
-bool HitTest_CheckCell(GameState *gameState, int cellX, int cellY, bool swapXY, v3 rayOrigin,
-		v3 rayDir, bool infinite, v3 *hit, Triangle *triangle)
+// triangleIdx is block * 8 + lane, as HitTestPacket gives them out.
+Triangle LevelGetTriangle(const ResourceGeometryGrid *geometryGrid, u32 triangleIdx)
+{
+	const LevelTriangleBlock *block = &geometryGrid->bvhTriangleBlocks[triangleIdx / 8];
+	const u32 lane = triangleIdx % 8;
+	Triangle result;
+	result.a = { block->v0X[lane], block->v0Y[lane], block->v0Z[lane] };
+	result.b = result.a + v3{ block->edge1X[lane], block->edge1Y[lane], block->edge1Z[lane] };
+	result.c = result.a + v3{ block->edge2X[lane], block->edge2Y[lane], block->edge2Z[lane] };
+	result.normal = { block->normalX[lane], block->normalY[lane], block->normalZ[lane] };
+	return result;
+}
+
+// Where along the ray it gets into the box, in multiples of rayDir. INFINITY if it misses it or
+// only gets there past maxT.
+inline f32 LevelBVHRayEntry(v3 rayOrigin, v3 invRayDir, f32 maxT, const AABB &aabb)
 {
-	if (swapXY)
+	f32 tMin = 0;
+	f32 tMax = maxT;
+	for (int i = 0; i < 3; ++i)
 	{
-		int tmp = cellX;
-		cellX = cellY;
-		cellY = tmp;
+		f32 t0 = (aabb.min.v[i] - rayOrigin.v[i]) * invRayDir.v[i];
+		f32 t1 = (aabb.max.v[i] - rayOrigin.v[i]) * invRayDir.v[i];
+		tMin = Max(tMin, Min(t0, t1));
+		tMax = Min(tMax, Max(t0, t1));
 	}
+	return tMin <= tMax ? tMin : INFINITY;
+}
 
-	const ResourceGeometryGrid *geometryGrid = &gameState->levelGeometry.geometryGrid->geometryGrid;
-	ASSERT(geometryGrid->cellsSide != 0);
-
-	v2 cellSize = (geometryGrid->highCorner - geometryGrid->lowCorner) / (f32)(geometryGrid->cellsSide);
+// Möller-Trumbore, lane by lane: ray i against triangle i. Either side can have the same value in
+// every lane, for one ray against eight triangles or eight rays against one. Triangles are hit
+// from both sides. Returns the lanes that hit before their maxT, with where they hit in outT.
+inline __m256 RayTriangleAVX2(const __m256 *origin, const __m256 *dir, const __m256 *v0,
+		const __m256 *edge1, const __m256 *edge2, __m256 maxT, __m256 *outT)
+{
+	// p = dir x edge2
+	__m256 pX = _mm256_sub_ps(_mm256_mul_ps(dir[1], edge2[2]), _mm256_mul_ps(dir[2], edge2[1]));
+	__m256 pY = _mm256_sub_ps(_mm256_mul_ps(dir[2], edge2[0]), _mm256_mul_ps(dir[0], edge2[2]));
+	__m256 pZ = _mm256_sub_ps(_mm256_mul_ps(dir[0], edge2[1]), _mm256_mul_ps(dir[1], edge2[0]));
+	__m256 det = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(edge1[0], pX),
+				_mm256_mul_ps(edge1[1], pY)), _mm256_mul_ps(edge1[2], pZ));
+	// Parallel rays and empty lanes divide by zero and fail every comparison below.
+	__m256 invDet = _mm256_div_ps(_mm256_set1_ps(1.0f), det);
+
+	__m256 sX = _mm256_sub_ps(origin[0], v0[0]);
+	__m256 sY = _mm256_sub_ps(origin[1], v0[1]);
+	__m256 sZ = _mm256_sub_ps(origin[2], v0[2]);
+	__m256 u = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sX, pX),
+					_mm256_mul_ps(sY, pY)), _mm256_mul_ps(sZ, pZ)), invDet);
+
+	// q = s x edge1
+	__m256 qX = _mm256_sub_ps(_mm256_mul_ps(sY, edge1[2]), _mm256_mul_ps(sZ, edge1[1]));
+	__m256 qY = _mm256_sub_ps(_mm256_mul_ps(sZ, edge1[0]), _mm256_mul_ps(sX, edge1[2]));
+	__m256 qZ = _mm256_sub_ps(_mm256_mul_ps(sX, edge1[1]), _mm256_mul_ps(sY, edge1[0]));
+	__m256 v = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dir[0], qX),
+					_mm256_mul_ps(dir[1], qY)), _mm256_mul_ps(dir[2], qZ)), invDet);
+	__m256 t = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(edge2[0], qX),
+					_mm256_mul_ps(edge2[1], qY)), _mm256_mul_ps(edge2[2], qZ)), invDet);
+
+	const __m256 zero = _mm256_setzero_ps();
+	__m256 hit = _mm256_and_ps(_mm256_cmp_ps(u, zero, _CMP_GE_OQ), _mm256_cmp_ps(v, zero, _CMP_GE_OQ));
+	hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_add_ps(u, v), _mm256_set1_ps(1.0f), _CMP_LE_OQ));
+	hit = _mm256_and_ps(hit, _mm256_cmp_ps(t, zero, _CMP_GE_OQ));
+	hit = _mm256_and_ps(hit, _mm256_cmp_ps(t, maxT, _CMP_LT_OQ));
+	*outT = t;
+	return hit;
+}
 
-	if (cellX < 0 || cellX >= geometryGrid->cellsSide ||
-		cellY < 0 || cellY >= geometryGrid->cellsSide)
+// Closest level triangle along the ray. Not infinite means just the segment from rayOrigin to
+// rayOrigin + rayDir. Without a level nothing gets hit.
+bool HitTest(const ResourceGeometryGrid *geometryGrid, v3 rayOrigin, v3 rayDir, bool infinite,
+		v3 *hit, Triangle *triangle)
+{
+	if (!geometryGrid || !geometryGrid->bvhNodeCount)
 		return false;
 
-	bool result = false;
-	v3 closestHit = {};
-	Triangle closestTriangle = {};
-	f32 closestSqrLen = INFINITY;
-
-	int offsetIdx = cellX + cellY * geometryGrid->cellsSide;
-	u32 triBegin = geometryGrid->offsets[offsetIdx];
-	u32 triEnd = geometryGrid->offsets[offsetIdx + 1];
-	for (u32 triIdx = triBegin; triIdx < triEnd; ++triIdx)
-	{
-		IndexTriangle *curTriangle = &geometryGrid->triangles[triIdx];
-		Triangle tri =
-		{
-			geometryGrid->positions[curTriangle->a],
-			geometryGrid->positions[curTriangle->b],
-			geometryGrid->positions[curTriangle->c],
-			curTriangle->normal
-		};
+	const v3 invRayDir = { 1.0f / rayDir.x, 1.0f / rayDir.y, 1.0f / rayDir.z };
+	const __m256 origin[3] = { _mm256_set1_ps(rayOrigin.x), _mm256_set1_ps(rayOrigin.y),
+		_mm256_set1_ps(rayOrigin.z) };
+	const __m256 dir[3] = { _mm256_set1_ps(rayDir.x), _mm256_set1_ps(rayDir.y),
+		_mm256_set1_ps(rayDir.z) };
+	f32 closestT = infinite ? INFINITY : 1.0f;
+	u32 closestTriangleIdx = U32_MAX;
 
-#if HITTEST_VISUAL_DEBUG
-		Vertex tri[] =
-		{
-			{tri.a, {}, {}},
-			{tri.b, {}, {}},
-			{tri.c, {}, {}}
-		};
-		DrawDebugTriangles(gameState, tri, 3);
-#endif
+	struct StackEntry
+	{
+		u32 nodeIdx;
+		f32 entryT;
+	};
+	StackEntry stack[LEVEL_BVH_MAX_DEPTH + 2];
+	u32 stackSize = 0;
+	f32 rootEntryT = LevelBVHRayEntry(rayOrigin, invRayDir, closestT, geometryGrid->bvhNodes[0].aabb);
+	if (rootEntryT != INFINITY)
+		stack[stackSize++] = { 0, rootEntryT };
+	while (stackSize)
+	{
+		StackEntry entry = stack[--stackSize];
+		// Something closer might have been hit since this got pushed.
+		if (entry.entryT > closestT)
+			continue;
 
-		v3 thisHit;
-		if (RayTriangleIntersection(rayOrigin, rayDir, infinite, &tri, &thisHit))
+		const LevelBVHNode *node = &geometryGrid->bvhNodes[entry.nodeIdx];
+		if (node->triangleCount)
 		{
-			f32 sqrLen = V3SqrLen(thisHit - rayOrigin);
-			if (sqrLen < closestSqrLen)
+			const u32 blockEnd = node->offset + (node->triangleCount + 7) / 8;
+			for (u32 blockIdx = node->offset; blockIdx < blockEnd; ++blockIdx)
 			{
-				result = true;
-				closestHit = thisHit;
-				closestTriangle = tri;
-				closestSqrLen = sqrLen;
+				const LevelTriangleBlock *block = &geometryGrid->bvhTriangleBlocks[blockIdx];
+				const __m256 v0[3] = { _mm256_load_ps(block->v0X), _mm256_load_ps(block->v0Y),
+					_mm256_load_ps(block->v0Z) };
+				const __m256 edge1[3] = { _mm256_load_ps(block->edge1X),
+					_mm256_load_ps(block->edge1Y), _mm256_load_ps(block->edge1Z) };
+				const __m256 edge2[3] = { _mm256_load_ps(block->edge2X),
+					_mm256_load_ps(block->edge2Y), _mm256_load_ps(block->edge2Z) };
+				__m256 t;
+				__m256 hitMask = RayTriangleAVX2(origin, dir, v0, edge1, edge2,
+						_mm256_set1_ps(closestT), &t);
+				int mask = _mm256_movemask_ps(hitMask);
+				if (!mask)
+					continue;
+
+				f32 ts[8];
+				_mm256_storeu_ps(ts, t);
+				for (int lane = 0; lane < 8; ++lane)
+				{
+					if ((mask & (1 << lane)) && ts[lane] < closestT)
+					{
+						closestT = ts[lane];
+						closestTriangleIdx = blockIdx * 8 + lane;
+					}
+				}
 			}
+			continue;
 		}
-	}
-
-#if HITTEST_VISUAL_DEBUG
-	f32 cellMinX = geometryGrid->lowCorner.x + (cellX) * cellSize.x;
-	f32 cellMaxX = cellMinX + cellSize.x;
-	f32 cellMinY = geometryGrid->lowCorner.y + (cellY) * cellSize.y;
-	f32 cellMaxY = cellMinY + cellSize.y;
-	f32 top = 1;
-	Vertex cellDebugTris[] =
-	{
-		{ { cellMinX, cellMinY, -1 }, {}, {} },
-		{ { cellMinX, cellMinY, top }, {}, {} },
-		{ { cellMaxX, cellMinY, -1 }, {}, {} },
-
-		{ { cellMaxX, cellMinY, -1 }, {}, {} },
-		{ { cellMinX, cellMinY, top }, {}, {} },
-		{ { cellMaxX, cellMinY, top }, {}, {} },
-
-		{ { cellMinX, cellMinY, -1 }, {}, {} },
-		{ { cellMinX, cellMinY, top }, {}, {} },
-		{ { cellMinX, cellMaxY, -1 }, {}, {} },
-
-		{ { cellMinX, cellMaxY, -1 }, {}, {} },
-		{ { cellMinX, cellMinY, top }, {}, {} },
-		{ { cellMinX, cellMaxY, top }, {}, {} },
-
-		{ { cellMinX, cellMaxY, -1 }, {}, {} },
-		{ { cellMinX, cellMaxY, top }, {}, {} },
-		{ { cellMaxX, cellMaxY, -1 }, {}, {} },
-
-		{ { cellMaxX, cellMaxY, -1 }, {}, {} },
-		{ { cellMinX, cellMaxY, top }, {}, {} },
-		{ { cellMaxX, cellMaxY, top }, {}, {} },
-
-		{ { cellMaxX, cellMinY, -1 }, {}, {} },
-		{ { cellMaxX, cellMinY, top }, {}, {} },
-		{ { cellMaxX, cellMaxY, -1 }, {}, {} },
-
-		{ { cellMaxX, cellMaxY, -1 }, {}, {} },
-		{ { cellMaxX, cellMinY, top }, {}, {} },
-		{ { cellMaxX, cellMaxY, top }, {}, {} },
-	};
-	DrawDebugTriangles(gameState, cellDebugTris, 24);
-#endif
 
-	if (result)
-	{
-		*hit = closestHit;
-		*triangle = closestTriangle;
+		// Nearest child goes on top so it's tested first.
+		u32 childA = entry.nodeIdx + 1;
+		u32 childB = node->offset;
+		f32 entryA = LevelBVHRayEntry(rayOrigin, invRayDir, closestT,
+				geometryGrid->bvhNodes[childA].aabb);
+		f32 entryB = LevelBVHRayEntry(rayOrigin, invRayDir, closestT,
+				geometryGrid->bvhNodes[childB].aabb);
+		if (entryA > entryB)
+		{
+			u32 tmpIdx = childA;
+			childA = childB;
+			childB = tmpIdx;
+			f32 tmpT = entryA;
+			entryA = entryB;
+			entryB = tmpT;
+		}
+		ASSERT(stackSize + 2 <= ArrayCount(stack));
+		if (entryB != INFINITY)
+			stack[stackSize++] = { childB, entryB };
+		if (entryA != INFINITY)
+			stack[stackSize++] = { childA, entryA };
 	}
-	return result;
+
+	if (closestTriangleIdx == U32_MAX)
+		return false;
+	*hit = rayOrigin + rayDir * closestT;
+	*triangle = LevelGetTriangle(geometryGrid, closestTriangleIdx);
+	return true;
 }
 
-bool HitTest(GameState *gameState, v3 rayOrigin, v3 rayDir, bool infinite, v3 *hit, Triangle *triangle)
+// Where each ray of the packet gets into the box, as in LevelBVHRayEntry. Lanes that miss it get
+// INFINITY, and their bits in the returned mask are clear.
+inline __m256 RayPacketAABBEntryAVX2(const __m256 *origin, const __m256 *invDir, __m256 maxT,
+		const AABB &aabb, int *outMask)
 {
-	const ResourceGeometryGrid *geometryGrid = &gameState->levelGeometry.geometryGrid->geometryGrid;
-	ASSERT(geometryGrid->cellsSide != 0);
-
-	v2 cellSize = (geometryGrid->highCorner - geometryGrid->lowCorner) / (f32)(geometryGrid->cellsSide);
-
-#if HITTEST_VISUAL_DEBUG
-	auto ddraw = [&gameState, &cellSize, &geometryGrid](f32 relX, f32 relY)
-	{
-		DrawDebugCubeAA(gameState, v3{
-				relX * cellSize.x + geometryGrid->lowCorner.x,
-				relY * cellSize.y + geometryGrid->lowCorner.y,
-				1}, 0.1f);
-	};
-#else
-#define ddraw(...)
-#endif
-
-	v2 p1 = { rayOrigin.x, rayOrigin.y };
-	v2 p2 = { rayOrigin.x + rayDir.x, rayOrigin.y + rayDir.y };
-	p1 = p1 - geometryGrid->lowCorner;
-	p2 = p2 - geometryGrid->lowCorner;
-	p1.x /= cellSize.x;
-	p1.y /= cellSize.y;
-	p2.x /= cellSize.x;
-	p2.y /= cellSize.y;
-
-	f32 slope = (p2.y - p1.y) / (p2.x - p1.x);
-	bool swapXY = slope > 1 || slope < -1;
-	if (swapXY)
-	{
-		f32 tmp = p1.x;
-		p1.x = p1.y;
-		p1.y = tmp;
-		tmp = p2.x;
-		p2.x = p2.y;
-		p2.y = tmp;
-		slope = 1.0f / slope;
-	}
-	bool flipX = p1.x > p2.x;
-	if (flipX)
+	__m256 tMin = _mm256_setzero_ps();
+	__m256 tMax = maxT;
+	for (int i = 0; i < 3; ++i)
 	{
-		slope = -slope;
+		__m256 t0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(aabb.min.v[i]), origin[i]), invDir[i]);
+		__m256 t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(aabb.max.v[i]), origin[i]), invDir[i]);
+		tMin = _mm256_max_ps(tMin, _mm256_min_ps(t0, t1));
+		tMax = _mm256_min_ps(tMax, _mm256_max_ps(t0, t1));
 	}
-	f32 xSign = 1.0f - 2.0f * flipX;
-
-	f32 curX = p1.x;
-	f32 curY = p1.y;
-
-	if (HitTest_CheckCell(gameState, (int)Floor(curX), (int)Floor(curY), swapXY, rayOrigin, rayDir,
-				infinite, hit, triangle))
-		return true;
+	__m256 hit = _mm256_cmp_ps(tMin, tMax, _CMP_LE_OQ);
+	*outMask = _mm256_movemask_ps(hit);
+	return _mm256_blendv_ps(_mm256_set1_ps(INFINITY), tMin, hit);
+}
 
-	int oldY = (int)Floor(curY);
-	for (bool done = false; !done; )
+// HitTest for a packet of rays at once, walking the level BVH down every node any of them gets
+// into. Lanes that hit something get their maxT lowered to it and what they hit in
+// outTriangleIndices (see LevelGetTriangle), the rest get U32_MAX.
+void HitTestPacket(const ResourceGeometryGrid *geometryGrid, RayPacket *packet, u32 *outTriangleIndices)
+{
+	for (int lane = 0; lane < 8; ++lane)
+		outTriangleIndices[lane] = U32_MAX;
+
+	if (!geometryGrid || !geometryGrid->bvhNodeCount)
+		return;
+
+	const __m256 origin[3] = { _mm256_loadu_ps(packet->originX), _mm256_loadu_ps(packet->originY),
+		_mm256_loadu_ps(packet->originZ) };
+	const __m256 dir[3] = { _mm256_loadu_ps(packet->dirX), _mm256_loadu_ps(packet->dirY),
+		_mm256_loadu_ps(packet->dirZ) };
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 invDir[3] = { _mm256_div_ps(one, dir[0]), _mm256_div_ps(one, dir[1]),
+		_mm256_div_ps(one, dir[2]) };
+	__m256 maxT = _mm256_loadu_ps(packet->maxT);
+	__m256i triangleIndices = _mm256_set1_epi32(-1);
+
+	u32 stack[LEVEL_BVH_MAX_DEPTH + 2];
+	u32 stackSize = 0;
+	int mask;
+	RayPacketAABBEntryAVX2(origin, invDir, maxT, geometryGrid->bvhNodes[0].aabb, &mask);
+	if (mask)
+		stack[stackSize++] = 0;
+	while (stackSize)
 	{
-		curX += xSign;
-		curY += slope;
-		int newY = (int)Floor(curY);
-
-		if ((!flipX && curX > p2.x) || (flipX && curX < p2.x))
+		u32 nodeIdx = stack[--stackSize];
+		const LevelBVHNode *node = &geometryGrid->bvhNodes[nodeIdx];
+		if (node->triangleCount)
 		{
-			curX = p2.x;
-			curY = p2.y;
-			done = true;
+			for (u32 i = 0; i < node->triangleCount; ++i)
+			{
+				const LevelTriangleBlock *block = &geometryGrid->bvhTriangleBlocks[node->offset + i / 8];
+				const u32 lane = i % 8;
+				const __m256 v0[3] = { _mm256_set1_ps(block->v0X[lane]),
+					_mm256_set1_ps(block->v0Y[lane]), _mm256_set1_ps(block->v0Z[lane]) };
+				const __m256 edge1[3] = { _mm256_set1_ps(block->edge1X[lane]),
+					_mm256_set1_ps(block->edge1Y[lane]), _mm256_set1_ps(block->edge1Z[lane]) };
+				const __m256 edge2[3] = { _mm256_set1_ps(block->edge2X[lane]),
+					_mm256_set1_ps(block->edge2Y[lane]), _mm256_set1_ps(block->edge2Z[lane]) };
+				__m256 t;
+				__m256 hit = RayTriangleAVX2(origin, dir, v0, edge1, edge2, maxT, &t);
+				maxT = _mm256_blendv_ps(maxT, t, hit);
+				triangleIndices = _mm256_castps_si256(_mm256_blendv_ps(
+							_mm256_castsi256_ps(triangleIndices),
+							_mm256_castsi256_ps(_mm256_set1_epi32((int)(node->offset * 8 + i))), hit));
+			}
+			continue;
 		}
 
-		if (!swapXY)
-			ddraw(curX, curY);
-		else
-			ddraw(curY, curX);
-
-		if (newY != oldY)
+		// Go into children against the packet's lowered maxT, the nearest one first for the lane
+		// that gets to it soonest.
+		u32 childA = nodeIdx + 1;
+		u32 childB = node->offset;
+		int maskA, maskB;
+		__m256 entryA = RayPacketAABBEntryAVX2(origin, invDir, maxT,
+				geometryGrid->bvhNodes[childA].aabb, &maskA);
+		__m256 entryB = RayPacketAABBEntryAVX2(origin, invDir, maxT,
+				geometryGrid->bvhNodes[childB].aabb, &maskB);
+		if (maskA && maskB)
 		{
-			// When we go to a new row, check whether we come from the side or the top by projecting
-			// the current point to the left border of the current cell. If the row of the projected
-			// point is different than the current one, then we come from below.
-			f32 cellRelX = Fmod(curX, 1.0f) - flipX;
-			f32 projY = curY - cellRelX * slope * xSign;
-
-			if (!swapXY)
-				ddraw(curX - cellRelX, projY);
-			else
-				ddraw(projY, curX - cellRelX);
-
-			if ((int)Floor(projY) != newY)
+			f32 entriesA[8], entriesB[8];
+			_mm256_storeu_ps(entriesA, entryA);
+			_mm256_storeu_ps(entriesB, entryB);
+			f32 nearestA = INFINITY, nearestB = INFINITY;
+			for (int lane = 0; lane < 8; ++lane)
+			{
+				nearestA = Min(nearestA, entriesA[lane]);
+				nearestB = Min(nearestB, entriesB[lane]);
+			}
+			ASSERT(stackSize + 2 <= ArrayCount(stack));
+			if (nearestA > nearestB)
 			{
-				// Paint cell below
-				if (HitTest_CheckCell(gameState, (int)Floor(curX), (int)Floor(projY), swapXY,
-							rayOrigin, rayDir, infinite, hit, triangle))
-					return true;
+				stack[stackSize++] = childA;
+				stack[stackSize++] = childB;
 			}
 			else
 			{
-				// Paint cell behind
-				if (HitTest_CheckCell(gameState, (int)Floor(curX - xSign), (int)Floor(curY), swapXY,
-							rayOrigin, rayDir, infinite, hit, triangle))
-					return true;
+				stack[stackSize++] = childB;
+				stack[stackSize++] = childA;
 			}
 		}
+		else if (maskA)
+			stack[stackSize++] = childA;
+		else if (maskB)
+			stack[stackSize++] = childB;
+	}
 
-		if (HitTest_CheckCell(gameState, (int)Floor(curX), (int)Floor(curY), swapXY, rayOrigin,
-					rayDir, infinite, hit, triangle))
-			return true;
+	_mm256_storeu_ps(packet->maxT, maxT);
+	_mm256_storeu_si256((__m256i *)outTriangleIndices, triangleIndices);
+}
+
+// The lanes in laneMask against a convex hull collider's triangles, front faces only like
+// RayColliderIntersection. Returns the lanes that hit it before their maxT, lowers their maxT to it
+// and writes their world space hit normals to outNormals.
+u32 RayPacketConvexHull(RayPacket *packet, u32 laneMask, const Transform *transform,
+		const Collider *collider, v3 *outNormals)
+{
+	ASSERT(collider->type == COLLIDER_CONVEX_HULL);
+	const Resource *res = collider->convexHull.meshRes;
+	if (!res || !laneMask)
+		return 0;
+	const ResourceCollisionMesh *collMeshRes = &res->collisionMesh;
+	const f32 scale = collider->convexHull.scale;
+
+	// Into the hull's space, rotating keeps the direction's length so t doesn't change.
+	v4 invQ = transform->rotation;
+	invQ.w = -invQ.w;
+	RayPacket local;
+	for (int lane = 0; lane < 8; ++lane)
+	{
+		v3 origin = { packet->originX[lane], packet->originY[lane], packet->originZ[lane] };
+		v3 dir = { packet->dirX[lane], packet->dirY[lane], packet->dirZ[lane] };
+		origin = QuaternionRotateVector(invQ, origin - transform->translation);
+		dir = QuaternionRotateVector(invQ, dir);
+		local.originX[lane] = origin.x;
+		local.originY[lane] = origin.y;
+		local.originZ[lane] = origin.z;
+		local.dirX[lane] = dir.x;
+		local.dirY[lane] = dir.y;
+		local.dirZ[lane] = dir.z;
+		local.maxT[lane] = (laneMask & (1 << lane)) ? packet->maxT[lane] : -1.0f;
+	}
 
-		oldY = newY;
+	const __m256 origin[3] = { _mm256_loadu_ps(local.originX), _mm256_loadu_ps(local.originY),
+		_mm256_loadu_ps(local.originZ) };
+	const __m256 dir[3] = { _mm256_loadu_ps(local.dirX), _mm256_loadu_ps(local.dirY),
+		_mm256_loadu_ps(local.dirZ) };
+	__m256 maxT = _mm256_loadu_ps(local.maxT);
+	__m256i triangleIndices = _mm256_set1_epi32(-1);
+	const v3 *positions = collMeshRes->positionData;
+	for (u32 triIdx = 0; triIdx < collMeshRes->triangleCount; ++triIdx)
+	{
+		const IndexTriangle *tri = &collMeshRes->triangleData[triIdx];
+		v3 a = positions[tri->a] * scale;
+		v3 edge1 = positions[tri->b] * scale - a;
+		v3 edge2 = positions[tri->c] * scale - a;
+		const __m256 v0s[3] = { _mm256_set1_ps(a.x), _mm256_set1_ps(a.y), _mm256_set1_ps(a.z) };
+		const __m256 edge1s[3] = { _mm256_set1_ps(edge1.x), _mm256_set1_ps(edge1.y),
+			_mm256_set1_ps(edge1.z) };
+		const __m256 edge2s[3] = { _mm256_set1_ps(edge2.x), _mm256_set1_ps(edge2.y),
+			_mm256_set1_ps(edge2.z) };
+		__m256 t;
+		__m256 hit = RayTriangleAVX2(origin, dir, v0s, edge1s, edge2s, maxT, &t);
+		// Back faces
+		__m256 dirDotNormal = _mm256_add_ps(_mm256_add_ps(
+					_mm256_mul_ps(dir[0], _mm256_set1_ps(tri->normal.x)),
+					_mm256_mul_ps(dir[1], _mm256_set1_ps(tri->normal.y))),
+				_mm256_mul_ps(dir[2], _mm256_set1_ps(tri->normal.z)));
+		hit = _mm256_and_ps(hit, _mm256_cmp_ps(dirDotNormal, _mm256_setzero_ps(), _CMP_LE_OQ));
+		maxT = _mm256_blendv_ps(maxT, t, hit);
+		triangleIndices = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(triangleIndices),
+					_mm256_castsi256_ps(_mm256_set1_epi32((int)triIdx)), hit));
 	}
 
-	return false;
+	u32 indices[8];
+	_mm256_storeu_si256((__m256i *)indices, triangleIndices);
+	_mm256_storeu_ps(local.maxT, maxT);
+	u32 hitMask = 0;
+	for (int lane = 0; lane < 8; ++lane)
+	{
+		if (indices[lane] == U32_MAX)
+			continue;
+		hitMask |= 1 << lane;
+		packet->maxT[lane] = local.maxT[lane];
+		outNormals[lane] = QuaternionRotateVector(transform->rotation,
+				collMeshRes->triangleData[indices[lane]].normal);
+	}
+	return hitMask;
 }
 
 // @Speed: is 'infinite' bool slow here? Branch should be predictable across many similar ray tests
@@ -831,7 +1002,217 @@ void GetAABB(Transform *transform, Collider *c, v3 *min, v3 *max)
 	*max += transform->translation;
 }
 
-v3 FurthestInDirection(Transform *transform, Collider *c, v3 dir)
+// Below this a plain scan beats walking the hull.
+const u32 HULL_HILL_CLIMB_MIN_VERTICES = 32;
+
+u32 HullSupportLinear(const ResourceCollisionMesh *mesh, v3 dir)
+{
+	u32 result = 0;
+	f32 maxDist = -INFINITY;
+	const u32 pointCount = mesh->positionCount;
+	const v3 *positions = mesh->positionData;
+	for (u32 i = 0; i < pointCount; ++i)
+	{
+		f32 dot = V3Dot(positions[i], dir);
+		if (dot > maxDist)
+		{
+			maxDist = dot;
+			result = i;
+		}
+	}
+	return result;
+}
+
+// Same result as HullSupportLinear, ties included, 8 vertices at a time. Sums the products in the
+// same order as V3Dot so both agree to the bit.
+u32 HullSupportLinearAVX2(const ResourceCollisionMesh *mesh, v3 dir)
+{
+	const __m256 dirX = _mm256_set1_ps(dir.x);
+	const __m256 dirY = _mm256_set1_ps(dir.y);
+	const __m256 dirZ = _mm256_set1_ps(dir.z);
+	const __m256i eight = _mm256_set1_epi32(8);
+
+	__m256 maxDist = _mm256_set1_ps(-INFINITY);
+	__m256i maxIdx = _mm256_setzero_si256();
+	__m256i idx = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const u32 count = mesh->paddedPositionCount;
+	for (u32 i = 0; i < count; i += 8)
+	{
+		__m256 x = _mm256_loadu_ps(mesh->positionsX + i);
+		__m256 y = _mm256_loadu_ps(mesh->positionsY + i);
+		__m256 z = _mm256_loadu_ps(mesh->positionsZ + i);
+		__m256 dot = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, dirX), _mm256_mul_ps(y, dirY)),
+				_mm256_mul_ps(z, dirZ));
+
+		// Strictly greater, so each lane keeps the first index it saw its max at
+		__m256 greater = _mm256_cmp_ps(dot, maxDist, _CMP_GT_OQ);
+		maxDist = _mm256_blendv_ps(maxDist, dot, greater);
+		maxIdx = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(maxIdx),
+					_mm256_castsi256_ps(idx), greater));
+		idx = _mm256_add_epi32(idx, eight);
+	}
+
+	// Horizontal max, then the lowest index among the lanes that have it
+	__m256 max = _mm256_max_ps(maxDist, _mm256_permute_ps(maxDist, _MM_SHUFFLE(2, 3, 0, 1)));
+	max = _mm256_max_ps(max, _mm256_permute_ps(max, _MM_SHUFFLE(1, 0, 3, 2)));
+	max = _mm256_max_ps(max, _mm256_permute2f128_ps(max, max, 1));
+	__m256i isMax = _mm256_castps_si256(_mm256_cmp_ps(maxDist, max, _CMP_EQ_OQ));
+	__m256i candidates = _mm256_blendv_epi8(_mm256_set1_epi32(-1), maxIdx, isMax);
+	candidates = _mm256_min_epu32(candidates,
+			_mm256_shuffle_epi32(candidates, _MM_SHUFFLE(2, 3, 0, 1)));
+	candidates = _mm256_min_epu32(candidates,
+			_mm256_shuffle_epi32(candidates, _MM_SHUFFLE(1, 0, 3, 2)));
+	candidates = _mm256_min_epu32(candidates,
+			_mm256_permute2x128_si256(candidates, candidates, 1));
+	return (u32)_mm256_cvtsi256_si32(candidates);
+}
+
+// Walks the hull edges from startVertex towards dir. There are no local maxima on a convex hull, so
+// this lands on the support, and it's only a couple steps away when startVertex is last call's.
+u32 HullSupportHillClimb(const ResourceCollisionMesh *mesh, v3 dir, u32 startVertex)
+{
+	const v3 *positions = mesh->positionData;
+	const u32 *offsets = mesh->adjacencyOffsets;
+	if (startVertex >= mesh->positionCount || offsets[startVertex] == offsets[startVertex + 1])
+		startVertex = mesh->hullStartVertex;
+
+	u32 result = startVertex;
+	f32 maxDist = V3Dot(positions[result], dir);
+	u32 currentVertex;
+	do
+	{
+		currentVertex = result;
+		const u32 end = offsets[currentVertex + 1];
+		for (u32 i = offsets[currentVertex]; i < end; ++i)
+		{
+			u32 neighbour = mesh->adjacencyData[i];
+			f32 dot = V3Dot(positions[neighbour], dir);
+			if (dot > maxDist)
+			{
+				maxDist = dot;
+				result = neighbour;
+			}
+		}
+	} while (result != currentVertex);
+	return result;
+}
+
+// Times support queries on the anvil and teapot hulls with a linear scan, the AVX2 scan and hill
+// climbing, both for random directions and for a slowly turning one like GJK sees frame to frame.
+// Also checks the AVX2 scan picks exactly the same vertices as the scalar one.
+void CollisionBenchmarkHullSupport()
+{
+	const u32 dirCount = 1 << 16;
+	v3 *randomDirs = ALLOC_N(FrameAllocator, v3, dirCount);
+	v3 *coherentDirs = ALLOC_N(FrameAllocator, v3, dirCount);
+	u32 seed = 0x9E3779B9;
+	for (u32 dirIdx = 0; dirIdx < dirCount; ++dirIdx)
+	{
+		randomDirs[dirIdx] = XorShift32V3Signed(&seed) + v3{ 0, 0, 0.001f };
+
+		f32 angle = (f32)dirIdx * 0.001f;
+		coherentDirs[dirIdx] = { Cos(angle), Sin(angle), Sin(angle * 0.37f) };
+	}
+
+	const char *meshNames[] = { "anvil_collision.b", "teapot_collision.b" };
+	const f64 frequency = (f64)PlatformGetPerformanceFrequency();
+	for (u32 meshIdx = 0; meshIdx < ArrayCount(meshNames); ++meshIdx)
+	{
+		const Resource *res = GetResource(meshNames[meshIdx]);
+		if (!res)
+		{
+			Log("ERROR! Hull support benchmark: %s isn't loaded\n", meshNames[meshIdx]);
+			continue;
+		}
+		const ResourceCollisionMesh *mesh = &res->collisionMesh;
+
+		// The shipped hull data has to be what the bake step makes out of the positions now.
+		ResourceCollisionMesh rebaked = {};
+		rebaked.positionData = mesh->positionData;
+		rebaked.positionCount = mesh->positionCount;
+		BakeCollisionMeshHull<FrameAllocator>(&rebaked);
+		if (!BakeCollisionMeshHullEqual(mesh, &rebaked))
+			Log("ERROR! Hull data in %s doesn't match a fresh bake, it needs rebaking\n",
+					meshNames[meshIdx]);
+
+		for (int coherent = 0; coherent < 2; ++coherent)
+		{
+			const v3 *dirs = coherent ? coherentDirs : randomDirs;
+
+			u64 start = PlatformGetPerformanceCounter();
+			u32 linearChecksum = 0;
+			for (u32 dirIdx = 0; dirIdx < dirCount; ++dirIdx)
+				linearChecksum += HullSupportLinear(mesh, dirs[dirIdx]);
+			f64 linearTime = (PlatformGetPerformanceCounter() - start) / frequency;
+
+			start = PlatformGetPerformanceCounter();
+			u32 AVX2Checksum = 0;
+			for (u32 dirIdx = 0; dirIdx < dirCount; ++dirIdx)
+				AVX2Checksum += HullSupportLinearAVX2(mesh, dirs[dirIdx]);
+			f64 AVX2Time = (PlatformGetPerformanceCounter() - start) / frequency;
+
+			start = PlatformGetPerformanceCounter();
+			u32 vertex = mesh->hullStartVertex;
+			u32 climbChecksum = 0;
+			for (u32 dirIdx = 0; dirIdx < dirCount; ++dirIdx)
+			{
+				vertex = HullSupportHillClimb(mesh, dirs[dirIdx], vertex);
+				climbChecksum += vertex;
+			}
+			f64 climbTime = (PlatformGetPerformanceCounter() - start) / frequency;
+
+			// Hill climbing has to find a vertex equally far along, though ties can pick different ones.
+			// The AVX2 scan has to pick the very same vertex.
+			u32 climbMismatchCount = 0;
+			u32 AVX2MismatchCount = 0;
+			vertex = mesh->hullStartVertex;
+			for (u32 dirIdx = 0; dirIdx < dirCount; ++dirIdx)
+			{
+				v3 dir = dirs[dirIdx];
+				vertex = HullSupportHillClimb(mesh, dir, vertex);
+				u32 linearVertex = HullSupportLinear(mesh, dir);
+				f32 linearDot = V3Dot(mesh->positionData[linearVertex], dir);
+				f32 climbDot = V3Dot(mesh->positionData[vertex], dir);
+				if (linearDot != climbDot)
+					++climbMismatchCount;
+				if (HullSupportLinearAVX2(mesh, dir) != linearVertex)
+					++AVX2MismatchCount;
+			}
+
+			Log("Hull support, %s (%u vertices), %s directions: linear %.3f ms, AVX2 %.3f ms, "
+					"hill climb %.3f ms (checksums %u %u %u)\n", meshNames[meshIdx],
+					mesh->positionCount, coherent ? "coherent" : "random", linearTime * 1000.0,
+					AVX2Time * 1000.0, climbTime * 1000.0, linearChecksum, AVX2Checksum, climbChecksum);
+			if (climbMismatchCount)
+				Log("ERROR! Hill climbing didn't find the support for %u directions\n",
+						climbMismatchCount);
+			if (AVX2MismatchCount)
+				Log("ERROR! AVX2 support scan disagrees with the scalar one for %u directions\n",
+						AVX2MismatchCount);
+		}
+	}
+}
+
+// Support vertex of a hull in its own space. hint is optional, if there is one searching starts
+// from it and it gets updated with the new support.
+u32 HullSupport(const ResourceCollisionMesh *mesh, v3 dir, u32 *hint)
+{
+	u32 vertexIdx;
+	if (mesh->positionCount >= HULL_HILL_CLIMB_MIN_VERTICES)
+	{
+		u32 startVertex = hint ? *hint : mesh->hullStartVertex;
+		vertexIdx = HullSupportHillClimb(mesh, dir, startVertex);
+	}
+	else
+		vertexIdx = HullSupportLinearAVX2(mesh, dir);
+	if (hint)
+		*hint = vertexIdx;
+	return vertexIdx;
+}
+
+// hullVertexHint is optional. For convex hulls it holds the last support vertex, searching starts
+// there and it gets updated with the new one.
+v3 FurthestInDirection(Transform *transform, Collider *c, v3 dir, u32 *hullVertexHint = nullptr)
 {
 	v3 result = {};
 
@@ -846,25 +1227,13 @@ v3 FurthestInDirection(Transform *transform, Collider *c, v3 dir)
 	{
 	case COLLIDER_CONVEX_HULL:
 	{
-		f32 maxDist = -INFINITY;
-
 		const Resource *res = c->convexHull.meshRes;
 		if (!res)
 			return {};
 		const ResourceCollisionMesh *collMeshRes = &res->collisionMesh;
 
-		const u32 pointCount = collMeshRes->positionCount;
-		const v3 *scan = collMeshRes->positionData;
-		for (u32 i = 0; i < pointCount; ++i)
-		{
-			v3 p = *scan++;
-			f32 dot = V3Dot(p, locDir);
-			if (dot > maxDist)
-			{
-				maxDist = dot;
-				result = p;
-			}
-		}
+		u32 vertexIdx = HullSupport(collMeshRes, locDir, hullVertexHint);
+		result = collMeshRes->positionData[vertexIdx];
 
 		result *= c->convexHull.scale;
 
@@ -954,12 +1323,13 @@ v3 FurthestInDirection(Transform *transform, Collider *c, v3 dir)
 	return result;
 }
 
+// The hints are passed along to FurthestInDirection.
 inline GJKPoint GJKSupport(Transform *transformA, Transform *transformB, Collider *colliderA,
-		Collider *colliderB, v3 dir)
+		Collider *colliderB, v3 dir, u32 *hullVertexHintA, u32 *hullVertexHintB)
 {
 	ASSERT(dir.x != 0 || dir.y != 0 || dir.z != 0);
-	v3 a = FurthestInDirection(transformA, colliderA, dir);
-	v3 b = FurthestInDirection(transformB, colliderB, -dir);
+	v3 a = FurthestInDirection(transformA, colliderA, dir, hullVertexHintA);
+	v3 b = FurthestInDirection(transformB, colliderB, -dir, hullVertexHintB);
 	return { a - b, a };
 }
 
@@ -1008,11 +1378,50 @@ inline bool TestAABBsAVX2(v3 minA, v3 maxA, v3 minB, v3 maxB)
 }
 #define TestAABBs TestAABBsAVX2
 
+// Puts the tetrahedron in the winding the rest of GJK and EPA expect and checks if the origin is
+// inside. Flat ones never contain it.
+bool GJKTetrahedronContainsOrigin(GJKPoint *points)
+{
+	v3 ab = points[2].dif - points[3].dif;
+	v3 ac = points[1].dif - points[3].dif;
+	v3 ad = points[0].dif - points[3].dif;
+	v3 abcNor = V3Cross(ac, ab);
+	f32 volume = V3Dot(ad, abcNor);
+	if (Abs(volume) <= 0.00001f * V3Length(ad) * V3Length(abcNor))
+		return false;
+	if (volume > 0)
+	{
+		GJKPoint tmp = points[1];
+		points[1] = points[2];
+		points[2] = tmp;
+	}
+
+	const GJKPoint &a = points[3];
+	const GJKPoint &b = points[2];
+	const GJKPoint &c = points[1];
+	const GJKPoint &d = points[0];
+	const EPAFace faces[] = { { b, d, c }, { a, b, c }, { a, c, d }, { a, d, b } };
+	for (u32 faceIdx = 0; faceIdx < ArrayCount(faces); ++faceIdx)
+	{
+		const EPAFace *face = &faces[faceIdx];
+		v3 normal = V3Cross(face->c.dif - face->a.dif, face->b.dif - face->a.dif);
+		if (V3Dot(normal, face->a.dif) <= 0)
+			return false;
+	}
+	return true;
+}
+
+// warmStart is the pair's cache from the last test, if any. A resting contact usually still
+// encloses the origin with the old simplex and needs no supports at all, and a separated pair is
+// usually still separated along the old search direction and needs one. The hull vertex hints are
+// updated as supports are found, see FurthestInDirection.
 GJKResult GJKTest(Transform *transformA, Transform *transformB, Collider *colliderA,
-		Collider *colliderB)
+		Collider *colliderB, const GJKCache *warmStart, u32 *hullVertexA, u32 *hullVertexB)
 {
 #if DEBUG_BUILD
-	if (g_debugContext->GJKSteps[0] == nullptr)
+	// Steps are only captured from the main thread, other threads leave the capture alone.
+	const bool captureSteps = t_threadIndex == 0;
+	if (captureSteps && g_debugContext->GJKSteps[0] == nullptr)
 	{
 		for (u32 i = 0; i < ArrayCount(g_debugContext->GJKSteps); ++i)
 			g_debugContext->GJKSteps[i] = ALLOC_N(TransientAllocator, DebugVertex, 12);
@@ -1022,17 +1431,49 @@ GJKResult GJKTest(Transform *transformA, Transform *transformB, Collider *collid
 	GJKResult result;
 	result.hit = true;
 
-	int foundPointsCount = 1;
-	v3 testDir = { 0, 1, 0 }; // Random initial test direction
+	if (warmStart && warmStart->hasSimplex)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			v3 onA = TransformPoint(*transformA, warmStart->localOnA[i]);
+			v3 onB = TransformPoint(*transformB, warmStart->localOnB[i]);
+			result.points[i] = { onB - onA, onB };
+		}
+		if (GJKTetrahedronContainsOrigin(result.points))
+		{
+			result.searchDir = warmStart->searchDir;
+			result.iterations = 0;
+			return result;
+		}
+	}
+
+	result.iterations = 1;
 
-	result.points[0] = GJKSupport(transformB, transformA, colliderB, colliderA, testDir); // @Check: why are these in reverse order?
+	int foundPointsCount = 1;
+	v3 testDir = {};
+	if (warmStart)
+		testDir = warmStart->searchDir;
+	if (testDir.x == 0 && testDir.y == 0 && testDir.z == 0)
+		testDir = { 0, 1, 0 }; // Random initial test direction
+
+	result.points[0] = GJKSupport(transformB, transformA, colliderB, colliderA, testDir, // @Check: why are these in reverse order?
+			hullVertexB, hullVertexA);
+	const v3 firstDif = result.points[0].dif;
+	if (V3Dot(testDir, firstDif) < 0 || (firstDif.x == 0 && firstDif.y == 0 && firstDif.z == 0))
+	{
+		// Nothing reaches past the origin along testDir, or the support is the origin itself and
+		// the shapes are just touching.
+		result.hit = false;
+		result.searchDir = testDir;
+		return result;
+	}
 	testDir = -result.points[0].dif;
 
 	for (int iterations = 0; result.hit && foundPointsCount < 4; ++iterations)
 	{
 #if DEBUG_BUILD
 		int i_ = iterations;
-		if (!g_debugContext->freezeGJKGeom)
+		if (captureSteps && !g_debugContext->freezeGJKGeom)
 		{
 			g_debugContext->GJKStepsVertexCounts[i_] = 0;
 			g_debugContext->gjkStepCount = i_ + 1;
@@ -1044,13 +1485,16 @@ GJKResult GJKTest(Transform *transformA, Transform *transformB, Collider *collid
 			//Log("ERROR! GJK: Reached iteration limit!\n");
 			//ASSERT(false);
 #if DEBUG_BUILD
-			g_debugContext->freezeGJKGeom = true;
+			if (captureSteps)
+				g_debugContext->freezeGJKGeom = true;
 #endif
 			result.hit = false;
 			break;
 		}
 
-		GJKPoint a = GJKSupport(transformB, transformA, colliderB, colliderA, testDir);
+		GJKPoint a = GJKSupport(transformB, transformA, colliderB, colliderA, testDir, hullVertexB,
+				hullVertexA);
+		++result.iterations;
 		if (V3Dot(testDir, a.dif) <= 0)
 		{
 			result.hit = false;
@@ -1058,7 +1502,7 @@ GJKResult GJKTest(Transform *transformA, Transform *transformB, Collider *collid
 		}
 
 #if DEBUG_BUILD
-		if ((!g_debugContext->freezeGJKGeom) && iterations)
+		if (captureSteps && !g_debugContext->freezeGJKGeom && iterations)
 			g_debugContext->GJKNewPoint[iterations - 1] = a.a;
 #endif
 
@@ -1089,7 +1533,7 @@ GJKResult GJKTest(Transform *transformA, Transform *transformB, Collider *collid
 				v3 acNor = V3Cross(ac, nor);
 
 #if DEBUG_BUILD
-				if (!g_debugContext->freezeGJKGeom)
+				if (captureSteps && !g_debugContext->freezeGJKGeom)
 				{
 					g_debugContext->GJKSteps[i_][g_debugContext->GJKStepsVertexCounts[i_]++] =
 						{ a.a, v3{1,0,0} };
@@ -1151,7 +1595,7 @@ GJKResult GJKTest(Transform *transformA, Transform *transformB, Collider *collid
 				v3 acdNor = V3Cross(ad, ac);
 
 #if DEBUG_BUILD
-				if (!g_debugContext->freezeGJKGeom)
+				if (captureSteps && !g_debugContext->freezeGJKGeom)
 				{
 					g_debugContext->GJKSteps[i_][g_debugContext->GJKStepsVertexCounts[i_]++] =
 						{ b.a, v3{1,0,0} };
@@ -1185,6 +1629,15 @@ GJKResult GJKTest(Transform *transformA, Transform *transformB, Collider *collid
 				}
 #endif
 
+				// A flat tetrahedron means the origin is on the surface of the Minkowski difference,
+				// the shapes touch but don't overlap. Warm started search directions run into this on
+				// resting contacts all the time.
+				if (V3Dot(ad, abcNor) > -0.00001f * V3Length(ad) * V3Length(abcNor))
+				{
+					result.hit = false;
+					break;
+				}
+
 				// Assert normals point outside
 				if (V3Dot(d.dif - a.dif, abcNor) > 0)
 				{
@@ -1310,6 +1763,8 @@ GJKResult GJKTest(Transform *transformA, Transform *transformB, Collider *collid
 		}
 	}
 
+	result.searchDir = testDir;
+
 #if DEBUG_BUILD
 	if (g_debugContext->drawSupports)
 	{
@@ -1324,286 +1779,1459 @@ GJKResult GJKTest(Transform *transformA, Transform *transformB, Collider *collid
 	return result;
 }
 
-CollisionInfo TestCollision(GameState *gameState, Transform *transformA, Transform *transformB,
-		Collider *colliderA, Collider *colliderB)
+// Closed form contact generation for primitive pairs. Same conventions as EPA: hitNormal points
+// from B to A, depth is positive when penetrating. Primitives ignore transform scale, like
+// FurthestInDirection does.
+typedef void (*AnalyticCollisionProc)(const Transform *transformA, const Transform *transformB,
+		const Collider *colliderA, const Collider *colliderB, CollisionInfo *result);
+
+inline v3 PrimitiveLocalToWorld(const Transform *transform, v3 point)
 {
-	GJKResult gjkResult = GJKTest(transformA, transformB, colliderA, colliderB);
-	if (!gjkResult.hit)
-		return {};
+	return QuaternionRotateVector(transform->rotation, point) + transform->translation;
+}
 
-#if DEBUG_BUILD
-	if (g_debugContext->polytopeSteps[0] == nullptr)
-	{
-		for (u32 i = 0; i < ArrayCount(g_debugContext->polytopeSteps); ++i)
-			g_debugContext->polytopeSteps[i] = ALLOC_N(TransientAllocator, DebugVertex, 256);
-	}
-#endif
+inline v3 PrimitiveWorldToLocal(const Transform *transform, v3 point)
+{
+	return QuaternionRotateVector(QuaternionConjugate(transform->rotation),
+			point - transform->translation);
+}
 
-	VERBOSE_LOG("\n\nNew EPA calculation\n");
+inline void CapsuleSegment(const Transform *transform, const Collider *c, v3 *p0, v3 *p1)
+{
+	v3 halfAxis = { 0, 0, c->capsule.height * 0.5f };
+	*p0 = PrimitiveLocalToWorld(transform, c->capsule.offset - halfAxis);
+	*p1 = PrimitiveLocalToWorld(transform, c->capsule.offset + halfAxis);
+}
 
-	// By now we should have the tetrahedron from GJK
-	// TODO dynamic array?
-	FixedArray<EPAFace, 256> polytope;
-	polytope.count = 0;
+inline v3 ClosestPointOnSegment(v3 p0, v3 p1, v3 point)
+{
+	v3 d = p1 - p0;
+	f32 sqrLen = V3SqrLen(d);
+	if (sqrLen == 0)
+		return p0;
+	f32 t = Clamp(V3Dot(point - p0, d) / sqrLen, 0.0f, 1.0f);
+	return p0 + d * t;
+}
 
-	// Make all faces from tetrahedron
-	{
-		// We don't need depenetration if we have a degenerate polytope (a zero-volume polytope)
-		f32 epsilon = 0.000001f;
-		for (int i = 0; i < 4; ++i)
-			for (int j = 0; j < i; ++j)
-				if (V3EqualWithEpsilon(gjkResult.points[i].dif, gjkResult.points[j].dif, epsilon))
-					return {};
+// Adds a contact between two spheres, one around centerA and one around centerB. Contact point is
+// halfway between both surfaces.
+void AddSphereSphereContact(v3 centerA, f32 radiusA, v3 centerB, f32 radiusB, CollisionInfo *result)
+{
+	v3 delta = centerA - centerB;
+	f32 sqrDist = V3SqrLen(delta);
+	f32 radiusSum = radiusA + radiusB;
+	if (sqrDist > radiusSum * radiusSum)
+		return;
+
+	f32 dist = Sqrt(sqrDist);
+	v3 normal;
+	if (dist > 0)
+		normal = delta / dist;
+	else if (result->hitCount)
+		normal = result->hitNormal;
+	else
+		normal = { 0, 0, 1 }; // Concentric, any direction works
 
-		GJKPoint &a = gjkResult.points[3];
-		GJKPoint &b = gjkResult.points[2];
-		GJKPoint &c = gjkResult.points[1];
-		GJKPoint &d = gjkResult.points[0];
+	f32 depth = radiusSum - dist;
+	v3 onA = centerA - normal * radiusA;
+	v3 onB = centerB + normal * radiusB;
 
-		// We took care during GJK to ensure the BCD triangle faces away from the origin
-		polytope[0] = { b, d, c };
-		// And we know A is on the opposite side of the origin
-		polytope[1] = { a, b, c };
-		polytope[2] = { a, c, d };
-		polytope[3] = { a, d, b };
-		polytope.count = 4;
-	}
+	result->hitNormal = normal;
+	result->hitPoints[result->hitCount] = (onA + onB) * 0.5f;
+	result->hitDepths[result->hitCount] = depth;
+	result->depth = Max(result->depth, depth);
+	++result->hitCount;
+}
 
-	EPAFace closestFeature;
-	f32 lastLeastDistance = -1.0f;
-	const int maxIterations = 64;
-	for (int epaStep = 0; epaStep < maxIterations; ++epaStep)
-	{
-		ASSERT(epaStep < maxIterations - 1);
+void CollideSphereSphere(const Transform *transformA, const Transform *transformB,
+		const Collider *colliderA, const Collider *colliderB, CollisionInfo *result)
+{
+	v3 centerA = transformA->translation + colliderA->sphere.offset;
+	v3 centerB = transformB->translation + colliderB->sphere.offset;
+	AddSphereSphereContact(centerA, colliderA->sphere.radius, centerB, colliderB->sphere.radius,
+			result);
+}
 
-#if DEBUG_BUILD
-		// Save polytope for debug visualization
-		if (!g_debugContext->freezePolytopeGeom && epaStep < DebugContext::epaMaxSteps)
+void CollideSphereCapsule(const Transform *transformA, const Transform *transformB,
+		const Collider *colliderA, const Collider *colliderB, CollisionInfo *result)
+{
+	v3 centerA = transformA->translation + colliderA->sphere.offset;
+	v3 p0, p1;
+	CapsuleSegment(transformB, colliderB, &p0, &p1);
+	v3 centerB = ClosestPointOnSegment(p0, p1, centerA);
+	AddSphereSphereContact(centerA, colliderA->sphere.radius, centerB, colliderB->capsule.radius,
+			result);
+}
+
+// From Ericson's Real-Time Collision Detection 5.1.9
+void ClosestPointsBetweenSegments(v3 a0, v3 a1, v3 b0, v3 b1, v3 *onA, v3 *onB)
+{
+	v3 dA = a1 - a0;
+	v3 dB = b1 - b0;
+	v3 r = a0 - b0;
+	f32 sqrLenA = V3SqrLen(dA);
+	f32 sqrLenB = V3SqrLen(dB);
+	f32 dotAB = V3Dot(dA, dB);
+	f32 denom = sqrLenA * sqrLenB - dotAB * dotAB;
+
+	f32 s, t;
+	if (sqrLenA == 0 && sqrLenB == 0)
+	{
+		s = 0;
+		t = 0;
+	}
+	else if (sqrLenA == 0)
+	{
+		s = 0;
+		t = Clamp(V3Dot(dB, r) / sqrLenB, 0.0f, 1.0f);
+	}
+	else
+	{
+		f32 c = V3Dot(dA, r);
+		if (sqrLenB == 0)
+		{
+			t = 0;
+			s = Clamp(-c / sqrLenA, 0.0f, 1.0f);
+		}
+		else
 		{
-			if (g_debugContext->drawEPAClosestFeature)
+			f32 f = V3Dot(dB, r);
+			s = denom > 0 ? Clamp((dotAB * f - c * sqrLenB) / denom, 0.0f, 1.0f) : 0.0f;
+			t = (dotAB * s + f) / sqrLenB;
+			if (t < 0)
 			{
-				GenPolytopeMesh({ &closestFeature, 1 }, g_debugContext->polytopeSteps[epaStep],
-						&g_debugContext->polytopeStepsVertexCounts[epaStep]);
+				t = 0;
+				s = Clamp(-c / sqrLenA, 0.0f, 1.0f);
 			}
-			else
+			else if (t > 1)
 			{
-				GenPolytopeMesh(polytope, g_debugContext->polytopeSteps[epaStep],
-						&g_debugContext->polytopeStepsVertexCounts[epaStep]);
+				t = 1;
+				s = Clamp((dotAB - c) / sqrLenA, 0.0f, 1.0f);
 			}
-			g_debugContext->epaStepCount = epaStep + 1;
 		}
-#endif
+	}
+	*onA = a0 + dA * s;
+	*onB = b0 + dB * t;
+}
 
-		// Find closest feature to origin in polytope
-		EPAFace newClosestFeature = {};
-		int validFacesFound = 0;
-		f32 leastDistance = INFINITY;
-		VERBOSE_LOG("Looking for closest feature\n");
-		for (u32 faceIdx = 0; faceIdx < polytope.count; ++faceIdx)
+void CollideCapsuleCapsule(const Transform *transformA, const Transform *transformB,
+		const Collider *colliderA, const Collider *colliderB, CollisionInfo *result)
+{
+	v3 a0, a1, b0, b1;
+	CapsuleSegment(transformA, colliderA, &a0, &a1);
+	CapsuleSegment(transformB, colliderB, &b0, &b1);
+	const f32 radiusA = colliderA->capsule.radius;
+	const f32 radiusB = colliderB->capsule.radius;
+
+	v3 dA = a1 - a0;
+	v3 dB = b1 - b0;
+	f32 sqrLenA = V3SqrLen(dA);
+	f32 sqrLenB = V3SqrLen(dB);
+	f32 dotAB = V3Dot(dA, dB);
+	f32 denom = sqrLenA * sqrLenB - dotAB * dotAB;
+
+	if (denom <= 0.0001f * sqrLenA * sqrLenB && sqrLenA > 0 && sqrLenB > 0)
+	{
+		// Close to parallel. Contact at both ends of the overlap so the pair can rest side by side.
+		f32 t0 = Clamp(V3Dot(b0 - a0, dA) / sqrLenA, 0.0f, 1.0f);
+		f32 t1 = Clamp(V3Dot(b1 - a0, dA) / sqrLenA, 0.0f, 1.0f);
+		if (t0 != t1)
 		{
-			EPAFace *face = &polytope[faceIdx];
-
-			v3 normal = V3Cross(face->c.dif - face->a.dif, face->b.dif - face->a.dif);
-			f32 sqrlen = V3SqrLen(normal);
-			// Some features might be degenerate 0-area triangles
-			if (sqrlen == 0)
-				continue;
+			v3 onA0 = a0 + dA * t0;
+			v3 onA1 = a0 + dA * t1;
+			AddSphereSphereContact(onA0, radiusA, ClosestPointOnSegment(b0, b1, onA0), radiusB,
+					result);
+			AddSphereSphereContact(onA1, radiusA, ClosestPointOnSegment(b0, b1, onA1), radiusB,
+					result);
+			return;
+		}
+	}
 
-			normal = normal / Sqrt(sqrlen);
-			f32 distToOrigin = V3Dot(normal, face->a.dif);
-			if (distToOrigin >= leastDistance)
-				continue;
+	v3 onA, onB;
+	ClosestPointsBetweenSegments(a0, a1, b0, b1, &onA, &onB);
+	AddSphereSphereContact(onA, radiusA, onB, radiusB, result);
+}
 
-			// Make sure projected origin is within triangle
-			v3 abNor = V3Cross(face->a.dif - face->b.dif, normal);
-			v3 bcNor = V3Cross(face->b.dif - face->c.dif, normal);
-			v3 acNor = V3Cross(face->c.dif - face->a.dif, normal);
-			if (V3Dot(abNor, -face->a.dif) > 0 ||
-				V3Dot(bcNor, -face->b.dif) > 0 ||
-				V3Dot(acNor, -face->a.dif) > 0)
-				continue;
+void CollideSphereCube(const Transform *transformA, const Transform *transformB,
+		const Collider *colliderA, const Collider *colliderB, CollisionInfo *result)
+{
+	const f32 radius = colliderA->sphere.radius;
+	const f32 halfSize = colliderB->cube.radius;
+	v3 center = transformA->translation + colliderA->sphere.offset;
+	v3 local = PrimitiveWorldToLocal(transformB, center) - colliderB->cube.offset;
+
+	v3 closest = {
+		Clamp(local.x, -halfSize, halfSize),
+		Clamp(local.y, -halfSize, halfSize),
+		Clamp(local.z, -halfSize, halfSize)
+	};
+	v3 delta = local - closest;
+	f32 sqrDist = V3SqrLen(delta);
+	if (sqrDist > radius * radius)
+		return;
 
-			leastDistance = distToOrigin;
-			newClosestFeature = *face;
-			++validFacesFound;
-		}
-		if (leastDistance == INFINITY)
-		{
-			//ASSERT(false);
-			Log("ERROR: EPA: Couldn't find closest feature!");
-			// Collision is probably on the very edge, we don't need depenetration
-			return {};
-		}
-#if 0
-		else if (leastDistance <= lastLeastDistance + 0.0001f)
+	v3 localNormal;
+	f32 depth;
+	if (sqrDist > 0)
+	{
+		f32 dist = Sqrt(sqrDist);
+		localNormal = delta / dist;
+		depth = radius - dist;
+	}
+	else
+	{
+		// Center is inside the cube, push out through the nearest face.
+		int axis = 0;
+		f32 faceDist = halfSize - Abs(local.x);
+		if (halfSize - Abs(local.y) < faceDist)
 		{
-			// We tried to expand in this direction but failed! So we are at the edge of
-			// the Minkowski difference
-			// TODO do we really need two exit conditions? Something must be wrong with
-			// the other one!
-			VERBOSE_LOG("Ending because couldn't get any further away from the outer edge");
-			break;
+			axis = 1;
+			faceDist = halfSize - Abs(local.y);
 		}
-#endif
-		else
+		if (halfSize - Abs(local.z) < faceDist)
 		{
-			closestFeature = newClosestFeature;
-			lastLeastDistance = leastDistance;
-			VERBOSE_LOG("Picked face with distance %.02f out of %d faces\n", leastDistance,
-					validFacesFound);
+			axis = 2;
+			faceDist = halfSize - Abs(local.z);
 		}
+		localNormal = {};
+		localNormal.v[axis] = local.v[axis] < 0 ? -1.0f : 1.0f;
+		closest.v[axis] = localNormal.v[axis] * halfSize;
+		depth = radius + faceDist;
+	}
+
+	v3 normal = QuaternionRotateVector(transformB->rotation, localNormal);
+	v3 onB = PrimitiveLocalToWorld(transformB, closest + colliderB->cube.offset);
+	v3 onA = center - normal * radius;
+
+	result->hitNormal = normal;
+	result->depth = depth;
+	result->hitPoints[0] = (onA + onB) * 0.5f;
+	result->hitDepths[0] = depth;
+	result->hitCount = 1;
+}
+
+void CollideSphereCylinder(const Transform *transformA, const Transform *transformB,
+		const Collider *colliderA, const Collider *colliderB, CollisionInfo *result)
+{
+	const f32 radius = colliderA->sphere.radius;
+	const f32 cylRadius = colliderB->cylinder.radius;
+	const f32 halfH = colliderB->cylinder.height * 0.5f;
+	v3 center = transformA->translation + colliderA->sphere.offset;
+	v3 local = PrimitiveWorldToLocal(transformB, center) - colliderB->cylinder.offset;
+
+	f32 lat = Sqrt(local.x * local.x + local.y * local.y);
+	v3 closest = local;
+	closest.z = Clamp(local.z, -halfH, halfH);
+	if (lat > cylRadius)
+	{
+		closest.x *= cylRadius / lat;
+		closest.y *= cylRadius / lat;
+	}
+	v3 delta = local - closest;
+	f32 sqrDist = V3SqrLen(delta);
+	if (sqrDist > radius * radius)
+		return;
 
-		// Expand polytope!
-		v3 testDir = V3Cross(closestFeature.c.dif - closestFeature.a.dif, closestFeature.b.dif - closestFeature.a.dif);
-		if (testDir.x == 0 && testDir.y == 0 && testDir.z == 0)
+	v3 localNormal;
+	f32 depth;
+	if (sqrDist > 0)
+	{
+		f32 dist = Sqrt(sqrDist);
+		localNormal = delta / dist;
+		depth = radius - dist;
+	}
+	else
+	{
+		// Center is inside, push out through the cap or the wall, whichever is closer.
+		f32 capDist = halfH - Abs(local.z);
+		f32 wallDist = cylRadius - lat;
+		if (capDist < wallDist || lat == 0)
 		{
-			// Feature is a line. Pick a direction towards the origin.
-			if (closestFeature.a.dif.x != 0 || closestFeature.a.dif.y != 0 || closestFeature.a.dif.z != 0)
-				testDir = -closestFeature.a.dif;
-			else if (closestFeature.b.dif.x != 0 || closestFeature.b.dif.y != 0 || closestFeature.b.dif.z != 0)
-				testDir = -closestFeature.b.dif;
-			else if (closestFeature.c.dif.x != 0 || closestFeature.c.dif.y != 0 || closestFeature.c.dif.z != 0)
-				testDir = -closestFeature.c.dif;
-			else
+			localNormal = { 0, 0, local.z < 0 ? -1.0f : 1.0f };
+			closest.z = localNormal.z * halfH;
+			depth = radius + capDist;
+		}
+		else
+		{
+			localNormal = { local.x / lat, local.y / lat, 0 };
+			closest.x = localNormal.x * cylRadius;
+			closest.y = localNormal.y * cylRadius;
+			depth = radius + wallDist;
+		}
+	}
+
+	v3 normal = QuaternionRotateVector(transformB->rotation, localNormal);
+	v3 onB = PrimitiveLocalToWorld(transformB, closest + colliderB->cylinder.offset);
+	v3 onA = center - normal * radius;
+
+	result->hitNormal = normal;
+	result->depth = depth;
+	result->hitPoints[0] = (onA + onB) * 0.5f;
+	result->hitDepths[0] = depth;
+	result->hitCount = 1;
+}
+
+// SAT for boxes and hulls. Contacts come from clipping the incident face against the sides of the
+// reference face, so a resting pair gets its whole manifold in one call instead of growing it
+// through the cached hit points over several steps.
+const int SAT_MAX_POLYGON_VERTICES = 64;
+// A face axis wins over an edge axis (and the first shape's face over the second's) unless the
+// other is clearly better. Stops the manifold flipping between features on near ties.
+const f32 SAT_PREFERENCE_RELATIVE = 0.95f;
+const f32 SAT_PREFERENCE_ABSOLUTE = 0.005f;
+// Incident points up to this far above the reference face are still kept, with a negative depth.
+// The solver treats them as touching, so a resting box that rocks a little keeps its corners instead
+// of dropping onto them again the next step.
+const f32 SAT_SPECULATIVE_DISTANCE = 0.01f;
+
+inline bool SATPrefer(f32 separation, f32 preferredSeparation)
+{
+	return separation > SAT_PREFERENCE_RELATIVE * preferredSeparation + SAT_PREFERENCE_ABSOLUTE;
+}
+
+struct SATBox
+{
+	v3 center;
+	v3 axes[3];
+	f32 halfSize;
+};
+
+SATBox GetSATBox(const Transform *transform, const Collider *c)
+{
+	SATBox box;
+	box.center = PrimitiveLocalToWorld(transform, c->cube.offset);
+	box.axes[0] = QuaternionRotateVector(transform->rotation, { 1, 0, 0 });
+	box.axes[1] = QuaternionRotateVector(transform->rotation, { 0, 1, 0 });
+	box.axes[2] = QuaternionRotateVector(transform->rotation, { 0, 0, 1 });
+	box.halfSize = c->cube.radius;
+	return box;
+}
+
+inline f32 SATBoxProjectedRadius(const SATBox *box, v3 axis)
+{
+	return box->halfSize * (Abs(V3Dot(box->axes[0], axis)) + Abs(V3Dot(box->axes[1], axis)) +
+			Abs(V3Dot(box->axes[2], axis)));
+}
+
+// Corners of the face with outward normal axes[axis] * sign.
+void GetSATBoxFace(const SATBox *box, int axis, f32 sign, v3 *corners)
+{
+	v3 faceCenter = box->center + box->axes[axis] * (sign * box->halfSize);
+	v3 u = box->axes[(axis + 1) % 3] * box->halfSize;
+	v3 v = box->axes[(axis + 2) % 3] * (sign * box->halfSize);
+	corners[0] = faceCenter + u + v;
+	corners[1] = faceCenter - u + v;
+	corners[2] = faceCenter - u - v;
+	corners[3] = faceCenter + u - v;
+}
+
+// Face of the box that's most anti-parallel to normal.
+void GetSATBoxIncidentFace(const SATBox *box, v3 normal, v3 *corners)
+{
+	int axis = 0;
+	f32 maxDot = V3Dot(box->axes[0], normal);
+	for (int i = 1; i < 3; ++i)
+	{
+		f32 dot = V3Dot(box->axes[i], normal);
+		if (Abs(dot) > Abs(maxDot))
+		{
+			axis = i;
+			maxDot = dot;
+		}
+	}
+	GetSATBoxFace(box, axis, maxDot > 0 ? -1.0f : 1.0f, corners);
+}
+
+inline v3 GetSATBoxSupport(const SATBox *box, v3 dir)
+{
+	v3 result = box->center;
+	for (int i = 0; i < 3; ++i)
+		result += box->axes[i] * (V3Dot(box->axes[i], dir) >= 0 ? box->halfSize : -box->halfSize);
+	return result;
+}
+
+// Edge of the box along axes[axis] that's furthest in dir.
+inline void GetSATBoxEdge(const SATBox *box, int axis, v3 dir, v3 *e0, v3 *e1)
+{
+	v3 edgeCenter = box->center;
+	for (int i = 0; i < 3; ++i)
+	{
+		if (i != axis)
+			edgeCenter += box->axes[i] * (V3Dot(box->axes[i], dir) >= 0 ? box->halfSize :
+					-box->halfSize);
+	}
+	*e0 = edgeCenter - box->axes[axis] * box->halfSize;
+	*e1 = edgeCenter + box->axes[axis] * box->halfSize;
+}
+
+// Sutherland-Hodgman, keeps the part of the polygon where dot(normal, p) <= distance.
+int ClipPolygon(const v3 *in, int inCount, v3 normal, f32 distance, v3 *out)
+{
+	int outCount = 0;
+	if (inCount == 0)
+		return 0;
+
+	v3 prev = in[inCount - 1];
+	f32 prevDist = V3Dot(normal, prev) - distance;
+	for (int i = 0; i < inCount; ++i)
+	{
+		v3 curr = in[i];
+		f32 currDist = V3Dot(normal, curr) - distance;
+		if ((prevDist <= 0) != (currDist <= 0))
+		{
+			ASSERT(outCount < SAT_MAX_POLYGON_VERTICES);
+			out[outCount++] = prev + (curr - prev) * (prevDist / (prevDist - currDist));
+		}
+		if (currDist <= 0)
+		{
+			ASSERT(outCount < SAT_MAX_POLYGON_VERTICES);
+			out[outCount++] = curr;
+		}
+		prev = curr;
+		prevDist = currDist;
+	}
+	return outCount;
+}
+
+// Picks up to 4 contacts spanning the most area: the deepest, the one furthest from it, the one
+// making the biggest triangle with those two and the one adding the most area outside of it.
+int ReduceContacts(const v3 *points, const f32 *depths, int count, v3 normal, int *indices)
+{
+	if (count <= 4)
+	{
+		for (int i = 0; i < count; ++i)
+			indices[i] = i;
+		return count;
+	}
+
+	int a = 0;
+	for (int i = 1; i < count; ++i)
+		if (depths[i] > depths[a])
+			a = i;
+
+	int b = a;
+	f32 maxSqrDist = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		f32 sqrDist = V3SqrLen(points[i] - points[a]);
+		if (sqrDist > maxSqrDist)
+		{
+			maxSqrDist = sqrDist;
+			b = i;
+		}
+	}
+	if (b == a)
+	{
+		indices[0] = a;
+		return 1;
+	}
+
+	int c = a;
+	f32 maxArea = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		f32 area = V3Dot(V3Cross(points[b] - points[a], points[i] - points[a]), normal);
+		if (Abs(area) > Abs(maxArea))
+		{
+			maxArea = area;
+			c = i;
+		}
+	}
+	if (c == a)
+	{
+		indices[0] = a;
+		indices[1] = b;
+		return 2;
+	}
+
+	// Wind the triangle so points outside of it give negative areas on some edge.
+	if (maxArea < 0)
+	{
+		int tmp = b;
+		b = c;
+		c = tmp;
+	}
+	const int triangle[3] = { a, b, c };
+	int d = -1;
+	f32 minArea = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		for (int edge = 0; edge < 3; ++edge)
+		{
+			v3 e0 = points[triangle[edge]];
+			v3 e1 = points[triangle[(edge + 1) % 3]];
+			f32 area = V3Dot(V3Cross(e1 - e0, points[i] - e0), normal);
+			if (area < minArea)
 			{
-				// Give up
-				Log("ERROR! EPA: Feature is a point at the origin. Don't know which way to continue.\n");
-				//ASSERT(false);
-				break;
+				minArea = area;
+				d = i;
 			}
 		}
-		GJKPoint newPoint = GJKSupport(transformB, transformA, colliderB, colliderA, testDir);
-		VERBOSE_LOG("Found new point { %.02f, %.02f. %.02f } while looking in direction { %.02f, %.02f. %.02f }\n",
-				newPoint.dif.x, newPoint.dif.y, newPoint.dif.z, testDir.x, testDir.y, testDir.z);
-#if DEBUG_BUILD
-		if (!g_debugContext->freezePolytopeGeom && epaStep < DebugContext::epaMaxSteps)
-			g_debugContext->epaNewPoint[epaStep] = newPoint.a;
-#endif
-		// Without a little epsilon here we can sometimes pick a point that's already part of the
-		// polytope, resulting in weird artifacts later on. I guess we could manually check for that
-		// but this should be good enough.
-		const f32 epsilon = 0.000001f;
-		if (V3Dot(testDir, newPoint.dif - closestFeature.a.dif) <= epsilon)
+	}
+
+	indices[0] = a;
+	indices[1] = b;
+	indices[2] = c;
+	if (d < 0)
+		return 3;
+	indices[3] = d;
+	return 4;
+}
+
+// Incident points already clipped to the sides of the reference face. The ones under the reference
+// plane, or barely above it, become contacts, halfway between the point and the plane. If none are
+// left, which happens when the reference face is tiny like on a curved hull, the incident shape's
+// deepest point is used.
+void SATAddFaceContacts(const v3 *points, int pointCount, v3 deepestPoint, v3 referenceNormal,
+		f32 referenceDistance, f32 separation, v3 hitNormal, CollisionInfo *result)
+{
+	v3 contacts[SAT_MAX_POLYGON_VERTICES];
+	f32 depths[SAT_MAX_POLYGON_VERTICES];
+	int contactCount = 0;
+	for (int i = 0; i < pointCount; ++i)
+	{
+		f32 pointSeparation = V3Dot(referenceNormal, points[i]) - referenceDistance;
+		if (pointSeparation > SAT_SPECULATIVE_DISTANCE)
+			continue;
+		contacts[contactCount] = points[i] - referenceNormal * (pointSeparation * 0.5f);
+		depths[contactCount] = -pointSeparation;
+		++contactCount;
+	}
+	if (contactCount == 0)
+	{
+		f32 pointSeparation = V3Dot(referenceNormal, deepestPoint) - referenceDistance;
+		contacts[0] = deepestPoint - referenceNormal * (pointSeparation * 0.5f);
+		depths[0] = Max(0.0f, -pointSeparation);
+		contactCount = 1;
+	}
+
+	int indices[4];
+	int keepCount = ReduceContacts(contacts, depths, contactCount, referenceNormal, indices);
+	result->hitNormal = hitNormal;
+	result->depth = -separation;
+	result->hitCount = keepCount;
+	for (int i = 0; i < keepCount; ++i)
+	{
+		result->hitPoints[i] = contacts[indices[i]];
+		result->hitDepths[i] = depths[indices[i]];
+	}
+}
+
+void SATAddEdgeContact(v3 a0, v3 a1, v3 b0, v3 b1, f32 separation, v3 hitNormal,
+		CollisionInfo *result)
+{
+	v3 onA, onB;
+	ClosestPointsBetweenSegments(a0, a1, b0, b1, &onA, &onB);
+	result->hitNormal = hitNormal;
+	result->depth = -separation;
+	result->hitPoints[0] = (onA + onB) * 0.5f;
+	result->hitDepths[0] = -separation;
+	result->hitCount = 1;
+}
+
+// Reference face is face (axis, sign) of box reference, incident face comes from the other box.
+void SATClipBoxes(const SATBox *reference, int axis, f32 sign, const SATBox *incident,
+		f32 separation, v3 hitNormal, CollisionInfo *result)
+{
+	v3 referenceNormal = reference->axes[axis] * sign;
+	v3 polygon[SAT_MAX_POLYGON_VERTICES];
+	v3 clipped[SAT_MAX_POLYGON_VERTICES];
+	GetSATBoxIncidentFace(incident, referenceNormal, polygon);
+	int count = 4;
+	for (int i = 1; i < 3; ++i)
+	{
+		v3 side = reference->axes[(axis + i) % 3];
+		f32 centerDist = V3Dot(side, reference->center);
+		count = ClipPolygon(polygon, count, side, centerDist + reference->halfSize, clipped);
+		count = ClipPolygon(clipped, count, -side, -centerDist + reference->halfSize, polygon);
+	}
+	f32 referenceDistance = V3Dot(referenceNormal, reference->center) + reference->halfSize;
+	SATAddFaceContacts(polygon, count, GetSATBoxSupport(incident, -referenceNormal),
+			referenceNormal, referenceDistance, separation, hitNormal, result);
+}
+
+// The 15 axes: 3 face normals of each box and the 9 cross products of their edges.
+void CollideCubeCube(const Transform *transformA, const Transform *transformB,
+		const Collider *colliderA, const Collider *colliderB, CollisionInfo *result)
+{
+	SATBox a = GetSATBox(transformA, colliderA);
+	SATBox b = GetSATBox(transformB, colliderB);
+	v3 aToB = b.center - a.center;
+
+	f32 faceSeparations[2] = { -INFINITY, -INFINITY };
+	int faceAxes[2] = {};
+	const SATBox *boxes[2] = { &a, &b };
+	for (int boxIdx = 0; boxIdx < 2; ++boxIdx)
+	{
+		for (int axis = 0; axis < 3; ++axis)
 		{
-			VERBOSE_LOG("Done! Couldn't find a closer point\n");
-			break;
+			v3 l = boxes[boxIdx]->axes[axis];
+			f32 separation = Abs(V3Dot(aToB, l)) - SATBoxProjectedRadius(&a, l) -
+				SATBoxProjectedRadius(&b, l);
+			if (separation > 0)
+				return;
+			if (separation > faceSeparations[boxIdx])
+			{
+				faceSeparations[boxIdx] = separation;
+				faceAxes[boxIdx] = axis;
+			}
 		}
-#if DEBUG_BUILD
-		else if (V3Dot(testDir, newPoint.dif - closestFeature.b.dif) <= epsilon)
+	}
+
+	f32 edgeSeparation = -INFINITY;
+	int edgeAxisA = 0, edgeAxisB = 0;
+	v3 edgeAxis = {};
+	for (int i = 0; i < 3; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
 		{
-			Log("ERROR! EPA: Redundant check triggered (B)\n");
-			//ASSERT(false);
-			break;
+			v3 l = V3Cross(a.axes[i], b.axes[j]);
+			f32 length = V3Length(l);
+			// Parallel edges, the face axes already cover this
+			if (length < 0.001f)
+				continue;
+			l = l / length;
+			f32 separation = Abs(V3Dot(aToB, l)) - SATBoxProjectedRadius(&a, l) -
+				SATBoxProjectedRadius(&b, l);
+			if (separation > 0)
+				return;
+			if (separation > edgeSeparation)
+			{
+				edgeSeparation = separation;
+				edgeAxisA = i;
+				edgeAxisB = j;
+				edgeAxis = l;
+			}
 		}
-		else if (V3Dot(testDir, newPoint.dif - closestFeature.c.dif) <= epsilon)
+	}
+
+	const bool useFaceB = SATPrefer(faceSeparations[1], faceSeparations[0]);
+	const f32 faceSeparation = useFaceB ? faceSeparations[1] : faceSeparations[0];
+	if (SATPrefer(edgeSeparation, faceSeparation))
+	{
+		// Point the axis from A to B
+		if (V3Dot(aToB, edgeAxis) < 0)
+			edgeAxis = -edgeAxis;
+		v3 a0, a1, b0, b1;
+		GetSATBoxEdge(&a, edgeAxisA, edgeAxis, &a0, &a1);
+		GetSATBoxEdge(&b, edgeAxisB, -edgeAxis, &b0, &b1);
+		SATAddEdgeContact(a0, a1, b0, b1, edgeSeparation, -edgeAxis, result);
+	}
+	else if (useFaceB)
+	{
+		int axis = faceAxes[1];
+		f32 sign = V3Dot(aToB, b.axes[axis]) > 0 ? -1.0f : 1.0f;
+		SATClipBoxes(&b, axis, sign, &a, faceSeparation, b.axes[axis] * sign, result);
+	}
+	else
+	{
+		int axis = faceAxes[0];
+		f32 sign = V3Dot(aToB, a.axes[axis]) >= 0 ? 1.0f : -1.0f;
+		SATClipBoxes(&a, axis, sign, &b, faceSeparation, -a.axes[axis] * sign, result);
+	}
+}
+
+// Same as box-box, with the hull's baked faces and edges. Runs in the hull's space. Edge pairs are
+// pruned on the Gauss map: a hull edge only builds a Minkowski face with a box edge along axis k if
+// its two face normals are on opposite sides of the plane perpendicular to k, and then it's the box
+// edge furthest along -axis.
+void CollideCubeConvexHull(const Transform *transformA, const Transform *transformB,
+		const Collider *colliderA, const Collider *colliderB, CollisionInfo *result)
+{
+	const Resource *res = colliderB->convexHull.meshRes;
+	if (!res)
+		return;
+	const ResourceCollisionMesh *mesh = &res->collisionMesh;
+	ASSERT(mesh->hullFaceCount > 0);
+	const f32 scale = colliderB->convexHull.scale;
+	const v3 *positions = mesh->positionData;
+
+	SATBox worldBox = GetSATBox(transformA, colliderA);
+	v4 invQ = QuaternionConjugate(transformB->rotation);
+	SATBox box;
+	box.center = PrimitiveWorldToLocal(transformB, worldBox.center);
+	for (int i = 0; i < 3; ++i)
+		box.axes[i] = QuaternionRotateVector(invQ, worldBox.axes[i]);
+	box.halfSize = worldBox.halfSize;
+
+	f32 hullFaceSeparation = -INFINITY;
+	u32 hullFace = 0;
+	for (u32 faceIdx = 0; faceIdx < mesh->hullFaceCount; ++faceIdx)
+	{
+		v4 plane = mesh->hullFacePlanes[faceIdx];
+		f32 separation = V3Dot(plane.xyz, box.center) - SATBoxProjectedRadius(&box, plane.xyz) -
+			plane.w * scale;
+		if (separation > 0)
+			return;
+		if (separation > hullFaceSeparation)
 		{
-			Log("ERROR! EPA: Redundant check triggered (C)\n");
-			//ASSERT(false);
-			break;
+			hullFaceSeparation = separation;
+			hullFace = faceIdx;
 		}
-#endif
-		FixedArray<EPAEdge, 256> holeEdges;
-		holeEdges.count = 0;
-		u32 oldPolytopeCount = polytope.count;
-		for (u32 faceIdx = 0; faceIdx < polytope.count; )
-		{
-			EPAFace *face = &polytope[faceIdx];
-			v3 normal = V3Cross(face->c.dif - face->a.dif, face->b.dif - face->a.dif);
-			// Ignore if not facing new point
-			if (V3Dot(normal, newPoint.dif - face->a.dif) <= 0)
+	}
+
+	f32 boxFaceSeparation = -INFINITY;
+	int boxFaceAxis = 0;
+	f32 boxFaceSign = 1;
+	u32 supportHint = mesh->hullStartVertex;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		for (int signIdx = 0; signIdx < 2; ++signIdx)
+		{
+			f32 sign = signIdx ? -1.0f : 1.0f;
+			v3 normal = box.axes[axis] * sign;
+			u32 support = HullSupport(mesh, -normal, &supportHint);
+			f32 separation = V3Dot(normal, positions[support] * scale - box.center) - box.halfSize;
+			if (separation > 0)
+				return;
+			if (separation > boxFaceSeparation)
 			{
-				++faceIdx;
+				boxFaceSeparation = separation;
+				boxFaceAxis = axis;
+				boxFaceSign = sign;
+			}
+		}
+	}
+
+	f32 edgeSeparation = -INFINITY;
+	u32 edgeIdx = 0;
+	int edgeBoxAxis = 0;
+	v3 edgeAxis = {};
+	for (u32 hullEdgeIdx = 0; hullEdgeIdx < mesh->hullEdgeCount; ++hullEdgeIdx)
+	{
+		const HullEdge *edge = &mesh->hullEdges[hullEdgeIdx];
+		v3 normalA = mesh->hullFacePlanes[edge->faceA].xyz;
+		v3 normalB = mesh->hullFacePlanes[edge->faceB].xyz;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			if (V3Dot(normalA, box.axes[axis]) * V3Dot(normalB, box.axes[axis]) >= 0)
 				continue;
+
+			v3 p0 = positions[edge->vertexA] * scale;
+			v3 p1 = positions[edge->vertexB] * scale;
+			v3 l = V3Cross(p1 - p0, box.axes[axis]);
+			f32 length = V3Length(l);
+			if (length < 0.0001f)
+				continue;
+			l = l / length;
+			// Out of the hull
+			if (V3Dot(l, normalA + normalB) < 0)
+				l = -l;
+
+			v3 b0, b1;
+			GetSATBoxEdge(&box, axis, -l, &b0, &b1);
+			f32 separation = V3Dot(l, b0 - p0);
+			if (separation > 0)
+				return;
+			if (separation > edgeSeparation)
+			{
+				edgeSeparation = separation;
+				edgeIdx = hullEdgeIdx;
+				edgeBoxAxis = axis;
+				edgeAxis = l;
 			}
+		}
+	}
 
-			// Add/remove edges to the hole (XOR)
-			EPAEdge faceEdges[3] =
+	v3 polygon[SAT_MAX_POLYGON_VERTICES];
+	v3 clipped[SAT_MAX_POLYGON_VERTICES];
+	const bool useHullFace = SATPrefer(hullFaceSeparation, boxFaceSeparation);
+	const f32 faceSeparation = useHullFace ? hullFaceSeparation : boxFaceSeparation;
+	if (SATPrefer(edgeSeparation, faceSeparation))
+	{
+		const HullEdge *edge = &mesh->hullEdges[edgeIdx];
+		v3 b0, b1;
+		GetSATBoxEdge(&box, edgeBoxAxis, -edgeAxis, &b0, &b1);
+		SATAddEdgeContact(b0, b1, positions[edge->vertexA] * scale,
+				positions[edge->vertexB] * scale, edgeSeparation, edgeAxis, result);
+	}
+	else if (useHullFace)
+	{
+		v4 plane = mesh->hullFacePlanes[hullFace];
+		GetSATBoxIncidentFace(&box, plane.xyz, polygon);
+		int count = 4;
+		const u32 begin = mesh->hullFaceOffsets[hullFace];
+		const u32 end = mesh->hullFaceOffsets[hullFace + 1];
+		for (u32 i = begin; i < end; ++i)
+		{
+			v3 v0 = positions[mesh->hullFaceVertices[i]] * scale;
+			v3 v1 = positions[mesh->hullFaceVertices[i + 1 < end ? i + 1 : begin]] * scale;
+			// Faces go counter-clockwise, so this points out of the face
+			v3 side = V3Normalize(V3Cross(v1 - v0, plane.xyz));
+			count = ClipPolygon(polygon, count, side, V3Dot(side, v0), clipped);
+			memcpy(polygon, clipped, count * sizeof(v3));
+		}
+		SATAddFaceContacts(polygon, count, GetSATBoxSupport(&box, -plane.xyz), plane.xyz,
+				plane.w * scale, faceSeparation, plane.xyz, result);
+	}
+	else
+	{
+		v3 referenceNormal = box.axes[boxFaceAxis] * boxFaceSign;
+
+		// Most anti-parallel face around the deepest vertex. Looking through all faces could pick a
+		// parallel one somewhere else on the hull that clips away to nothing.
+		u32 deepestVertex = HullSupport(mesh, -referenceNormal, &supportHint);
+		u32 incidentFace = 0;
+		f32 minDot = INFINITY;
+		for (u32 faceIdx = 0; faceIdx < mesh->hullFaceCount; ++faceIdx)
+		{
+			f32 dot = V3Dot(mesh->hullFacePlanes[faceIdx].xyz, referenceNormal);
+			if (dot >= minDot)
+				continue;
+			const u32 end = mesh->hullFaceOffsets[faceIdx + 1];
+			for (u32 i = mesh->hullFaceOffsets[faceIdx]; i < end; ++i)
 			{
-				{ face->a, face->b },
-				{ face->b, face->c },
-				{ face->c, face->a }
-			};
-			for (int edgeIdx = 0; edgeIdx < 3; ++edgeIdx)
+				if (mesh->hullFaceVertices[i] == deepestVertex)
+				{
+					minDot = dot;
+					incidentFace = faceIdx;
+					break;
+				}
+			}
+		}
+		const u32 begin = mesh->hullFaceOffsets[incidentFace];
+		const u32 end = mesh->hullFaceOffsets[incidentFace + 1];
+		ASSERT(end - begin <= SAT_MAX_POLYGON_VERTICES - 4);
+		int count = 0;
+		for (u32 i = begin; i < end; ++i)
+			polygon[count++] = positions[mesh->hullFaceVertices[i]] * scale;
+
+		for (int i = 1; i < 3; ++i)
+		{
+			v3 side = box.axes[(boxFaceAxis + i) % 3];
+			f32 centerDist = V3Dot(side, box.center);
+			count = ClipPolygon(polygon, count, side, centerDist + box.halfSize, clipped);
+			count = ClipPolygon(clipped, count, -side, -centerDist + box.halfSize, polygon);
+		}
+		f32 referenceDistance = V3Dot(referenceNormal, box.center) + box.halfSize;
+		SATAddFaceContacts(polygon, count, positions[deepestVertex] * scale, referenceNormal,
+				referenceDistance, faceSeparation, -referenceNormal, result);
+	}
+
+	// Back to world space
+	result->hitNormal = QuaternionRotateVector(transformB->rotation, result->hitNormal);
+	for (int i = 0; i < result->hitCount; ++i)
+		result->hitPoints[i] = PrimitiveLocalToWorld(transformB, result->hitPoints[i]);
+}
+
+// For the (B, A) entries of the table.
+template <AnalyticCollisionProc proc>
+void CollideSwapped(const Transform *transformA, const Transform *transformB,
+		const Collider *colliderA, const Collider *colliderB, CollisionInfo *result)
+{
+	proc(transformB, transformA, colliderB, colliderA, result);
+	result->hitNormal = -result->hitNormal;
+}
+
+// Indexed [colliderA->type][colliderB->type]. Pairs left null go through GJK and EPA.
+const AnalyticCollisionProc g_analyticCollisionProcs[COLLIDER_TYPE_COUNT][COLLIDER_TYPE_COUNT] =
+{
+	// COLLIDER_CONVEX_HULL
+	{ nullptr, CollideSwapped<CollideCubeConvexHull>, nullptr, nullptr, nullptr },
+	// COLLIDER_CUBE
+	{ CollideCubeConvexHull, CollideCubeCube, CollideSwapped<CollideSphereCube>, nullptr, nullptr },
+	// COLLIDER_SPHERE
+	{ nullptr, CollideSphereCube, CollideSphereSphere, CollideSphereCylinder, CollideSphereCapsule },
+	// COLLIDER_CYLINDER
+	{ nullptr, nullptr, CollideSwapped<CollideSphereCylinder>, nullptr, nullptr },
+	// COLLIDER_CAPSULE
+	{ nullptr, nullptr, CollideSwapped<CollideSphereCapsule>, nullptr, CollideCapsuleCapsule },
+};
+
+// EPA
+// Expanding only stops once the new support point is at most this much further out than the closest
+// face, or after EPA_MAX_ITERATIONS expansions.
+const f32 EPA_TOLERANCE = 0.0001f;
+const int EPA_MAX_ITERATIONS = 128;
+
+struct EPAPolytopeFace
+{
+	// Indices into EPAPolytope::vertices, same winding as EPAFace.
+	u32 vertices[3];
+	// Face across edge i (vertices[i] to vertices[(i + 1) % 3]) and which of its edges that is.
+	u32 neighbours[3];
+	u8 neighbourEdges[3];
+	// Removed from the polytope. Their heap entries stay until they're popped.
+	bool obsolete;
+	// Outward unit normal and distance from the origin along it.
+	v3 normal;
+	f32 distance;
+};
+
+struct EPAHeapEntry
+{
+	f32 distance;
+	u32 faceIdx;
+};
+
+struct EPAHorizonEdge
+{
+	u32 faceIdx;
+	u32 edgeIdx;
+};
+
+struct EPAPolytope
+{
+	DynamicArray<GJKPoint, FrameAllocator> vertices;
+	DynamicArray<EPAPolytopeFace, FrameAllocator> faces;
+	// Binary min-heap on face distance.
+	DynamicArray<EPAHeapEntry, FrameAllocator> heap;
+};
+
+struct EPAResult
+{
+	bool hit;
+	EPAFace closestFeature;
+	v3 normal;
+	f32 depth;
+	int iterations;
+	// Faces ever made, including removed ones.
+	u32 faceCount;
+};
+
+void EPAHeapPush(EPAPolytope *polytope, EPAHeapEntry entry)
+{
+	DynamicArray<EPAHeapEntry, FrameAllocator> &heap = polytope->heap;
+	DynamicArrayAdd(&heap);
+	u64 idx = heap.count - 1;
+	while (idx > 0)
+	{
+		u64 parentIdx = (idx - 1) / 2;
+		if (heap[parentIdx].distance <= entry.distance)
+			break;
+		heap[idx] = heap[parentIdx];
+		idx = parentIdx;
+	}
+	heap[idx] = entry;
+}
+
+EPAHeapEntry EPAHeapPop(EPAPolytope *polytope)
+{
+	DynamicArray<EPAHeapEntry, FrameAllocator> &heap = polytope->heap;
+	ASSERT(heap.count > 0);
+	EPAHeapEntry result = heap[0];
+	EPAHeapEntry last = heap[--heap.count];
+	u64 idx = 0;
+	while (true)
+	{
+		u64 childIdx = idx * 2 + 1;
+		if (childIdx >= heap.count)
+			break;
+		if (childIdx + 1 < heap.count && heap[childIdx + 1].distance < heap[childIdx].distance)
+			++childIdx;
+		if (last.distance <= heap[childIdx].distance)
+			break;
+		heap[idx] = heap[childIdx];
+		idx = childIdx;
+	}
+	if (heap.count)
+		heap[idx] = last;
+	return result;
+}
+
+// Neighbours are left unlinked. Degenerate faces are kept so the adjacency stays closed, but never
+// go in the heap.
+u32 EPAAddFace(EPAPolytope *polytope, u32 v0, u32 v1, u32 v2)
+{
+	const v3 a = polytope->vertices[v0].dif;
+	const v3 b = polytope->vertices[v1].dif;
+	const v3 c = polytope->vertices[v2].dif;
+
+	u32 faceIdx = (u32)polytope->faces.count;
+	EPAPolytopeFace *face = DynamicArrayAdd(&polytope->faces);
+	*face = {};
+	face->vertices[0] = v0;
+	face->vertices[1] = v1;
+	face->vertices[2] = v2;
+	for (int i = 0; i < 3; ++i)
+		face->neighbours[i] = U32_MAX;
+
+	v3 normal = V3Cross(c - a, b - a);
+	f32 sqrLen = V3SqrLen(normal);
+	if (sqrLen > 0)
+	{
+		face->normal = normal / Sqrt(sqrLen);
+		face->distance = V3Dot(face->normal, a);
+		EPAHeapPush(polytope, { face->distance, faceIdx });
+	}
+	return faceIdx;
+}
+
+// Links unlinked edges among faces [firstFaceIdx, faces.count) that share vertices the other way
+// around. Returns false if any edge is left without a neighbour.
+bool EPALinkFaces(EPAPolytope *polytope, u32 firstFaceIdx)
+{
+	bool closed = true;
+	const u32 faceCount = (u32)polytope->faces.count;
+	for (u32 faceIdx = firstFaceIdx; faceIdx < faceCount; ++faceIdx)
+	{
+		EPAPolytopeFace *face = &polytope->faces[faceIdx];
+		for (u32 edgeIdx = 0; edgeIdx < 3; ++edgeIdx)
+		{
+			if (face->neighbours[edgeIdx] != U32_MAX)
+				continue;
+			u32 v0 = face->vertices[edgeIdx];
+			u32 v1 = face->vertices[(edgeIdx + 1) % 3];
+			for (u32 otherIdx = faceIdx + 1; otherIdx < faceCount; ++otherIdx)
 			{
-				const EPAEdge &edge = faceEdges[edgeIdx];
-				// If it's already on the list, remove it
-				bool found = false;
-				for (u32 holeEdgeIdx = 0; holeEdgeIdx < holeEdges.count; ++holeEdgeIdx)
+				EPAPolytopeFace *other = &polytope->faces[otherIdx];
+				for (u32 otherEdgeIdx = 0; otherEdgeIdx < 3; ++otherEdgeIdx)
 				{
-					const EPAEdge &holeEdge = holeEdges[holeEdgeIdx];
-					if ((edge.a.dif == holeEdge.a.dif && edge.b.dif == holeEdge.b.dif) ||
-						(edge.a.dif == holeEdge.b.dif && edge.b.dif == holeEdge.a.dif))
+					if (other->neighbours[otherEdgeIdx] == U32_MAX &&
+						other->vertices[otherEdgeIdx] == v1 &&
+						other->vertices[(otherEdgeIdx + 1) % 3] == v0)
 					{
-						holeEdges[holeEdgeIdx] = holeEdges[--holeEdges.count];
-						found = true;
-						break;
+						face->neighbours[edgeIdx] = otherIdx;
+						face->neighbourEdges[edgeIdx] = (u8)otherEdgeIdx;
+						other->neighbours[otherEdgeIdx] = faceIdx;
+						other->neighbourEdges[otherEdgeIdx] = (u8)edgeIdx;
+						goto linked;
 					}
 				}
-				// Otherwise add it
-				if (!found)
-					*FixedArrayAdd(&holeEdges) = edge;
 			}
-			// Remove face from polytope
-			polytope[faceIdx] = polytope[--polytope.count];
+			closed = false;
+linked:;
 		}
-		u32 deletedFaces = oldPolytopeCount - polytope.count;
-		VERBOSE_LOG("Deleted %d faces which were facing new point\n", deletedFaces);
-		VERBOSE_LOG("Presumably left a hole with %d edges\n", holeEdges.count);
-		if (deletedFaces > 1 && holeEdges.count >= deletedFaces * 3)
+	}
+	return closed;
+}
+
+// Crossing into faceIdx over its edge edgeIdx. Faces that can see the point are removed and walked
+// through, the edges into ones that can't are the horizon, found in winding order.
+void EPAFindHorizon(EPAPolytope *polytope, u32 faceIdx, u32 edgeIdx, v3 point,
+		DynamicArray<EPAHorizonEdge, FrameAllocator> *horizon)
+{
+	EPAPolytopeFace *face = &polytope->faces[faceIdx];
+	if (face->obsolete)
+		return;
+
+	if (V3Dot(face->normal, point) - face->distance <= 0)
+	{
+		*DynamicArrayAdd(horizon) = { faceIdx, edgeIdx };
+		return;
+	}
+
+	face->obsolete = true;
+	for (u32 i = 1; i < 3; ++i)
+	{
+		u32 nextEdgeIdx = (edgeIdx + i) % 3;
+		EPAFindHorizon(polytope, face->neighbours[nextEdgeIdx], face->neighbourEdges[nextEdgeIdx],
+				point, horizon);
+	}
+}
+
+EPAFace EPAGetFace(const EPAPolytope *polytope, u32 faceIdx)
+{
+	const EPAPolytopeFace *face = &polytope->faces[faceIdx];
+	return {
+		polytope->vertices[face->vertices[0]],
+		polytope->vertices[face->vertices[1]],
+		polytope->vertices[face->vertices[2]] };
+}
+
+#if DEBUG_BUILD
+void EPACaptureStep(const EPAPolytope *polytope, u32 closestFaceIdx, int step)
+{
+	if (g_debugContext->freezePolytopeGeom || step >= DebugContext::epaMaxSteps)
+		return;
+
+	DebugVertex *buffer = g_debugContext->polytopeSteps[step];
+	int *vertexCount = &g_debugContext->polytopeStepsVertexCounts[step];
+	if (g_debugContext->drawEPAClosestFeature)
+	{
+		EPAFace closestFeature = EPAGetFace(polytope, closestFaceIdx);
+		GenPolytopeMesh({ &closestFeature, 1 }, buffer, vertexCount,
+				DebugContext::epaMaxStepVertices);
+	}
+	else
+	{
+		*vertexCount = 0;
+		for (u32 faceIdx = 0; faceIdx < polytope->faces.count; ++faceIdx)
 		{
-			Log("ERROR! EPA: Multiple holes were made on the polytope!\n");
+			if (polytope->faces[faceIdx].obsolete)
+				continue;
+			EPAFace face = EPAGetFace(polytope, faceIdx);
+			int faceVertexCount;
+			GenPolytopeMesh({ &face, 1 }, buffer + *vertexCount, &faceVertexCount,
+					DebugContext::epaMaxStepVertices - *vertexCount);
+			*vertexCount += faceVertexCount;
+		}
+	}
+	g_debugContext->epaStepCount = step + 1;
+}
+#endif
+
+// Grows the simplex GJK ended with (which has to contain the origin) into the Minkowski difference
+// until it finds the face closest to the origin. Faces live in a min-heap on distance, and the part
+// of the polytope the new point can see is found by walking face adjacency from the closest face.
+EPAResult EPATest(Transform *transformA, Transform *transformB, Collider *colliderA,
+		Collider *colliderB, const GJKResult *gjkResult, u32 *hullVertexA, u32 *hullVertexB)
+{
+	EPAResult result = {};
+
 #if DEBUG_BUILD
-			if (!g_debugContext->freezePolytopeGeom && epaStep < DebugContext::epaMaxSteps - 1)
+	const bool captureSteps = t_threadIndex == 0;
+	if (captureSteps && g_debugContext->polytopeSteps[0] == nullptr)
+	{
+		for (u32 i = 0; i < ArrayCount(g_debugContext->polytopeSteps); ++i)
+			g_debugContext->polytopeSteps[i] = ALLOC_N(TransientAllocator, DebugVertex,
+					DebugContext::epaMaxStepVertices);
+	}
+#endif
+
+	VERBOSE_LOG("\n\nNew EPA calculation\n");
+
+	// We don't need depenetration if we have a degenerate polytope (a zero-volume polytope)
+	const f32 epsilon = 0.000001f;
+	for (int i = 0; i < 4; ++i)
+		for (int j = 0; j < i; ++j)
+			if (V3EqualWithEpsilon(gjkResult->points[i].dif, gjkResult->points[j].dif, epsilon))
+				return result;
+
+	EPAPolytope polytope;
+	DynamicArrayInit(&polytope.vertices, 32);
+	DynamicArrayInit(&polytope.faces, 64);
+	DynamicArrayInit(&polytope.heap, 64);
+	DynamicArray<EPAHorizonEdge, FrameAllocator> horizon;
+	DynamicArrayInit(&horizon, 16);
+
+	for (int i = 0; i < 4; ++i)
+		*DynamicArrayAdd(&polytope.vertices) = gjkResult->points[i];
+
+	// a = 3, b = 2, c = 1, d = 0. We took care during GJK to ensure the BCD triangle faces away from
+	// the origin, and we know A is on the opposite side of it.
+	EPAAddFace(&polytope, 2, 0, 1);
+	EPAAddFace(&polytope, 3, 2, 1);
+	EPAAddFace(&polytope, 3, 1, 0);
+	EPAAddFace(&polytope, 3, 0, 2);
+	if (!EPALinkFaces(&polytope, 0))
+	{
+#if EPA_ERROR_LOGGING
+		Log("ERROR! EPA: Initial tetrahedron isn't closed\n");
+#endif
+		return result;
+	}
+
+	u32 closestFaceIdx = U32_MAX;
+	int epaStep = 0;
+	for (;; ++epaStep)
+	{
+		// Pop the closest face still in the polytope.
+		closestFaceIdx = U32_MAX;
+		while (polytope.heap.count)
+		{
+			EPAHeapEntry entry = EPAHeapPop(&polytope);
+			if (!polytope.faces[entry.faceIdx].obsolete)
 			{
-				GenPolytopeMesh(polytope, g_debugContext->polytopeSteps[epaStep + 1],
-						&g_debugContext->polytopeStepsVertexCounts[epaStep + 1]);
-				g_debugContext->epaNewPoint[epaStep + 1] = newPoint.a;
-				g_debugContext->epaStepCount = epaStep + 1;
-				g_debugContext->freezePolytopeGeom = true;
+				closestFaceIdx = entry.faceIdx;
+				break;
 			}
+		}
+		if (closestFaceIdx == U32_MAX)
+		{
+#if EPA_ERROR_LOGGING
+			Log("ERROR! EPA: Couldn't find closest feature!\n");
+#endif
+			// Collision is probably on the very edge, we don't need depenetration
+			return result;
+		}
+
+#if DEBUG_BUILD
+		// Save polytope for debug visualization
+		if (captureSteps)
+			EPACaptureStep(&polytope, closestFaceIdx, epaStep);
+#endif
+
+		if (epaStep == EPA_MAX_ITERATIONS)
+		{
+			// Curved shapes can keep adding points that are barely further out. The closest face is
+			// already good enough by now.
+			VERBOSE_LOG("Ending because we ran out of iterations\n");
+			break;
+		}
+
+		const EPAPolytopeFace closestFace = polytope.faces[closestFaceIdx];
+		GJKPoint newPoint = GJKSupport(transformB, transformA, colliderB, colliderA,
+				closestFace.normal, hullVertexB, hullVertexA);
+		VERBOSE_LOG("Found new point { %.02f, %.02f. %.02f } for face at distance %.02f\n",
+				newPoint.dif.x, newPoint.dif.y, newPoint.dif.z, closestFace.distance);
+#if DEBUG_BUILD
+		if (captureSteps && !g_debugContext->freezePolytopeGeom &&
+				epaStep < DebugContext::epaMaxSteps)
+			g_debugContext->epaNewPoint[epaStep] = newPoint.a;
 #endif
+		if (V3Dot(closestFace.normal, newPoint.dif) - closestFace.distance <= EPA_TOLERANCE)
+		{
+			VERBOSE_LOG("Done! Couldn't find a closer point\n");
+			break;
 		}
-		oldPolytopeCount = polytope.count;
-		// Now we should have a hole in the polytope, of which all edges are in holeEdges
 
-		for (u32 holeEdgeIdx = 0; holeEdgeIdx < holeEdges.count; ++holeEdgeIdx)
+		// Remove every face that can see the new point, starting from the closest one (which can see
+		// it by now), and collect the edges of the hole in winding order.
+		u32 newPointIdx = (u32)polytope.vertices.count;
+		*DynamicArrayAdd(&polytope.vertices) = newPoint;
+		horizon.count = 0;
+		polytope.faces[closestFaceIdx].obsolete = true;
+		for (u32 edgeIdx = 0; edgeIdx < 3; ++edgeIdx)
 		{
-			const EPAEdge &holeEdge = holeEdges[holeEdgeIdx];
-			EPAFace newFace = { holeEdge.a, holeEdge.b, newPoint };
-			*FixedArrayAdd(&polytope) = newFace;
+			EPAFindHorizon(&polytope, closestFace.neighbours[edgeIdx],
+					closestFace.neighbourEdges[edgeIdx], newPoint.dif, &horizon);
+		}
+
+		// Fill the hole with a fan of faces to the new point.
+		const u32 firstNewFaceIdx = (u32)polytope.faces.count;
+		for (u32 horizonIdx = 0; horizonIdx < horizon.count; ++horizonIdx)
+		{
+			EPAHorizonEdge edge = horizon[horizonIdx];
+			EPAPolytopeFace *outerFace = &polytope.faces[edge.faceIdx];
+			u32 v0 = outerFace->vertices[edge.edgeIdx];
+			u32 v1 = outerFace->vertices[(edge.edgeIdx + 1) % 3];
+
+			u32 newFaceIdx = EPAAddFace(&polytope, v1, v0, newPointIdx);
+			EPAPolytopeFace *newFace = &polytope.faces[newFaceIdx];
+			outerFace = &polytope.faces[edge.faceIdx];
+			newFace->neighbours[0] = edge.faceIdx;
+			newFace->neighbourEdges[0] = (u8)edge.edgeIdx;
+			outerFace->neighbours[edge.edgeIdx] = newFaceIdx;
+			outerFace->neighbourEdges[edge.edgeIdx] = 0;
+		}
+		VERBOSE_LOG("Replaced faces around a horizon of %d edges. Polytope now has %d faces\n",
+				horizon.count, polytope.faces.count);
+		if (!EPALinkFaces(&polytope, firstNewFaceIdx))
+		{
+			// Only happens when rounding made the visible region not simply connected. Stop with what
+			// we had before this step.
+#if EPA_ERROR_LOGGING
+			Log("ERROR! EPA: Multiple holes were made on the polytope!\n");
+#endif
+#if DEBUG_BUILD
+			if (captureSteps)
+			{
+				EPACaptureStep(&polytope, closestFaceIdx, epaStep + 1);
+				g_debugContext->freezePolytopeGeom = true;
+			}
+#endif
+			break;
 		}
-		VERBOSE_LOG("Added %d faces to fill the hole. Polytope now has %d faces\n",
-				polytope.count - oldPolytopeCount, polytope.count);
 	}
 
-	CollisionInfo result;
-	result.hitCount = 1;
+	const EPAPolytopeFace *closestFace = &polytope.faces[closestFaceIdx];
+	result.hit = true;
+	result.closestFeature = EPAGetFace(&polytope, closestFaceIdx);
+	result.normal = closestFace->normal;
+	result.depth = closestFace->distance;
+	result.iterations = epaStep;
+	result.faceCount = (u32)polytope.faces.count;
+	return result;
+}
 
-	v3 closestFeatureNor = V3Normalize(V3Cross(closestFeature.c.dif - closestFeature.a.dif,
-			closestFeature.b.dif - closestFeature.a.dif));
+// Continuous collision: time of impact by conservative advancement. Bodies are moved along their
+// path in steps that can't take them past each other, each as long as the distance between them
+// over how fast that distance could be closing.
+const f32 CCD_DISTANCE_TOLERANCE = 0.001f;
+const int CCD_DISTANCE_MAX_ITERATIONS = 32;
+const int CCD_MAX_ITERATIONS = 32;
 
-	result.hitNormal = closestFeatureNor;
-	result.depth = V3Dot(closestFeatureNor, closestFeature.a.dif);
+// Where a collider goes over a physics step, from t = 0 to t = 1.
+struct ColliderSweep
+{
+	Transform start;
+	Transform end;
+};
 
-#if DEBUG_BUILD
-	// Save last step
-	int lastStep = g_debugContext->epaStepCount;
-	if (!g_debugContext->freezePolytopeGeom && lastStep < DebugContext::epaMaxSteps)
+struct TimeOfImpactResult
+{
+	bool hit;
+	f32 t;
+	// From B to A, at t.
+	v3 normal;
+	// How fast the pair gets closer along the normal from translation alone, per unit of t.
+	f32 linearClosingSpeed;
+	int iterations;
+};
+
+inline Transform ColliderSweepAt(const ColliderSweep *sweep, f32 t)
+{
+	Transform result = sweep->end;
+	result.translation = sweep->start.translation * (1.0f - t) + sweep->end.translation * t;
+	result.rotation = QuaternionNlerp(sweep->start.rotation, sweep->end.rotation, t);
+	return result;
+}
+
+// Radius of a sphere around the transform's origin containing the collider.
+f32 ColliderBoundingRadius(Collider *c)
+{
+	Transform identity = {};
+	v3 min, max;
+	GetAABB(&identity, c, &min, &max);
+	v3 extent = { Max(Abs(min.x), Abs(max.x)), Max(Abs(min.y), Abs(max.y)),
+		Max(Abs(min.z), Abs(max.z)) };
+	return V3Length(extent);
+}
+
+// Distance between two separate convex colliders, from support points only. Gilbert's distance
+// algorithm on segments: v is the closest point of A - B to the origin found so far, and nothing
+// in A - B is closer than v.w / |v|, w being the support along -v. Returns that lower bound, or 0
+// if they look to be touching. outNormal goes from B to A.
+f32 ColliderDistanceLowerBound(Transform *transformA, Transform *transformB, Collider *colliderA,
+		Collider *colliderB, v3 *outNormal, u32 *hullVertexA, u32 *hullVertexB)
+{
+	v3 dir = transformA->translation - transformB->translation;
+	if (V3EqualWithEpsilon(dir, {}, 0.000001f))
+		dir = { 0, 0, 1 };
+	v3 v = GJKSupport(transformA, transformB, colliderA, colliderB, dir, hullVertexA,
+			hullVertexB).dif;
+
+	f32 lowerBound = 0;
+	for (int iteration = 0; iteration < CCD_DISTANCE_MAX_ITERATIONS; ++iteration)
 	{
-		if (g_debugContext->drawEPAClosestFeature)
-		{
-			GenPolytopeMesh({ &closestFeature, 1 }, g_debugContext->polytopeSteps[lastStep],
-					&g_debugContext->polytopeStepsVertexCounts[lastStep]);
-		}
-		else
+		f32 vLength = V3Length(v);
+		if (vLength <= CCD_DISTANCE_TOLERANCE)
+			return 0;
+		*outNormal = v / vLength;
+
+		v3 w = GJKSupport(transformA, transformB, colliderA, colliderB, -v, hullVertexA,
+				hullVertexB).dif;
+		lowerBound = Max(lowerBound, V3Dot(w, *outNormal));
+		if (vLength - lowerBound <= CCD_DISTANCE_TOLERANCE)
+			break;
+
+		// Closest point to the origin on segment vw.
+		v3 vw = w - v;
+		f32 vwLengthSqr = V3SqrLen(vw);
+		if (vwLengthSqr == 0)
+			break;
+		v += vw * Clamp(-V3Dot(v, vw) / vwLengthSqr, 0.0f, 1.0f);
+	}
+	return lowerBound;
+}
+
+// First time in [0, 1] the two sweeps get within targetDistance of each other. Only meant for
+// pairs that start out apart, touching ones are the contact solver's business and hit at t = 0.
+TimeOfImpactResult TimeOfImpact(Collider *colliderA, Collider *colliderB,
+		const ColliderSweep *sweepA, const ColliderSweep *sweepB, f32 targetDistance)
+{
+	TimeOfImpactResult result = {};
+
+	// Fastest any point on a collider can move from rotation, per unit of t.
+	auto rotationSpeedBound = [](Collider *collider, const ColliderSweep *sweep)
+	{
+		f32 cosHalfAngle = Min(Abs(V4Dot(sweep->start.rotation, sweep->end.rotation)), 1.0f);
+		return 2.0f * Acos(cosHalfAngle) * ColliderBoundingRadius(collider);
+	};
+	const f32 angularBound = rotationSpeedBound(colliderA, sweepA) +
+		rotationSpeedBound(colliderB, sweepB);
+	const v3 relativeMotion = (sweepA->end.translation - sweepA->start.translation) -
+		(sweepB->end.translation - sweepB->start.translation);
+
+	u32 hullVertexA = U32_MAX;
+	u32 hullVertexB = U32_MAX;
+	f32 t = 0;
+	for (result.iterations = 0; result.iterations < CCD_MAX_ITERATIONS; ++result.iterations)
+	{
+		Transform transformA = ColliderSweepAt(sweepA, t);
+		Transform transformB = ColliderSweepAt(sweepB, t);
+		v3 normal = {};
+		f32 distance = ColliderDistanceLowerBound(&transformA, &transformB, colliderA, colliderB,
+				&normal, &hullVertexA, &hullVertexB);
+		f32 linearClosingSpeed = -V3Dot(relativeMotion, normal);
+		if (distance <= targetDistance)
 		{
-			GenPolytopeMesh(polytope, g_debugContext->polytopeSteps[lastStep],
-					&g_debugContext->polytopeStepsVertexCounts[lastStep]);
+			result.hit = true;
+			result.t = t;
+			result.normal = normal;
+			result.linearClosingSpeed = linearClosingSpeed;
+			return result;
 		}
-		g_debugContext->epaStepCount = lastStep + 1;
+
+		f32 closingSpeedBound = linearClosingSpeed + angularBound;
+		if (closingSpeedBound <= 0)
+			return result;
+		t += (distance - targetDistance) / closingSpeedBound;
+		if (t > 1.0f)
+			return result;
+	}
+
+	// Out of iterations, stop where we got. It's still short of the impact.
+	result.hit = true;
+	result.t = t;
+	return result;
+}
+
+// Doesn't write to gameState, so it can run on several threads at once. The updated hit points for
+// the pair go to outCache instead and are only meaningful if there was a hit; the caller stores them
+// back into the pair's ContactManifold. outGJKCache is always written and goes back into the
+// manifold the same way. outAnalytic is set when the pair had a closed form routine, those still
+// get a manifold for the solver's impulses but have no hit points or GJK state to keep.
+CollisionInfo TestCollision(const GameState *gameState, Transform *transformA, Transform *transformB,
+		Collider *colliderA, Collider *colliderB, FixedArray<CachedHitPoint, 8> *outCache,
+		GJKCache *outGJKCache, int *outGJKIterations, bool *outAnalytic)
+{
+	AnalyticCollisionProc analyticProc = g_analyticCollisionProcs[colliderA->type][colliderB->type];
+#if DEBUG_BUILD
+	if (g_debugContext->disableAnalyticCollision)
+		analyticProc = nullptr;
+#endif
+	*outAnalytic = analyticProc != nullptr;
+	if (analyticProc)
+	{
+		*outCache = {};
+		*outGJKCache = {};
+		outGJKCache->hullVertexA = U32_MAX;
+		outGJKCache->hullVertexB = U32_MAX;
+		*outGJKIterations = 0;
+
+		CollisionInfo result = {};
+		analyticProc(transformA, transformB, colliderA, colliderB, &result);
+		return result;
 	}
+
+	CollisionPair key = { colliderA->entityHandle, colliderB->entityHandle };
+	const ContactManifold *manifold = HashMapGet(gameState->contactManifolds, key);
+	const GJKCache *warmStart = manifold ? &manifold->gjkCache : nullptr;
+#if DEBUG_BUILD
+	if (g_debugContext->disableGJKWarmStart)
+		warmStart = nullptr;
 #endif
 
+	u32 hullVertexA = U32_MAX;
+	u32 hullVertexB = U32_MAX;
+	if (warmStart)
+	{
+		hullVertexA = warmStart->hullVertexA;
+		hullVertexB = warmStart->hullVertexB;
+	}
+
+	GJKResult gjkResult = GJKTest(transformA, transformB, colliderA, colliderB, warmStart,
+			&hullVertexA, &hullVertexB);
+	*outGJKIterations = gjkResult.iterations;
+	outGJKCache->hasSimplex = gjkResult.hit;
+	outGJKCache->searchDir = gjkResult.searchDir;
+	outGJKCache->hullVertexA = hullVertexA;
+	outGJKCache->hullVertexB = hullVertexB;
+	if (!gjkResult.hit)
+		return {};
+
+	for (int i = 0; i < 4; ++i)
+	{
+		const GJKPoint *point = &gjkResult.points[i];
+		outGJKCache->localOnA[i] = ReverseTransformPoint(*transformA, point->a - point->dif);
+		outGJKCache->localOnB[i] = ReverseTransformPoint(*transformB, point->a);
+	}
+
+	EPAResult epaResult = EPATest(transformA, transformB, colliderA, colliderB, &gjkResult,
+			&hullVertexA, &hullVertexB);
+	if (!epaResult.hit)
+		return {};
+
+	const EPAFace &closestFeature = epaResult.closestFeature;
+	const v3 closestFeatureNor = epaResult.normal;
+
+	CollisionInfo result;
+	result.hitCount = 1;
+	result.hitNormal = closestFeatureNor;
+	result.depth = epaResult.depth;
+
 	v3 normalA = V3Cross(closestFeature.c.a - closestFeature.a.a, closestFeature.b.a - closestFeature.a.a);
 	v3 normalB = V3Cross(
 			(closestFeature.c.a - closestFeature.c.dif) - (closestFeature.a.a - closestFeature.a.dif),
@@ -1644,14 +3272,11 @@ CollisionInfo TestCollision(GameState *gameState, Transform *transformA, Transfo
 	result.hitPoints[0] = hitWorldSpace;
 	result.hitDepths[0] = result.depth;
 
-	CollisionPair key = { colliderA->entityHandle, colliderB->entityHandle };
-	FixedArray<CachedHitPoint, 8>* cache = HashMapGet(gameState->hitPointCache, key);
-	if (!cache)
-	{
-		// @Todo: avoid looking-up twice
-		cache = HashMapGetOrAdd(&gameState->hitPointCache, key);
+	FixedArray<CachedHitPoint, 8> *cache = outCache;
+	if (manifold)
+		*cache = manifold->hitPoints;
+	else
 		*cache = {};
-	}
 
 	int idxOfWorstCachedPoint = -1;
 	f32 smallestDepth = INFINITY;
@@ -1729,9 +3354,479 @@ CollisionInfo TestCollision(GameState *gameState, Transform *transformA, Transfo
 	v3 bLocalHit = ReverseTransformPoint(*transformB, hitWorldSpace);
 	*FixedArrayAdd(cache) = CachedHitPoint{ aLocalHit, bLocalHit };
 
+	// Next time, look along the contact normal first.
+	outGJKCache->searchDir = result.hitNormal;
+	outGJKCache->hullVertexA = hullVertexA;
+	outGJKCache->hullVertexB = hullVertexB;
+
 	return result;
 }
 
+// Drops the manifolds of pairs that weren't tested on the given step: they left the broadphase, or
+// one of their colliders went away.
+void EvictStaleContactManifolds(GameState *gameState, u32 step)
+{
+	HashMap<CollisionPair, ContactManifold, BuddyAllocator> *manifolds = &gameState->contactManifolds;
+	const ContactManifold *values = HashMapValues(*manifolds);
+	u32 evictedCount = 0;
+	for (u32 slotIdx = 0; slotIdx < manifolds->capacity; )
+	{
+		if (HashMapSlotOccupied(*manifolds, slotIdx) && values[slotIdx].lastStep != step)
+		{
+			// Something else might have moved into this slot, look at it again.
+			HashMapRemoveSlot(manifolds, slotIdx);
+			++evictedCount;
+			continue;
+		}
+		++slotIdx;
+	}
+
+	ContactManifoldStats *stats = &gameState->contactManifoldStats;
+	stats->count = HashMapCount(*manifolds);
+	stats->capacity = manifolds->capacity;
+	stats->evictedCount = evictedCount;
+	stats->totalEvictedCount += evictedCount;
+}
+
+void RemoveEntityContactManifolds(GameState *gameState, EntityHandle handle)
+{
+	HashMap<CollisionPair, ContactManifold, BuddyAllocator> *manifolds = &gameState->contactManifolds;
+	const CollisionPair *keys = HashMapKeys(*manifolds);
+	u32 removedCount = 0;
+	for (u32 slotIdx = 0; slotIdx < manifolds->capacity; )
+	{
+		if (HashMapSlotOccupied(*manifolds, slotIdx))
+		{
+			const CollisionPair &key = keys[slotIdx];
+			if ((key.a.id == handle.id && key.a.generation == handle.generation) ||
+				(key.b.id == handle.id && key.b.generation == handle.generation))
+			{
+				HashMapRemoveSlot(manifolds, slotIdx);
+				++removedCount;
+				continue;
+			}
+		}
+		++slotIdx;
+	}
+
+	ContactManifoldStats *stats = &gameState->contactManifoldStats;
+	stats->count -= Min(stats->count, removedCount);
+	stats->totalRemovedCount += removedCount;
+}
+
+// Times GJK + EPA on deeply penetrating pairs that have no closed form routine and logs how many
+// expansions and faces EPA needed. Also checks each result: pushing A out along the normal by the
+// depth (plus a bit) has to separate the pair, and pushing it by a bit less than the depth mustn't.
+void CollisionBenchmarkEPA()
+{
+	const Resource *anvilRes = GetResource("anvil_collision.b");
+	if (!anvilRes)
+	{
+		Log("ERROR! EPA benchmark: anvil_collision.b isn't loaded\n");
+		return;
+	}
+
+	Collider hull = {};
+	hull.type = COLLIDER_CONVEX_HULL;
+	hull.convexHull.meshRes = anvilRes;
+	hull.convexHull.scale = 1.0f;
+
+	Collider cube = {};
+	cube.type = COLLIDER_CUBE;
+	cube.cube.radius = 1.0f;
+
+	Collider cylinder = {};
+	cylinder.type = COLLIDER_CYLINDER;
+	cylinder.cylinder.radius = 1.0f;
+	cylinder.cylinder.height = 2.0f;
+
+	Collider capsule = {};
+	capsule.type = COLLIDER_CAPSULE;
+	capsule.capsule.radius = 0.5f;
+	capsule.capsule.height = 2.0f;
+
+	struct
+	{
+		const char *name;
+		Collider *colliderA;
+		Collider *colliderB;
+	} cases[] =
+	{
+		{ "hull-hull", &hull, &hull },
+		{ "hull-cylinder", &hull, &cylinder },
+		{ "cylinder-cylinder", &cylinder, &cylinder },
+		{ "cylinder-cube", &cylinder, &cube },
+		{ "capsule-cube", &capsule, &cube },
+		{ "capsule-cylinder", &capsule, &cylinder },
+	};
+
+	const u32 placementCount = 512;
+	const f32 separationMargin = 0.01f;
+	const f64 frequency = (f64)PlatformGetPerformanceFrequency();
+	u32 seed = 0x9E3779B9;
+
+	for (u32 caseIdx = 0; caseIdx < ArrayCount(cases); ++caseIdx)
+	{
+		Collider *colliderA = cases[caseIdx].colliderA;
+		Collider *colliderB = cases[caseIdx].colliderB;
+
+		u32 hitCount = 0;
+		u64 totalIterations = 0;
+		u32 maxFaceCount = 0;
+		u32 badSeparationCount = 0;
+		u64 ticks = 0;
+		for (u32 placementIdx = 0; placementIdx < placementCount; ++placementIdx)
+		{
+			// Centers at most 0.3 apart so most pairs are deep inside each other.
+			Transform transformA = {};
+			transformA.rotation = QuaternionFromEulerXYZ(XorShift32V3Signed(&seed) * PI);
+			Transform transformB = {};
+			transformB.translation = XorShift32V3Signed(&seed) * 0.3f;
+			transformB.rotation = QuaternionFromEulerXYZ(XorShift32V3Signed(&seed) * PI);
+
+			u64 start = PlatformGetPerformanceCounter();
+			u32 hullVertexA = U32_MAX;
+			u32 hullVertexB = U32_MAX;
+			GJKResult gjkResult = GJKTest(&transformA, &transformB, colliderA, colliderB, nullptr,
+					&hullVertexA, &hullVertexB);
+			EPAResult epaResult = {};
+			if (gjkResult.hit)
+				epaResult = EPATest(&transformA, &transformB, colliderA, colliderB, &gjkResult,
+						&hullVertexA, &hullVertexB);
+			ticks += PlatformGetPerformanceCounter() - start;
+
+			if (!epaResult.hit)
+				continue;
+			++hitCount;
+			totalIterations += epaResult.iterations;
+			maxFaceCount = Max(maxFaceCount, epaResult.faceCount);
+
+			// Hit normal points from B to A.
+			Transform movedA = transformA;
+			movedA.translation += epaResult.normal * (epaResult.depth + separationMargin);
+			GJKResult check = GJKTest(&movedA, &transformB, colliderA, colliderB, nullptr,
+					&hullVertexA, &hullVertexB);
+			bool bad = check.hit;
+			if (epaResult.depth > separationMargin * 2.0f)
+			{
+				movedA.translation = transformA.translation +
+					epaResult.normal * (epaResult.depth - separationMargin);
+				check = GJKTest(&movedA, &transformB, colliderA, colliderB, nullptr,
+						&hullVertexA, &hullVertexB);
+				bad = bad || !check.hit;
+			}
+			if (bad)
+				++badSeparationCount;
+		}
+
+		f64 time = ticks / frequency;
+		Log("EPA, %s: %u/%u hits, %.3f us per test, %.2f avg iterations, %u max faces\n",
+				cases[caseIdx].name, hitCount, placementCount, time * 1000000.0 / placementCount,
+				hitCount ? (f64)totalIterations / hitCount : 0.0, maxFaceCount);
+		if (badSeparationCount)
+			Log("ERROR! EPA depth or normal is off for %u %s placements\n", badSeparationCount,
+					cases[caseIdx].name);
+	}
+}
+
+// Level benchmarks run on the game's level if there is one, and on level_test.b: a small baked
+// heightfield with 32 bit indices, loaded the first time it's asked for.
+const char *LEVEL_BENCHMARK_FILENAMES[] = { "level.b", "level_test.b" };
+
+const ResourceGeometryGrid *CollisionBenchmarkGetLevel(const char *filename)
+{
+	const Resource *levelRes = GetResource(filename);
+	if (!levelRes)
+		levelRes = LoadResource(RESOURCETYPE_LEVELGEOMETRYGRID, filename);
+	if (!levelRes || !levelRes->geometryGrid.bvhNodeCount)
+		return nullptr;
+	return &levelRes->geometryGrid;
+}
+
+// Times HitTest on random rays through the level and checks them against testing every triangle.
+void CollisionBenchmarkLevelRaycasts(const ResourceGeometryGrid *geometryGrid, const char *filename)
+{
+	const u32 rayCount = 16384;
+	// Brute force is slow, only check this many.
+	const u32 checkedRayCount = 1024;
+	const f64 frequency = (f64)PlatformGetPerformanceFrequency();
+	u32 seed = 0x9E3779B9;
+
+	// The baked BVH has to be what the bake step makes out of the grid's triangles now.
+	ResourceGeometryGrid rebuilt = *geometryGrid;
+	BakeLevelBVH<FrameAllocator>(&rebuilt);
+	if (!BakeLevelBVHEqual(geometryGrid, &rebuilt))
+		Log("ERROR! Level BVH in %s doesn't match a fresh bake, it needs rebaking\n", filename);
+
+	// Origins anywhere in the level's bounds, half the rays infinite and half segments.
+	const AABB bounds = geometryGrid->bvhNodes[0].aabb;
+	const v3 center = (bounds.min + bounds.max) * 0.5f;
+	const v3 halfSize = (bounds.max - bounds.min) * 0.5f;
+	v3 *origins = ALLOC_N(FrameAllocator, v3, rayCount);
+	v3 *dirs = ALLOC_N(FrameAllocator, v3, rayCount);
+	for (u32 rayIdx = 0; rayIdx < rayCount; ++rayIdx)
+	{
+		origins[rayIdx] = center + V3Scale(XorShift32V3Signed(&seed), halfSize);
+		v3 dir = XorShift32V3Signed(&seed);
+		if (V3SqrLen(dir) < 0.0001f)
+			dir = { 0, 0, -1 };
+		dirs[rayIdx] = V3Normalize(dir) * V3Length(halfSize);
+	}
+
+	bool *hits = ALLOC_N(FrameAllocator, bool, rayCount);
+	v3 *hitPoints = ALLOC_N(FrameAllocator, v3, rayCount);
+	u32 hitCount = 0;
+	u64 start = PlatformGetPerformanceCounter();
+	for (u32 rayIdx = 0; rayIdx < rayCount; ++rayIdx)
+	{
+		Triangle triangle;
+		hits[rayIdx] = HitTest(geometryGrid, origins[rayIdx], dirs[rayIdx], rayIdx & 1,
+				&hitPoints[rayIdx], &triangle);
+	}
+	u64 ticks = PlatformGetPerformanceCounter() - start;
+	for (u32 rayIdx = 0; rayIdx < rayCount; ++rayIdx)
+		hitCount += hits[rayIdx];
+
+	u32 mismatchCount = 0;
+	start = PlatformGetPerformanceCounter();
+	for (u32 rayIdx = 0; rayIdx < checkedRayCount; ++rayIdx)
+	{
+		bool bruteHit = false;
+		f32 closestSqrLen = INFINITY;
+		// Straight from the grid, copies and all.
+		const u32 gridTriangleCount = geometryGrid->offsets[geometryGrid->cellsSide *
+			geometryGrid->cellsSide];
+		for (u32 triIdx = 0; triIdx < gridTriangleCount; ++triIdx)
+		{
+			const IndexTriangle32 *curTriangle = &geometryGrid->triangles[triIdx];
+			Triangle tri =
+			{
+				geometryGrid->positions[curTriangle->a],
+				geometryGrid->positions[curTriangle->b],
+				geometryGrid->positions[curTriangle->c],
+				curTriangle->normal
+			};
+			v3 thisHit;
+			if (RayTriangleIntersection(origins[rayIdx], dirs[rayIdx], rayIdx & 1, &tri, &thisHit))
+			{
+				bruteHit = true;
+				closestSqrLen = Min(closestSqrLen, V3SqrLen(thisHit - origins[rayIdx]));
+			}
+		}
+		if (bruteHit != hits[rayIdx] || (bruteHit &&
+				Abs(Sqrt(closestSqrLen) - V3Length(hitPoints[rayIdx] - origins[rayIdx])) > 0.001f))
+			++mismatchCount;
+	}
+	u64 bruteTicks = PlatformGetPerformanceCounter() - start;
+
+	Log("Level raycasts, %s, %u triangles in %u BVH nodes: %u rays (%u hit), %.3f us per ray, "
+			"%.2f M rays/s. Testing every triangle: %.3f us per ray\n", filename,
+			geometryGrid->bvhTriangleCount, geometryGrid->bvhNodeCount, rayCount, hitCount,
+			ticks * 1000000.0 / frequency / rayCount, rayCount * frequency / ticks / 1000000.0,
+			bruteTicks * 1000000.0 / frequency / checkedRayCount);
+	if (mismatchCount)
+		Log("ERROR! Level raycasts, %s: %u of %u rays disagree with testing every triangle\n",
+				filename, mismatchCount, checkedRayCount);
+}
+
+void CollisionBenchmarkLevelRaycasts()
+{
+	u32 levelCount = 0;
+	for (u32 levelIdx = 0; levelIdx < ArrayCount(LEVEL_BENCHMARK_FILENAMES); ++levelIdx)
+	{
+		const char *filename = LEVEL_BENCHMARK_FILENAMES[levelIdx];
+		const ResourceGeometryGrid *geometryGrid = CollisionBenchmarkGetLevel(filename);
+		if (!geometryGrid)
+			continue;
+		CollisionBenchmarkLevelRaycasts(geometryGrid, filename);
+		++levelCount;
+	}
+	if (!levelCount)
+		Log("ERROR! Level raycast benchmark: no level geometry could be loaded\n");
+
+	// And level_test.b has to be what its generator makes.
+	const ResourceGeometryGrid *shipped = CollisionBenchmarkGetLevel("level_test.b");
+	if (shipped)
+	{
+		ResourceGeometryGrid generated = {};
+		BakeTestLevel<FrameAllocator>(&generated, TEST_LEVEL_SIDE);
+		u32 offsetCount = generated.cellsSide * generated.cellsSide + 1;
+		if (shipped->cellsSide != generated.cellsSide || shipped->positionCount != generated.positionCount ||
+				memcmp(shipped->offsets, generated.offsets, sizeof(u32) * offsetCount) ||
+				memcmp(shipped->positions, generated.positions, sizeof(v3) * generated.positionCount) ||
+				memcmp(shipped->triangles, generated.triangles,
+					sizeof(IndexTriangle32) * generated.offsets[offsetCount - 1]) ||
+				!BakeLevelBVHEqual(shipped, &generated))
+			Log("ERROR! level_test.b doesn't match BakeTestLevel, it needs rebaking\n");
+	}
+}
+
+// Rays per second one at a time and eight at a time, against the anvil hull and the level. Rays
+// come in bunches of eight from the same spot a few degrees apart, like line of sight checks.
+// Also checks the packets hit the same things at the same distances.
+void CollisionBenchmarkRayPackets()
+{
+	const u32 packetCount = 8192;
+	const f64 frequency = (f64)PlatformGetPerformanceFrequency();
+	u32 seed = 0x9E3779B9;
+
+	// Bunches from around center at distance, aimed at center give or take spread.
+	RayPacket *packets = ALLOC_N(FrameAllocator, RayPacket, packetCount);
+	auto makePackets = [&](v3 center, v3 extent, f32 distance, f32 spread, f32 maxT)
+	{
+		for (u32 packetIdx = 0; packetIdx < packetCount; ++packetIdx)
+		{
+			v3 offset = XorShift32V3Signed(&seed);
+			offset.z = offset.z * 0.5f + 0.5f;
+			v3 origin = V3Normalize(offset) * distance + center;
+			v3 target = center + V3Scale(XorShift32V3Signed(&seed), extent);
+			v3 forward = V3Normalize(target - origin);
+			RayPacket *packet = &packets[packetIdx];
+			for (int lane = 0; lane < 8; ++lane)
+			{
+				v3 dir = V3Normalize(forward + XorShift32V3Signed(&seed) * spread);
+				packet->originX[lane] = origin.x;
+				packet->originY[lane] = origin.y;
+				packet->originZ[lane] = origin.z;
+				packet->dirX[lane] = dir.x;
+				packet->dirY[lane] = dir.y;
+				packet->dirZ[lane] = dir.z;
+				packet->maxT[lane] = maxT;
+			}
+		}
+	};
+	auto laneOrigin = [](const RayPacket *packet, int lane)
+	{
+		return v3{ packet->originX[lane], packet->originY[lane], packet->originZ[lane] };
+	};
+	auto laneDir = [](const RayPacket *packet, int lane)
+	{
+		return v3{ packet->dirX[lane], packet->dirY[lane], packet->dirZ[lane] };
+	};
+	f32 *singleTs = ALLOC_N(FrameAllocator, f32, packetCount * 8);
+	const u32 rayCount = packetCount * 8;
+
+	const Resource *anvilRes = GetResource("anvil_collision.b");
+	if (!anvilRes)
+		Log("ERROR! Ray packet benchmark: anvil_collision.b isn't loaded\n");
+	else
+	{
+		Collider hull = {};
+		hull.type = COLLIDER_CONVEX_HULL;
+		hull.convexHull.meshRes = anvilRes;
+		hull.convexHull.scale = 1.0f;
+		Transform transform = {};
+		transform.rotation = QuaternionFromEulerXYZ({ 0.3f, 0.2f, 0.1f });
+		transform.scale = { 1, 1, 1 };
+		makePackets(transform.translation, { 1, 1, 1 }, 5.0f, 0.1f, INFINITY);
+
+		u32 hitCount = 0;
+		u64 start = PlatformGetPerformanceCounter();
+		for (u32 packetIdx = 0; packetIdx < packetCount; ++packetIdx)
+		{
+			for (int lane = 0; lane < 8; ++lane)
+			{
+				v3 origin = laneOrigin(&packets[packetIdx], lane);
+				v3 dir = laneDir(&packets[packetIdx], lane);
+				v3 hit, hitNormal;
+				singleTs[packetIdx * 8 + lane] = -1.0f;
+				if (RayColliderIntersection(origin, dir, true, &transform, &hull, &hit, &hitNormal))
+					singleTs[packetIdx * 8 + lane] = V3Dot(hit - origin, dir);
+			}
+		}
+		u64 singleTicks = PlatformGetPerformanceCounter() - start;
+
+		u32 mismatchCount = 0;
+		start = PlatformGetPerformanceCounter();
+		for (u32 packetIdx = 0; packetIdx < packetCount; ++packetIdx)
+		{
+			v3 normals[8];
+			u32 hitMask = RayPacketConvexHull(&packets[packetIdx], 0xFF, &transform, &hull, normals);
+			hitCount += CountOnes(hitMask);
+		}
+		u64 packetTicks = PlatformGetPerformanceCounter() - start;
+		for (u32 packetIdx = 0; packetIdx < packetCount; ++packetIdx)
+			for (int lane = 0; lane < 8; ++lane)
+			{
+				f32 singleT = singleTs[packetIdx * 8 + lane];
+				f32 packetT = packets[packetIdx].maxT[lane];
+				bool packetHit = packetT != INFINITY;
+				if (packetHit != (singleT >= 0) || (packetHit && Abs(packetT - singleT) > 0.001f))
+					++mismatchCount;
+			}
+
+		Log("Ray packets, anvil hull: %u rays (%u hit), one at a time %.2f M rays/s, "
+				"eight at a time %.2f M rays/s\n", rayCount, hitCount,
+				rayCount * frequency / singleTicks / 1000000.0,
+				rayCount * frequency / packetTicks / 1000000.0);
+		if (mismatchCount)
+			Log("ERROR! Ray packets: %u hull rays disagree with RayColliderIntersection\n",
+					mismatchCount);
+	}
+
+	u32 levelCount = 0;
+	for (u32 levelIdx = 0; levelIdx < ArrayCount(LEVEL_BENCHMARK_FILENAMES); ++levelIdx)
+	{
+		const char *filename = LEVEL_BENCHMARK_FILENAMES[levelIdx];
+		const ResourceGeometryGrid *geometryGrid = CollisionBenchmarkGetLevel(filename);
+		if (!geometryGrid)
+			continue;
+		++levelCount;
+
+		const AABB bounds = geometryGrid->bvhNodes[0].aabb;
+		const v3 center = (bounds.min + bounds.max) * 0.5f;
+		const v3 halfSize = (bounds.max - bounds.min) * 0.5f;
+		makePackets(center, halfSize, V3Length(halfSize) * 0.5f, 0.05f, INFINITY);
+
+		u32 hitCount = 0;
+		u64 start = PlatformGetPerformanceCounter();
+		for (u32 packetIdx = 0; packetIdx < packetCount; ++packetIdx)
+		{
+			for (int lane = 0; lane < 8; ++lane)
+			{
+				v3 origin = laneOrigin(&packets[packetIdx], lane);
+				v3 dir = laneDir(&packets[packetIdx], lane);
+				v3 hit;
+				Triangle triangle;
+				singleTs[packetIdx * 8 + lane] = -1.0f;
+				if (HitTest(geometryGrid, origin, dir, true, &hit, &triangle))
+					singleTs[packetIdx * 8 + lane] = V3Dot(hit - origin, dir);
+			}
+		}
+		u64 singleTicks = PlatformGetPerformanceCounter() - start;
+
+		u32 mismatchCount = 0;
+		start = PlatformGetPerformanceCounter();
+		for (u32 packetIdx = 0; packetIdx < packetCount; ++packetIdx)
+		{
+			u32 triangleIndices[8];
+			HitTestPacket(geometryGrid, &packets[packetIdx], triangleIndices);
+			for (int lane = 0; lane < 8; ++lane)
+				hitCount += triangleIndices[lane] != U32_MAX;
+		}
+		u64 packetTicks = PlatformGetPerformanceCounter() - start;
+		for (u32 packetIdx = 0; packetIdx < packetCount; ++packetIdx)
+			for (int lane = 0; lane < 8; ++lane)
+			{
+				f32 singleT = singleTs[packetIdx * 8 + lane];
+				f32 packetT = packets[packetIdx].maxT[lane];
+				bool packetHit = packetT != INFINITY;
+				if (packetHit != (singleT >= 0) || (packetHit && Abs(packetT - singleT) > 0.001f))
+					++mismatchCount;
+			}
+
+		Log("Ray packets, %s (%u triangles): %u rays (%u hit), one at a time %.2f M rays/s, "
+				"eight at a time %.2f M rays/s\n", filename, geometryGrid->bvhTriangleCount,
+				rayCount, hitCount, rayCount * frequency / singleTicks / 1000000.0,
+				rayCount * frequency / packetTicks / 1000000.0);
+		if (mismatchCount)
+			Log("ERROR! Ray packets: %u %s rays disagree with HitTest\n", mismatchCount,
+					filename);
+	}
+	if (!levelCount)
+		Log("ERROR! Ray packet benchmark: no level geometry could be loaded\n");
+}
+
 #if DEBUG_BUILD
 void GetGJKStepGeometry(int step, DebugVertex **buffer, u32 *vertexCount)
 {
@@ -172,12 +172,14 @@ struct DynamicArray
 
 	operator ArrayView<T>()
 	{
-		return { data, count };
+		ASSERT(count <= U32_MAX);
+		return { data, (u32)count };
 	}
 
 	operator ArrayView<const T>() const
 	{
-		return { data, count };
+		ASSERT(count <= U32_MAX);
+		return { data, (u32)count };
 	}
 };
 
@@ -847,6 +849,43 @@ add:
 	return &values[slotIdx];
 }
 
+template <typename K, typename V, typename A>
+inline u32 HashMapCount(HashMap<K,V,A> hashMap)
+{
+	u32 *bookkeep = (u32 *)hashMap.memory;
+	u32 count = 0;
+	for (u32 wordIdx = 0; wordIdx < hashMap.capacity >> 5; ++wordIdx)
+		count += CountOnes(bookkeep[wordIdx]);
+	return count;
+}
+
+// Shifts the rest of the probe chain back into the hole instead of just clearing the slot, so keys
+// further down the chain can still be found. Entries can move into slotIdx, so when removing while
+// iterating over slots, look at slotIdx again.
+template <typename K, typename V, typename A>
+void HashMapRemoveSlot(HashMap<K,V,A> *hashMap, u32 slotIdx)
+{
+	ASSERT(HashMapSlotOccupied(*hashMap, slotIdx));
+	u32 mask = hashMap->capacity - 1;
+	u32 *bookkeep = (u32 *)hashMap->memory;
+	K *keys = HashMapKeys(*hashMap);
+	V *values = HashMapValues(*hashMap);
+
+	u32 holeIdx = slotIdx;
+	for (u32 scanIdx = (slotIdx + 1) & mask; BitfieldGetBit(bookkeep, scanIdx);
+			scanIdx = (scanIdx + 1) & mask)
+	{
+		// Can't move it before the slot it hashes to.
+		u32 homeIdx = Hash(keys[scanIdx]) & mask;
+		if (((scanIdx - homeIdx) & mask) < ((scanIdx - holeIdx) & mask))
+			continue;
+		keys[holeIdx] = keys[scanIdx];
+		values[holeIdx] = values[scanIdx];
+		holeIdx = scanIdx;
+	}
+	BitfieldClearBit(bookkeep, holeIdx);
+}
+
 template <typename K, typename V, typename A>
 bool HashMapRemove(HashMap<K,V,A> *hashMap, K key)
 {
@@ -864,9 +903,7 @@ bool HashMapRemove(HashMap<K,V,A> *hashMap, K key)
 		foundKey = keys[slotIdx];
 		if (foundKey == key)
 		{
-			// Remove
-			u32 *bookkeep = (u32 *)hashMap->memory;
-			BitfieldClearBit(bookkeep, slotIdx);
+			HashMapRemoveSlot(hashMap, slotIdx);
 			return true;
 		}
 		slotIdx = (slotIdx + 1) & mask;
@@ -932,72 +969,104 @@ u64 FindInBigArray(u32 *buffer, u64 count, u32 item)
 	return U64_MAX;
 }
 
+// Bounded lock-free multi-producer/multi-consumer queue (Vyukov). Every cell carries a sequence
+// number saying whose turn it is: a producer at position pos waits for pos, a consumer for pos + 1.
+// Capacity must be a power of 2.
 template <typename T>
-struct MTQueue {
-	T *buffer;
-	u32 capacity;
-	volatile u32 head;
-	volatile u32 tail;
-	volatile u32 headLock;
-	volatile u32 tailLock;
+struct MTQueueCell {
+	volatile u32 sequence;
+	T item;
+};
+
+template <typename T>
+struct alignas(64) MTQueue {
+	MTQueueCell<T> *cells;
+	u32 mask;
+	u8 cellsPadding[52];
+	// Producers and consumers each hammer their own index, keep them on separate cache lines.
+	volatile u32 enqueuePos;
+	u8 enqueuePadding[60];
+	volatile u32 dequeuePos;
+	u8 dequeuePadding[60];
 };
 
 template <typename Allocator, typename T>
 void MTQueueInit(MTQueue<T> *queue, u32 capacity) {
-	*queue = {
-		.buffer = (T *)Allocator::Alloc(sizeof(T) * capacity, alignof(T)),
-		.capacity = capacity,
-		.head = 0,
-		.tail = 0,
-		.headLock = 0,
-		.tailLock = 0 };
+	ASSERT(capacity >= 2 && IsPowerOf2(capacity));
+	*queue = {};
+	queue->cells = (MTQueueCell<T> *)Allocator::Alloc(sizeof(MTQueueCell<T>) * capacity,
+			alignof(MTQueueCell<T>));
+	queue->mask = capacity - 1;
+	for (u32 cellIdx = 0; cellIdx < capacity; ++cellIdx)
+		queue->cells[cellIdx].sequence = cellIdx;
 }
 
 template <typename T>
 bool MTQueueEnqueue(MTQueue<T> *queue, T item)
 {
-	SpinlockLock(&queue->tailLock);
-	u32 tail = queue->tail;
-	u32 newTail = (tail + 1) % queue->capacity;
-	if (newTail == queue->head) {
-		// Full
-		SpinlockUnlock(&queue->tailLock);
-		return false;
-	}
-	else {
-		queue->buffer[tail] = item;
-		queue->tail = newTail;
-		SpinlockUnlock(&queue->tailLock);
-		return true;
+	MTQueueCell<T> *cell;
+	u32 pos = queue->enqueuePos;
+	while (true) {
+		cell = &queue->cells[pos & queue->mask];
+		s32 diff = (s32)(AtomicLoadAcquire(&cell->sequence) - pos);
+		if (diff == 0) {
+			u32 oldPos = AtomicCompareExchange(&queue->enqueuePos, pos + 1, pos);
+			if (oldPos == pos)
+				break;
+			pos = oldPos;
+		}
+		else if (diff < 0) {
+			// Full, the consumer of the previous lap hasn't freed this cell yet
+			return false;
+		}
+		else {
+			// Somebody else took this position
+			pos = queue->enqueuePos;
+		}
 	}
+
+	cell->item = item;
+	// The item has to be in place before consumers can see the new sequence.
+	AtomicStoreRelease(&cell->sequence, pos + 1);
+	return true;
 }
 
 template <typename T>
 bool MTQueueDequeue(MTQueue<T> *queue, T *item)
 {
-	bool result = false;
-	SpinlockLock(&queue->headLock);
-	u32 head = queue->head;
-	u32 tail = queue->tail;
-	if (head != tail) {
-		queue->head = (head + 1) % queue->capacity;
-		*item = queue->buffer[head];
+	MTQueueCell<T> *cell;
+	u32 pos = queue->dequeuePos;
+	while (true) {
+		cell = &queue->cells[pos & queue->mask];
+		s32 diff = (s32)(AtomicLoadAcquire(&cell->sequence) - (pos + 1));
+		if (diff == 0) {
+			u32 oldPos = AtomicCompareExchange(&queue->dequeuePos, pos + 1, pos);
+			if (oldPos == pos)
+				break;
+			pos = oldPos;
+		}
+		else if (diff < 0) {
+			// Empty
+			return false;
+		}
+		else {
+			pos = queue->dequeuePos;
+		}
+	}
+
+	*item = cell->item;
 #if DEBUG_BUILD
-		memset(&queue->buffer[head], 0xFE, sizeof(T));
+	memset(&cell->item, 0xFE, sizeof(T));
 #endif
-		result = true;
-	}
-	SpinlockUnlock(&queue->headLock);
-	return result;
+	// Hand the cell to the producer one lap ahead, once the item has been read out.
+	AtomicStoreRelease(&cell->sequence, pos + queue->mask + 1);
+	return true;
 }
 
+// Only a snapshot, other threads can change it right after.
 template <typename T>
 bool MTQueueIsEmpty(MTQueue<T> *queue) {
-	SpinlockLock(&queue->headLock);
-	SpinlockLock(&queue->tailLock);
-	u32 head = queue->head;
-	u32 tail = queue->tail;
-	SpinlockUnlock(&queue->tailLock);
-	SpinlockUnlock(&queue->headLock);
-	return head == tail;
+	u32 pos = queue->dequeuePos;
+	MTQueueCell<T> *cell = &queue->cells[pos & queue->mask];
+	return (s32)(AtomicLoadAcquire(&cell->sequence) - (pos + 1)) < 0;
 }
@@ -1,6 +1,10 @@
 #if DEBUG_BUILD
+// Debug geometry is only gathered from the main thread, draws from jobs running elsewhere are dropped.
 void DrawDebugCube(v3 pos, v3 fw, v3 up, f32 scale, v3 color = {1,0,0})
 {
+	if (t_threadIndex != 0)
+		return;
+
 	if (g_debugContext->debugGeometryBuffer.debugCubeCount < 2048)
 	{
 		g_debugContext->debugGeometryBuffer.debugCubes[g_debugContext->debugGeometryBuffer.debugCubeCount++] =
@@ -10,6 +14,9 @@ void DrawDebugCube(v3 pos, v3 fw, v3 up, f32 scale, v3 color = {1,0,0})
 
 void DrawDebugCubeAA(v3 pos, f32 scale, v3 color = {1,0,0})
 {
+	if (t_threadIndex != 0)
+		return;
+
 	if (g_debugContext->debugGeometryBuffer.debugCubeCount < 2048)
 	{
 		g_debugContext->debugGeometryBuffer.debugCubes[g_debugContext->debugGeometryBuffer.debugCubeCount++] =
@@ -19,6 +26,9 @@ void DrawDebugCubeAA(v3 pos, f32 scale, v3 color = {1,0,0})
 
 void DrawDebugTriangles(v3* vertices, int vertexCount, v3 color = {1,0,0})
 {
+	if (t_threadIndex != 0)
+		return;
+
 	for (int i = 0; i < vertexCount; ++i)
 	{
 		if (g_debugContext->debugGeometryBuffer.triangleVertexCount >= 2048)
@@ -33,6 +43,9 @@ void DrawDebugTriangles(v3* vertices, int vertexCount, v3 color = {1,0,0})
 
 void DrawDebugTriangles(DebugVertex* vertices, int vertexCount)
 {
+	if (t_threadIndex != 0)
+		return;
+
 	for (int i = 0; i < vertexCount; ++i)
 	{
 		if (g_debugContext->debugGeometryBuffer.triangleVertexCount >= 2048)
@@ -45,6 +58,9 @@ void DrawDebugTriangles(DebugVertex* vertices, int vertexCount)
 
 void DrawDebugLines(v3* vertices, int vertexCount, v3 color = {1,0,0})
 {
+	if (t_threadIndex != 0)
+		return;
+
 	for (int i = 0; i < vertexCount; ++i)
 	{
 		if (g_debugContext->debugGeometryBuffer.lineVertexCount >= 2048)
@@ -63,6 +63,132 @@ RigidBody *GetEntityRigidBody(GameState *gameState, EntityHandle handle)
 	return &gameState->rigidBodies[idx];
 }
 
+inline u32 RigidBodyIndex(GameState *gameState, const RigidBody *rigidBody)
+{
+	return (u32)ArrayPointerToIndex(&gameState->rigidBodies, (void *)rigidBody);
+}
+
+template <typename Allocator>
+void RigidBodyMotionInit(RigidBodyMotion *motion)
+{
+	// Three arrays for each of the four vectors, plus invMass.
+	const u32 arrayCount = 4 * 3 + 1;
+	// The allocators don't align, round up by hand.
+	u64 memory = (u64)Allocator::Alloc(sizeof(f32) * RIGID_BODY_MOTION_CAPACITY *
+			arrayCount + 31, 32);
+	f32 *arrays = (f32 *)((memory + 31) & ~31ull);
+	memset(arrays, 0, sizeof(f32) * RIGID_BODY_MOTION_CAPACITY * arrayCount);
+
+	V3SoA *vectors[] = { &motion->velocity, &motion->angularVelocity, &motion->pseudoVelocity,
+		&motion->pseudoAngularVelocity };
+	for (u32 vectorIdx = 0; vectorIdx < ArrayCount(vectors); ++vectorIdx)
+	{
+		vectors[vectorIdx]->x = arrays;
+		vectors[vectorIdx]->y = arrays + RIGID_BODY_MOTION_CAPACITY;
+		vectors[vectorIdx]->z = arrays + RIGID_BODY_MOTION_CAPACITY * 2;
+		arrays += RIGID_BODY_MOTION_CAPACITY * 3;
+	}
+	motion->invMass = arrays;
+}
+
+// Copies a rigid body's motion to another slot, for when the rigid body array moves bodies around.
+void RigidBodyMotionCopy(RigidBodyMotion *motion, u32 dstIdx, u32 srcIdx)
+{
+	V3SoASet(&motion->velocity, dstIdx, V3SoAGet(&motion->velocity, srcIdx));
+	V3SoASet(&motion->angularVelocity, dstIdx, V3SoAGet(&motion->angularVelocity, srcIdx));
+	V3SoASet(&motion->pseudoVelocity, dstIdx, V3SoAGet(&motion->pseudoVelocity, srcIdx));
+	V3SoASet(&motion->pseudoAngularVelocity, dstIdx,
+			V3SoAGet(&motion->pseudoAngularVelocity, srcIdx));
+	motion->invMass[dstIdx] = motion->invMass[srcIdx];
+}
+
+// Wakes the entities' rigid bodies and the rest of their islands, that is whatever they were touching
+// or tied to by a spring, and so on. Static entities wake what rests on them but don't pass it
+// further.
+void WakeEntities(GameState *gameState, ArrayView<const EntityHandle> handles)
+{
+	DynamicArray<EntityHandle, FrameAllocator> stack;
+	DynamicArrayInit(&stack, Max(handles.count, 16));
+	for (u32 handleIdx = 0; handleIdx < handles.count; ++handleIdx)
+	{
+		RigidBody *rigidBody = GetEntityRigidBody(gameState, handles[handleIdx]);
+		if (rigidBody)
+		{
+			rigidBody->sleepTimer = 0;
+			// Awake bodies never stay in touch with sleeping ones, nothing to pass on.
+			if (!rigidBody->sleeping)
+				continue;
+			rigidBody->sleeping = false;
+		}
+		*DynamicArrayAdd(&stack) = handles[handleIdx];
+	}
+	if (!stack.count)
+		return;
+
+	// Neighbours of every entity in one pass over the contacts and springs, so walking the islands
+	// doesn't go through all of them again for each body it wakes. Neighbours of entity i are
+	// neighbors[neighborOffsets[i]] up to neighbors[neighborOffsets[i + 1]].
+	HashMap<CollisionPair, ContactManifold, BuddyAllocator> manifolds = gameState->contactManifolds;
+	const CollisionPair *keys = HashMapKeys(manifolds);
+	const ContactManifold *values = HashMapValues(manifolds);
+	auto forEachLink = [gameState, &manifolds, keys, values](auto &&fn)
+	{
+		for (u32 slotIdx = 0; slotIdx < manifolds.capacity; ++slotIdx)
+		{
+			if (!HashMapSlotOccupied(manifolds, slotIdx))
+				continue;
+			// Only pairs that were in contact the last time they were solved.
+			const ContactManifold *manifold = &values[slotIdx];
+			if (!manifold->impulseCount || manifold->impulseStep != manifold->lastStep)
+				continue;
+			fn(keys[slotIdx].a, keys[slotIdx].b);
+		}
+		for (u32 springIdx = 0; springIdx < gameState->springs.count; ++springIdx)
+			fn(gameState->springs[springIdx].entityA, gameState->springs[springIdx].entityB);
+	};
+	u32 *neighborOffsets = ALLOC_N(FrameAllocator, u32, MAX_ENTITIES + 1);
+	memset(neighborOffsets, 0, sizeof(u32) * (MAX_ENTITIES + 1));
+	u32 linkCount = 0;
+	forEachLink([neighborOffsets, &linkCount](EntityHandle a, EntityHandle b)
+	{
+		++neighborOffsets[a.id + 1];
+		++neighborOffsets[b.id + 1];
+		++linkCount;
+	});
+	for (u32 entityId = 0; entityId < MAX_ENTITIES; ++entityId)
+		neighborOffsets[entityId + 1] += neighborOffsets[entityId];
+	EntityHandle *neighbors = ALLOC_N(FrameAllocator, EntityHandle, linkCount * 2);
+	u32 *fillOffsets = ALLOC_N(FrameAllocator, u32, MAX_ENTITIES);
+	memcpy(fillOffsets, neighborOffsets, sizeof(u32) * MAX_ENTITIES);
+	forEachLink([neighbors, fillOffsets](EntityHandle a, EntityHandle b)
+	{
+		neighbors[fillOffsets[a.id]++] = b;
+		neighbors[fillOffsets[b.id]++] = a;
+	});
+
+	while (stack.count)
+	{
+		EntityHandle current = stack[--stack.count];
+		for (u32 neighborIdx = neighborOffsets[current.id];
+				neighborIdx < neighborOffsets[current.id + 1]; ++neighborIdx)
+		{
+			EntityHandle other = neighbors[neighborIdx];
+			RigidBody *otherRigidBody = GetEntityRigidBody(gameState, other);
+			if (otherRigidBody && otherRigidBody->sleeping)
+			{
+				otherRigidBody->sleeping = false;
+				otherRigidBody->sleepTimer = 0;
+				*DynamicArrayAdd(&stack) = other;
+			}
+		}
+	}
+}
+
+void WakeEntity(GameState *gameState, EntityHandle handle)
+{
+	WakeEntities(gameState, { &handle, 1 });
+}
+
 void EntityAssignMesh(GameState *gameState, EntityHandle entityHandle,
 		MeshInstance *meshInstance)
 {
@@ -76,13 +202,28 @@ void EntityAssignCollider(GameState *gameState, EntityHandle entityHandle, Colli
 	collider->entityHandle = entityHandle;
 	u32 idx = (u32)ArrayPointerToIndex(&gameState->colliders, collider);
 	gameState->entityColliders[entityHandle.id] = idx;
+
+	BroadphaseAddCollider(gameState, entityHandle);
 }
 
-void EntityAssignRigidBody(GameState *gameState, EntityHandle entityHandle, RigidBody *rigidBody)
+// The body starts at rest.
+void EntityAssignRigidBody(GameState *gameState, EntityHandle entityHandle, RigidBody *rigidBody,
+		f32 invMass)
 {
 	rigidBody->entityHandle = entityHandle;
 	u32 idx = (u32)ArrayPointerToIndex(&gameState->rigidBodies, rigidBody);
 	gameState->entityRigidBodies[entityHandle.id] = idx;
+
+	RigidBodyMotion *motion = &gameState->rigidBodyMotion;
+	V3SoASet(&motion->velocity, idx, {});
+	V3SoASet(&motion->angularVelocity, idx, {});
+	V3SoASet(&motion->pseudoVelocity, idx, {});
+	V3SoASet(&motion->pseudoAngularVelocity, idx, {});
+	motion->invMass[idx] = invMass;
+
+	Transform *transform = GetEntityTransform(gameState, entityHandle);
+	rigidBody->previousTranslation = transform->translation;
+	rigidBody->previousRotation = transform->rotation;
 }
 
 void EntityRemoveMesh(GameState *gameState, EntityHandle entityHandle)
@@ -106,6 +247,11 @@ void EntityRemoveCollider(GameState *gameState, EntityHandle entityHandle)
 	Collider *collider = GetEntityCollider(gameState, entityHandle);
 	if (collider)
 	{
+		// Whatever rested on it has to fall now.
+		WakeEntity(gameState, entityHandle);
+		BroadphaseRemoveCollider(gameState, entityHandle);
+		RemoveEntityContactManifolds(gameState, entityHandle);
+
 		Collider *last = &gameState->colliders[gameState->colliders.count - 1];
 		// Retarget moved component's entity to the new pointer.
 		u32 idx = (u32)ArrayPointerToIndex(&gameState->colliders, collider);
@@ -122,11 +268,14 @@ void EntityRemoveRigidBody(GameState *gameState, EntityHandle entityHandle)
 	RigidBody *rigidBody = GetEntityRigidBody(gameState, entityHandle);
 	if (rigidBody)
 	{
+		WakeEntity(gameState, entityHandle);
+
 		RigidBody *last = &gameState->rigidBodies[gameState->rigidBodies.count - 1];
 		// Retarget moved component's entity to the new pointer.
 		u32 idx = (u32)ArrayPointerToIndex(&gameState->rigidBodies, rigidBody);
 		gameState->entityRigidBodies[last->entityHandle.id] = idx;
 		*rigidBody = *last;
+		RigidBodyMotionCopy(&gameState->rigidBodyMotion, idx, gameState->rigidBodies.count - 1);
 
 		--gameState->rigidBodies.count;
 		gameState->entityRigidBodies[entityHandle.id] = ENTITY_ID_INVALID;
@@ -208,6 +357,10 @@ void RemoveEntity(GameState *gameState, EntityHandle handle)
 	Collider *collider = GetEntityCollider(gameState, handle);
 	if (collider)
 	{
+		WakeEntity(gameState, handle);
+		BroadphaseRemoveCollider(gameState, handle);
+		RemoveEntityContactManifolds(gameState, handle);
+
 		Collider *last = &gameState->colliders[gameState->colliders.count - 1];
 		// Retarget moved component's entity to the new pointer.
 		u32 idx = (u32)ArrayPointerToIndex(&gameState->colliders, collider);
@@ -226,6 +379,7 @@ void RemoveEntity(GameState *gameState, EntityHandle handle)
 		u32 idx = (u32)ArrayPointerToIndex(&gameState->rigidBodies, rigidBody);
 		gameState->entityRigidBodies[last->entityHandle.id] = idx;
 		*rigidBody = *last;
+		RigidBodyMotionCopy(&gameState->rigidBodyMotion, idx, gameState->rigidBodies.count - 1);
 
 		--gameState->rigidBodies.count;
 		gameState->entityRigidBodies[handle.id] = ENTITY_ID_INVALID;
@@ -7,6 +7,8 @@ struct EntityHandle
 const u32 ENTITY_ID_INVALID = U32_MAX;
 const EntityHandle ENTITY_HANDLE_INVALID = { ENTITY_ID_INVALID, 0 };
 
+#define MAX_ENTITIES 4096
+
 inline bool operator==(const EntityHandle &a, const EntityHandle &b)
 {
 	return a.id == b.id && a.generation == b.generation;
@@ -29,7 +31,8 @@ enum ColliderType
 	COLLIDER_CUBE,
 	COLLIDER_SPHERE,
 	COLLIDER_CYLINDER,
-	COLLIDER_CAPSULE
+	COLLIDER_CAPSULE,
+	COLLIDER_TYPE_COUNT
 };
 
 struct Collider
@@ -62,38 +65,82 @@ struct Collider
 	EntityHandle entityHandle;
 };
 
+// Pulls every awake rigid body down the Z axis.
+const f32 GRAVITY = 9.8f;
+
 struct RigidBody
 {
+	// Velocities and mass live in GameState::rigidBodyMotion, at the same index.
 	EntityHandle entityHandle;
 
-	v3 velocity;
-	v3 angularVelocity;
-
 	v3 totalForce;
 	v3 totalTorque;
 
-	f32 invMass;
 	f32 restitution;
 	f32 staticFriction;
 	f32 dynamicFriction;
 
 	mat3 invMomentOfInertiaTensor;
 	mat3 worldInvMomentOfInertiaTensor;
+
+	// Time spent under the sleep velocity thresholds. Sleeping bodies aren't simulated at all
+	// until something wakes them, see WakeEntity.
+	f32 sleepTimer;
+	bool sleeping;
+
+	// Swept along its path every step so it can't go through things, for small fast bodies.
+	bool continuousCollision;
+
+	// Where the body was before the last physics step, for render interpolation.
+	v3 previousTranslation;
+	v4 previousRotation;
 };
 
 RigidBody RIGID_BODY_STATIC = {
 	.entityHandle = ENTITY_HANDLE_INVALID,
-	.velocity = {},
-	.angularVelocity = {},
 	.totalForce = {},
 	.totalTorque = {},
-	.invMass = 0,
 	.restitution = 1.0f,
 	.staticFriction = 0.4f,
 	.dynamicFriction = 0.2f,
 	.invMomentOfInertiaTensor = {}
 };
 
+struct V3SoA
+{
+	f32 *x, *y, *z;
+};
+
+inline v3 V3SoAGet(const V3SoA *soa, u32 idx)
+{
+	return { soa->x[idx], soa->y[idx], soa->z[idx] };
+}
+
+inline void V3SoASet(V3SoA *soa, u32 idx, v3 value)
+{
+	soa->x[idx] = value.x;
+	soa->y[idx] = value.y;
+	soa->z[idx] = value.z;
+}
+
+// What integration and the solver go over for every rigid body, as structure of arrays indexed
+// like GameState::rigidBodies. Arrays are 32 byte aligned so IntegrateRigidBodiesAVX2 works on
+// them in place, eight bodies at a time.
+struct RigidBodyMotion
+{
+	V3SoA velocity;
+	V3SoA angularVelocity;
+	// Split impulse velocities, only used to push bodies out of each other. Reset every step.
+	V3SoA pseudoVelocity;
+	V3SoA pseudoAngularVelocity;
+	f32 *invMass;
+};
+
+// There are never more rigid bodies than entities, so the slot after the last one stands for
+// RIGID_BODY_STATIC. It stays at rest with infinite mass.
+const u32 RIGID_BODY_STATIC_IDX = MAX_ENTITIES;
+const u32 RIGID_BODY_MOTION_CAPACITY = (MAX_ENTITIES + 1 + 7) & ~7;
+
 struct Spring
 {
 	EntityHandle entityA;
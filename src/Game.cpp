@@ -18,36 +18,53 @@
 
 #include "RandomTable.h"
 #include "StringStream.h"
+#include "JobSystem.h"
 #include "Entity.h"
+#include "AABBTree.h"
+#include "Broadphase.h"
+#include "SceneQuery.h"
 #include "Game.h"
 
 #if DEBUG_BUILD
 DebugContext *g_debugContext;
 #endif
 
+JobSystem *g_jobSystem;
+// 0 is the main thread.
+thread_local u32 t_threadIndex;
+
 #if EDITOR_PRESENT
 EditorContext *g_editorContext;
 #endif
 
 String TPrintF(const char *format, ...)
 {
-	char *buffer = (char *)g_memory->framePtr;
-
 	va_list args;
 	va_start(args, format);
-	u64 size = stbsp_vsprintf(buffer, format, args);
-	va_end(args);
 
-	g_memory->framePtr = (u8 *)g_memory->framePtr + size + 1;
+	// Measure first so the string can come out of this thread's frame arena, jobs log too.
+	va_list measureArgs;
+	va_copy(measureArgs, args);
+	u64 size = stbsp_vsnprintf(nullptr, 0, format, measureArgs);
+	va_end(measureArgs);
+
+	char *buffer = (char *)FrameAllocator::Alloc(size + 1, 1);
+	stbsp_vsnprintf(buffer, (int)size + 1, format, args);
+	va_end(args);
 
 	return { size, buffer };
 }
 
+#include "JobSystem.cpp"
 #include "DebugDraw.cpp"
-#include "Collision.cpp"
 #include "BakeryInterop.cpp"
+#include "Baking.cpp"
+#include "Collision.cpp"
 #include "Resource.cpp"
 #include "Entity.cpp"
+#include "AABBTree.cpp"
+#include "Broadphase.cpp"
+#include "SceneQuery.cpp"
 #include "Parsing.cpp"
 #include "Physics.cpp"
 
@@ -77,8 +94,7 @@ bool GameResourcePostLoad(Resource *resource, u8 *fileBuffer, bool initialize)
 	} break;
 	case RESOURCETYPE_LEVELGEOMETRYGRID:
 	{
-		ResourceLoadLevelGeometryGrid(resource, fileBuffer, initialize);
-		return true;
+		return ResourceLoadLevelGeometryGrid(resource, fileBuffer, initialize);
 	} break;
 	case RESOURCETYPE_COLLISIONMESH:
 	{
@@ -164,6 +180,10 @@ void StartGame()
 	*g_editorContext = {};
 #endif
 
+	u32 threadCount = PlatformGetProcessorCount();
+	g_jobSystem = ALLOC(TransientAllocator, JobSystem);
+	JobSystemInit<TransientAllocator>(g_jobSystem, Min(threadCount, JOB_SYSTEM_MAX_THREADS));
+
 	// Init game state
 	memset(gameState, 0, sizeof(GameState));
 	gameState->timeMultiplier = 1.0f;
@@ -171,8 +191,13 @@ void StartGame()
 	ArrayInit(&gameState->meshInstances, 4096);
 	ArrayInit(&gameState->colliders, 4096);
 	ArrayInit(&gameState->rigidBodies, 4096);
+	RigidBodyMotionInit<TransientAllocator>(&gameState->rigidBodyMotion);
 	ArrayInit(&gameState->springs, 1024);
-	HashMapInit(&gameState->hitPointCache, 256);
+	HashMapInit(&gameState->contactManifolds, 256);
+	gameState->solverIterations = 8;
+	gameState->physicsStepRate = 120;
+	gameState->maxPhysicsStepsPerFrame = 8;
+	BroadphaseInit(&gameState->broadphase);
 
 	// @Hack: Hmmm
 	memset(gameState->entityTransforms, 0xFF, sizeof(gameState->entityTransforms));
@@ -273,6 +298,7 @@ void StartGame()
 		const Resource *levelGraphicsRes = GetResource("level_graphics.b");
 		gameState->levelGeometry.renderMesh = levelGraphicsRes;
 
+		// Not there if level.b is missing or needs rebaking, scene queries leave the level out then.
 		const Resource *levelCollisionRes = GetResource("level.b");
 		gameState->levelGeometry.geometryGrid = levelCollisionRes;
 	}
@@ -368,13 +394,11 @@ void StartGame()
 		EntityAssignCollider(gameState, testEntityHandle, collider);
 		RigidBody *rigidBody = ArrayAdd(&gameState->rigidBodies);
 		*rigidBody = {};
-		rigidBody->invMass = 1.0f;
 		rigidBody->restitution = 0.3f;
 		rigidBody->staticFriction = 0.4f;
 		rigidBody->dynamicFriction = 0.2f;
-		rigidBody->invMomentOfInertiaTensor = CalculateInverseMomentOfInertiaTensor(*collider,
-				rigidBody->invMass);
-		EntityAssignRigidBody(gameState, testEntityHandle, rigidBody);
+		rigidBody->invMomentOfInertiaTensor = CalculateInverseMomentOfInertiaTensor(*collider, 1.0f);
+		EntityAssignRigidBody(gameState, testEntityHandle, rigidBody, 1.0f);
 		spring->entityA = testEntityHandle;
 
 		testEntityHandle = AddEntity(gameState, &transform);
@@ -466,13 +490,11 @@ void StartGame()
 		EntityAssignCollider(gameState, testEntityHandle, collider);
 		rigidBody = ArrayAdd(&gameState->rigidBodies);
 		*rigidBody = {};
-		rigidBody->invMass = 1.0f;
 		rigidBody->restitution = 0.3f;
 		rigidBody->staticFriction = 0.4f;
 		rigidBody->dynamicFriction = 0.2f;
-		rigidBody->invMomentOfInertiaTensor = CalculateInverseMomentOfInertiaTensor(*collider,
-				rigidBody->invMass);
-		EntityAssignRigidBody(gameState, testEntityHandle, rigidBody);
+		rigidBody->invMomentOfInertiaTensor = CalculateInverseMomentOfInertiaTensor(*collider, 1.0f);
+		EntityAssignRigidBody(gameState, testEntityHandle, rigidBody, 1.0f);
 		spring->entityB = testEntityHandle;
 
 		const Resource *capsuleRes = GetResource("capsule.b");
@@ -488,6 +510,43 @@ void StartGame()
 		collider->capsule.height = 2;
 		collider->capsule.offset = {};
 		EntityAssignCollider(gameState, testEntityHandle, collider);
+
+		// Solver benchmark: 2000 small cubes on the ground cube. Layers are laid like bricks, every
+		// other one shifted by half a cube, so the whole pile is one island. The small gaps keep
+		// cubes from pairing up with the ones beside them.
+		const int pileWidth = 25;
+		const int pileDepth = 10;
+		const int pileLayerCount = 8;
+		const f32 pileSpacing = 1.02f;
+		for (int layer = 0; layer < pileLayerCount; ++layer)
+			for (int row = 0; row < pileDepth; ++row)
+				for (int column = 0; column < pileWidth; ++column)
+				{
+					f32 shift = (layer & 1) * 0.5f;
+					testEntityHandle = AddEntity(gameState, &transform);
+					transform->translation = {
+						(column - pileWidth * 0.5f + shift) * pileSpacing,
+						(row - pileDepth * 0.5f + shift) * pileSpacing - 12.0f,
+						layer + 0.5f };
+					transform->rotation = QUATERNION_IDENTITY;
+					transform->scale = { 0.5f, 0.5f, 0.5f };
+					meshInstance = ArrayAdd(&gameState->meshInstances);
+					meshInstance->meshRes = cubeRes;
+					EntityAssignMesh(gameState, testEntityHandle, meshInstance);
+					collider = ArrayAdd(&gameState->colliders);
+					collider->type = COLLIDER_CUBE;
+					collider->cube.radius = 0.5f;
+					collider->cube.offset = {};
+					EntityAssignCollider(gameState, testEntityHandle, collider);
+					rigidBody = ArrayAdd(&gameState->rigidBodies);
+					*rigidBody = {};
+					rigidBody->restitution = 0.3f;
+					rigidBody->staticFriction = 0.4f;
+					rigidBody->dynamicFriction = 0.2f;
+					rigidBody->invMomentOfInertiaTensor = CalculateInverseMomentOfInertiaTensor(
+							*collider, 1.0f);
+					EntityAssignRigidBody(gameState, testEntityHandle, rigidBody, 1.0f);
+				}
 	}
 
 	// Init light
@@ -550,9 +609,10 @@ void Render(GameState *gameState, f32 deltaTime)
 		if (meshRes)
 #endif
 		{
-			Transform *transform = GetEntityTransform(gameState, meshInstance->entityHandle);
+			const Transform transform = GetEntityRenderTransform(gameState,
+					meshInstance->entityHandle);
 
-			const mat4 model = Mat4Compose(*transform);
+			const mat4 model = Mat4Compose(transform);
 
 			// @Improve: don't rebind program, textures and all for every mesh! Maybe sort by
 			// material.
@@ -704,11 +764,39 @@ void UpdateAndRenderGame(Controller *controller, f32 deltaTime, f32 lastUpdateTo
 		}
 #endif
 
-		int iterations = 10;
-		f32 physicsStep = deltaTime / (f32)iterations;
-		for (int i = 0; i < iterations; ++i)
-			SimulatePhysics(gameState, physicsStep);
+		// Fixed timestep. If the frame owes more steps than we allow, the rest of the time is
+		// dropped rather than carried over, otherwise a slow frame makes the next one slower still.
+		const f64 physicsStep = 1.0 / gameState->physicsStepRate;
+		if (gameState->deterministicPhysics)
+			gameState->physicsTimeAccumulator += DETERMINISTIC_FRAME_TIME;
+		else
+			gameState->physicsTimeAccumulator += deltaTime;
+		int stepCount = 0;
+		while (gameState->physicsTimeAccumulator >= physicsStep &&
+				stepCount < gameState->maxPhysicsStepsPerFrame)
+		{
+			SimulatePhysics(gameState, (f32)physicsStep);
+			gameState->physicsTimeAccumulator -= physicsStep;
+			++stepCount;
+		}
+		if (gameState->physicsTimeAccumulator >= physicsStep)
+		{
+			f64 excess = (f64)(s64)(gameState->physicsTimeAccumulator / physicsStep) * physicsStep;
+			gameState->droppedPhysicsTime += excess;
+			gameState->physicsTimeAccumulator -= excess;
+		}
+		gameState->physicsStepsLastFrame = stepCount;
+
+		// Scene queries go through the broadphase tree, bring it up to date with where things
+		// ended up.
+		BroadphaseRefreshTree(gameState);
+		gameState->physicsInterpolationAlpha =
+			(f32)(gameState->physicsTimeAccumulator / physicsStep);
 	}
+#if DEBUG_BUILD
+	else
+		gameState->physicsInterpolationAlpha = 1.0f;
+#endif
 
 #if EDITOR_PRESENT
 	// Update editor
@@ -774,25 +862,15 @@ void UpdateAndRenderGame(Controller *controller, f32 deltaTime, f32 lastUpdateTo
 			v3 origin = camPos;
 			v3 dir = cursorXYZ - origin;
 			g_editorContext->hoveredEntity = ENTITY_HANDLE_INVALID;
-			f32 closestDistance = INFINITY;
-			for (u32 colliderIdx = 0; colliderIdx < gameState->colliders.count; ++colliderIdx)
+
+			// Only does anything if the editor moved things since physics refreshed it.
+			BroadphaseRefreshTree(gameState);
+
+			SceneQueryHit entityHit = Raycast(gameState, origin, V3Normalize(dir), INFINITY);
+			if (entityHit.hit)
 			{
-				Collider *collider = &gameState->colliders[colliderIdx];
-				Transform *transform = GetEntityTransform(gameState, collider->entityHandle);
-				ASSERT(transform);
-				v3 hit;
-				v3 hitNor;
-				if (RayColliderIntersection(origin, dir, true, transform,
-							collider, &hit, &hitNor))
-				{
-					f32 dist = V3SqrLen(hit - camPos);
-					if (dist < closestDistance)
-					{
-						closestDistance = dist;
-						g_editorContext->hoveredEntity = collider->entityHandle;
-						pickingResult = PICKING_ENTITY;
-					}
-				}
+				g_editorContext->hoveredEntity = entityHit.entityHandle;
+				pickingResult = PICKING_ENTITY;
 			}
 
 			// @Hack: hard coded gizmo colliders!
@@ -957,6 +1035,8 @@ void UpdateAndRenderGame(Controller *controller, f32 deltaTime, f32 lastUpdateTo
 					v2 mouseDelta = controller->mousePos - oldMousePos;
 					f32 delta = V2Dot(screenSpaceDragDir, mouseDelta) / V2SqrLen(screenSpaceDragDir);
 					selectedEntity->translation += worldDir * delta;
+					WakeEntity(gameState, g_editorContext->selectedEntity);
+					gameState->broadphase.treeOutdated = true;
 				}
 				else if (rotatingX || rotatingY || rotatingZ)
 				{
@@ -986,6 +1066,8 @@ void UpdateAndRenderGame(Controller *controller, f32 deltaTime, f32 lastUpdateTo
 					else
 						selectedEntity->rotation = QuaternionMultiply(QuaternionFromEulerZYX(euler),
 							selectedEntity->rotation);
+					WakeEntity(gameState, g_editorContext->selectedEntity);
+					gameState->broadphase.treeOutdated = true;
 				}
 			}
 
@@ -42,11 +42,16 @@ struct DebugContext
 
 	bool wireframeDebugDraws;
 	bool drawAABBs;
+	bool validateBroadphase;
 	bool drawSupports;
 	bool verboseCollisionLogging;
 
 	bool disableDepenetration;
 	bool disableFriction;
+	bool disableGJKWarmStart;
+	bool disableWarmStarting;
+	bool disableSleeping;
+	bool disableAnalyticCollision;
 
 	// GJK EPA
 	bool drawGJKPolytope;
@@ -58,6 +63,8 @@ struct DebugContext
 	v3 GJKNewPoint[64];
 
 	static const int epaMaxSteps = 32;
+	// 6 vertices per face, faces past that are left out of the capture.
+	static const int epaMaxStepVertices = 1536;
 	bool drawEPAPolytope;
 	bool drawEPAClosestFeature;
 	bool freezePolytopeGeom;
@@ -107,9 +114,64 @@ struct EditorContext
 #endif
 
 struct CollisionPair;
-struct CachedHitPoint;
+struct ContactManifold;
+
+// Totals over the last physics step.
+struct NarrowphaseStats
+{
+	u32 pairCount;
+	// Left untested because nothing awake was in them.
+	u32 sleepingPairCount;
+	u32 gjkIterationCount;
+	// Tests that took a closed form routine instead of GJK, by [typeA][typeB].
+	u32 analyticCounts[COLLIDER_TYPE_COUNT][COLLIDER_TYPE_COUNT];
+};
+
+// Contact manifold store, as of the last physics step.
+struct ContactManifoldStats
+{
+	u32 count;
+	u32 capacity;
+	// Evicted on the last step because their pair wasn't tested anymore.
+	u32 evictedCount;
+	u64 totalEvictedCount;
+	// Dropped along with one of their entities.
+	u64 totalRemovedCount;
+};
+
+// Contact solver, over the last physics step.
+struct SolverStats
+{
+	u32 constraintCount;
+	u32 islandCount;
+	// Islands big enough to be split into colors.
+	u32 coloredIslandCount;
+	u32 colorCount;
+	// Left over once all colors were taken, solved on one thread.
+	u32 uncoloredConstraintCount;
+	f32 lastStepTime;
+};
+
+// Continuous collision, over the last physics step.
+struct ContinuousCollisionStats
+{
+	// Bodies with continuous collision that moved enough to be swept.
+	u32 sweptBodyCount;
+	u32 sweptPairCount;
+	// Swept bodies stopped short of where they'd have ended up.
+	u32 clampedBodyCount;
+	u32 iterationCount;
+};
+
+// Rigid bodies at the end of the last physics step.
+struct SleepStats
+{
+	u32 awakeBodyCount;
+	u32 sleepingBodyCount;
+	// Islands among the awake bodies.
+	u32 islandCount;
+};
 
-#define MAX_ENTITIES 4096
 struct GameState
 {
 	f32 timeMultiplier;
@@ -132,9 +194,12 @@ struct GameState
 	Array<MeshInstance, TransientAllocator> meshInstances;
 	Array<Collider, TransientAllocator> colliders;
 	Array<RigidBody, TransientAllocator> rigidBodies;
+	RigidBodyMotion rigidBodyMotion;
 
 	Array<Spring, TransientAllocator> springs;
 
+	Broadphase broadphase;
+
 	v3 lightPosition;
 	v3 lightDirection;
 
@@ -142,5 +207,31 @@ struct GameState
 	mat4 invViewMatrix, viewMatrix, projMatrix, lightSpaceMatrix;
 	DeviceProgram program;
 
-	HashMap<CollisionPair, FixedArray<CachedHitPoint, 8>, BuddyAllocator> hitPointCache;
+	HashMap<CollisionPair, ContactManifold, BuddyAllocator> contactManifolds;
+	// Counts physics steps, manifolds are stamped with it.
+	u32 physicsStepCount;
+	int solverIterations;
+	// Physics runs in fixed steps of 1/physicsStepRate seconds. Frame time piles up in the
+	// accumulator and is spent a whole step at a time, at most maxPhysicsStepsPerFrame per frame.
+	int physicsStepRate;
+	int maxPhysicsStepsPerFrame;
+	f64 physicsTimeAccumulator;
+	// How far the frame is from the last step to the next, rigid bodies are drawn interpolated by it.
+	f32 physicsInterpolationAlpha;
+	int physicsStepsLastFrame;
+	// Frame time thrown away for needing more than maxPhysicsStepsPerFrame steps.
+	f64 droppedPhysicsTime;
+	// For lockstep replays and regression tests. Frames always take the same number of steps,
+	// whatever the clock says, and pairs are solved in entity id order rather than in whatever
+	// order the arrays and broadphase structures happen to be in.
+	bool deterministicPhysics;
+	bool logPhysicsChecksum;
+	// Over all transforms and rigid body velocities after the last step, see PhysicsChecksum.
+	// Only kept up to date in deterministic mode or when logging it.
+	u64 physicsChecksum;
+	NarrowphaseStats narrowphaseStats;
+	ContactManifoldStats contactManifoldStats;
+	SolverStats solverStats;
+	ContinuousCollisionStats continuousCollisionStats;
+	SleepStats sleepStats;
 };
@@ -4,7 +4,9 @@
 // We don't support any non IEEE754 arch for now.
 #define ASSUME_IEEE754 1
 
-#if !TARGET_WINDOWS
+#if TARGET_WINDOWS
+#include <intrin.h>
+#else
 #include <assert.h>
 #define MAX_PATH PATH_MAX
 #endif
@@ -63,4 +65,71 @@ typedef double f64;
 
 #define NOMANGLE extern "C"
 
+// Atomics. All of these are full memory barriers.
+inline u32 AtomicIncrementGetNew(volatile u32 *addend)
+{
+	return (u32)_InterlockedIncrement((volatile long *)addend);
+}
+
+inline u32 AtomicDecrementGetNew(volatile u32 *addend)
+{
+	return (u32)_InterlockedDecrement((volatile long *)addend);
+}
+
+inline u64 AtomicAddGetOld(volatile u64 *addend, u64 value)
+{
+	return (u64)_InterlockedExchangeAdd64((volatile long long *)addend, (long long)value);
+}
+
+inline s64 AtomicExchange64(volatile s64 *destination, s64 value)
+{
+	return (s64)_InterlockedExchange64((volatile long long *)destination, (long long)value);
+}
+
+// Returns the value destination had before the call.
+inline s64 AtomicCompareExchange64(volatile s64 *destination, s64 exchange, s64 comparand)
+{
+	return (s64)_InterlockedCompareExchange64((volatile long long *)destination, (long long)exchange,
+			(long long)comparand);
+}
+
+// Keeps the compiler from moving memory accesses across it, the CPU still can.
+inline void CompilerBarrier()
+{
+	_ReadWriteBarrier();
+}
+
+// Everything written before this is visible to other threads before the new value is.
+inline void AtomicStoreRelease(volatile u32 *destination, u32 value)
+{
+	_InterlockedExchange((volatile long *)destination, (long)value);
+}
+
+// Nothing read after this can be read before it. x64 doesn't reorder loads with later loads, so
+// only the compiler needs stopping.
+inline u32 AtomicLoadAcquire(volatile u32 *source)
+{
+	u32 value = *source;
+	CompilerBarrier();
+	return value;
+}
+
+// Returns the value destination had before the call.
+inline u32 AtomicCompareExchange(volatile u32 *destination, u32 exchange, u32 comparand)
+{
+	return (u32)_InterlockedCompareExchange((volatile long *)destination, (long)exchange,
+			(long)comparand);
+}
+
+inline void SpinlockLock(volatile u32 *lock)
+{
+	while (AtomicCompareExchange(lock, 1, 0) != 0)
+		_mm_pause();
+}
+
+inline void SpinlockUnlock(volatile u32 *lock)
+{
+	_InterlockedExchange((volatile long *)lock, 0);
+}
+
 #define ArrayCount(array) (sizeof(array) / sizeof(array[0]))
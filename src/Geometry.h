@@ -44,6 +44,51 @@ struct IndexTriangle
 	v3 normal;
 };
 
+// For meshes with more than 65536 vertices.
+struct IndexTriangle32
+{
+	union
+	{
+		struct
+		{
+			u32 a;
+			u32 b;
+			u32 c;
+		};
+		u32 corners[3];
+	};
+	v3 normal;
+};
+
+struct HullEdge
+{
+	u16 vertexA;
+	u16 vertexB;
+	// vertexA -> vertexB goes counter-clockwise around faceA, the other way around faceB.
+	u16 faceA;
+	u16 faceB;
+};
+
+struct AABB
+{
+	v3 min;
+	v3 max;
+};
+
+// Eight rays side by side, for the AVX2 ray paths. Directions needn't be normalized.
+struct RayPacket
+{
+	f32 originX[8];
+	f32 originY[8];
+	f32 originZ[8];
+	f32 dirX[8];
+	f32 dirY[8];
+	f32 dirZ[8];
+	// How far each ray reaches, in multiples of its direction. Lowered to the closest hit as the
+	// packet gets tested. Negative for lanes not in use.
+	f32 maxT[8];
+};
+
 struct GeometryGrid
 {
 	v2 lowCorner;
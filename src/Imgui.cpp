@@ -48,9 +48,113 @@ void ImguiShowDebugWindow(GameState *gameState, f32 frameTime)
 		ImGui::Checkbox("Pause physics", &g_debugContext->pausePhysics);
 		ImGui::Checkbox("Pause upon contact", &g_debugContext->pausePhysicsOnContact);
 		ImGui::Checkbox("Disable friction", &g_debugContext->disableFriction);
+		ImGui::Checkbox("Disable solver warm starting", &g_debugContext->disableWarmStarting);
+		ImGui::Checkbox("Disable sleeping", &g_debugContext->disableSleeping);
+		ImGui::SliderInt("Physics step rate", &gameState->physicsStepRate, 15, 480, "%d Hz");
+		ImGui::SliderInt("Max steps per frame", &gameState->maxPhysicsStepsPerFrame, 1, 16);
+		// Start counting from a clean slate, not whatever the clock left in there.
+		if (ImGui::Checkbox("Deterministic", &gameState->deterministicPhysics))
+			gameState->physicsTimeAccumulator = 0;
+		ImGui::Checkbox("Log checksums", &gameState->logPhysicsChecksum);
+		if (gameState->deterministicPhysics || gameState->logPhysicsChecksum)
+			ImGui::Text("Checksum: %016llx", gameState->physicsChecksum);
+		ImGui::SliderInt("Solver iterations", &gameState->solverIterations, 1, 32);
 		if (ImGui::Button("Reset momentum")) g_debugContext->resetMomentum = true;
 	}
 
+	if (ImGui::CollapsingHeader("Physics stats"))
+	{
+		const char *broadphaseModeNames[] = { "Sweep and prune", "AABB tree", "Hash grid", "All pairs" };
+		static_assert(ArrayCount(broadphaseModeNames) == BROADPHASE_MODE_COUNT);
+		int mode = gameState->broadphase.mode;
+		if (ImGui::Combo("Broadphase", &mode, broadphaseModeNames, BROADPHASE_MODE_COUNT))
+			gameState->broadphase.mode = (BroadphaseMode)mode;
+		ImGui::Checkbox("Validate against all pairs", &g_debugContext->validateBroadphase);
+		ImGui::SliderFloat("Grid cell size", &gameState->broadphase.hashGrid.cellSize, 0.25f, 16.0f,
+				"%.2f", ImGuiSliderFlags_Logarithmic);
+
+		const BroadphaseStats *stats = &gameState->broadphase.stats;
+		ImGui::Text("Job threads: %u", g_jobSystem->threadCount);
+		ImGui::Text("Colliders: %u", stats->colliderCount);
+		ImGui::Text("Broadphase pairs: %u", stats->candidatePairCount);
+		ImGui::Text("Sort swaps: %u", stats->sortSwapCount);
+		ImGui::Text("Tree reinserts: %u", stats->treeReinsertCount);
+		if (gameState->broadphase.mode == BROADPHASE_HASH_GRID)
+			ImGui::Text("Grid cells: %u (%u oversized colliders)", stats->hashGridCellCount,
+					stats->hashGridOversizedCount);
+		ImGui::Text("Broadphase time: %.3f ms", stats->lastStepTime * 1000.0f);
+		const NarrowphaseStats *narrowphaseStats = &gameState->narrowphaseStats;
+		ImGui::Text("GJK iterations per pair: %.2f", narrowphaseStats->pairCount ?
+				(f32)narrowphaseStats->gjkIterationCount / narrowphaseStats->pairCount : 0.0f);
+		ImGui::Checkbox("Disable GJK warm start", &g_debugContext->disableGJKWarmStart);
+		{
+			static const char *shortTypeNames[] = { "hull", "cube", "sphere", "cylinder", "capsule" };
+			static_assert(ArrayCount(shortTypeNames) == COLLIDER_TYPE_COUNT);
+			for (int typeA = 0; typeA < COLLIDER_TYPE_COUNT; ++typeA)
+				for (int typeB = 0; typeB < COLLIDER_TYPE_COUNT; ++typeB)
+				{
+					u32 count = narrowphaseStats->analyticCounts[typeA][typeB];
+					if (count)
+						ImGui::Text("Analytic %s-%s: %u", shortTypeNames[typeA],
+								shortTypeNames[typeB], count);
+				}
+		}
+		ImGui::Checkbox("Disable analytic collision", &g_debugContext->disableAnalyticCollision);
+		ImGui::Text("Pairs skipped asleep: %u", narrowphaseStats->sleepingPairCount);
+		const SolverStats *solverStats = &gameState->solverStats;
+		ImGui::Text("Contact constraints: %u in %u islands", solverStats->constraintCount,
+				solverStats->islandCount);
+		ImGui::Text("Colored islands: %u, %u colors (%u constraints left over)",
+				solverStats->coloredIslandCount, solverStats->colorCount,
+				solverStats->uncoloredConstraintCount);
+		ImGui::Text("Solver time: %.3f ms", solverStats->lastStepTime * 1000.0f);
+		const ContinuousCollisionStats *ccdStats = &gameState->continuousCollisionStats;
+		ImGui::Text("Continuous collision: %u bodies swept in %u pairs, %u stopped, %u iterations",
+				ccdStats->sweptBodyCount, ccdStats->sweptPairCount, ccdStats->clampedBodyCount,
+				ccdStats->iterationCount);
+		const SleepStats *sleepStats = &gameState->sleepStats;
+		ImGui::Text("Rigid bodies: %u awake in %u islands, %u sleeping", sleepStats->awakeBodyCount,
+				sleepStats->islandCount, sleepStats->sleepingBodyCount);
+		ImGui::Text("Physics steps last frame: %d", gameState->physicsStepsLastFrame);
+		ImGui::Text("Dropped physics time: %.3f s", gameState->droppedPhysicsTime);
+		const ContactManifoldStats *manifoldStats = &gameState->contactManifoldStats;
+		ImGui::Text("Contact manifolds: %u/%u", manifoldStats->count, manifoldStats->capacity);
+		ImGui::Text("Manifolds evicted: %u last step, %llu total (%llu with entities)",
+				manifoldStats->evictedCount, manifoldStats->totalEvictedCount,
+				manifoldStats->totalRemovedCount);
+
+		AABBTreeMetrics treeMetrics = AABBTreeGetMetrics(&gameState->broadphase.tree);
+		ImGui::Text("Tree height: %u (avg leaf depth %.2f)", treeMetrics.height,
+				treeMetrics.averageLeafDepth);
+		ImGui::Text("Tree SAH cost: %.3f", treeMetrics.SAHCost);
+		if (ImGui::Button("Benchmark AABB kernels"))
+			BroadphaseBenchmarkAABBKernels();
+		if (ImGui::Button("Benchmark job system"))
+			JobSystemBenchmarkScaling();
+		if (ImGui::Button("Benchmark MTQueue contention"))
+			MTQueueBenchmarkContention();
+		if (ImGui::Button("Rebake collision meshes"))
+			BakeRebakeCollisionMeshes();
+		if (ImGui::Button("Rebake test level"))
+			BakeRebakeTestLevel();
+		if (ImGui::Button("Benchmark hull support"))
+			CollisionBenchmarkHullSupport();
+		if (ImGui::Button("Benchmark EPA"))
+			CollisionBenchmarkEPA();
+		if (ImGui::Button("Benchmark level raycasts"))
+			CollisionBenchmarkLevelRaycasts();
+		if (ImGui::Button("Benchmark ray packets"))
+			CollisionBenchmarkRayPackets();
+		if (ImGui::Button("Benchmark integration"))
+			PhysicsBenchmarkIntegration();
+		if (ImGui::Button("Benchmark scene queries"))
+			SceneQueryBenchmark(gameState);
+		if (ImGui::Button("Log tree metrics"))
+			Log("AABB tree: %u leaves, height %u, avg leaf depth %.2f, SAH cost %.3f\n",
+					treeMetrics.leafCount, treeMetrics.height, treeMetrics.averageLeafDepth,
+					treeMetrics.SAHCost);
+	}
+
 	if (ImGui::CollapsingHeader("Collision debug"))
 	{
 		ImGui::Checkbox("Disable depenetration", &g_debugContext->disableDepenetration);
@@ -116,9 +220,11 @@ void ImguiShowEntityTab(GameState *gameState)
 
 	if (ImGui::CollapsingHeader("Transform", ImGuiTreeNodeFlags_DefaultOpen))
 	{
-		ImGui::DragFloat3("Position", selectedEntity->translation.v, 0.01f);
-		ImGui::DragFloat4("Rotation", selectedEntity->rotation.v, 0.01f);
-		ImGui::DragFloat3("Scale", selectedEntity->scale.v, 0.01f);
+		bool moved = ImGui::DragFloat3("Position", selectedEntity->translation.v, 0.01f);
+		moved = ImGui::DragFloat4("Rotation", selectedEntity->rotation.v, 0.01f) || moved;
+		moved = ImGui::DragFloat3("Scale", selectedEntity->scale.v, 0.01f) || moved;
+		if (moved)
+			gameState->broadphase.treeOutdated = true;
 	}
 
 	bool recalculateInersiaTensor = false;
@@ -180,6 +286,9 @@ void ImguiShowEntityTab(GameState *gameState)
 					recalculateInersiaTensor = true;
 				break;
 			}
+			// Shape changed
+			if (recalculateInersiaTensor)
+				gameState->broadphase.treeOutdated = true;
 		}
 		if (!keep)
 		{
@@ -202,24 +311,26 @@ void ImguiShowEntityTab(GameState *gameState)
 	RigidBody *rigidBody = GetEntityRigidBody(gameState, g_editorContext->selectedEntity);
 	if (rigidBody)
 	{
+		f32 *invMass = &gameState->rigidBodyMotion.invMass[RigidBodyIndex(gameState, rigidBody)];
 		bool keep = true;
 		if (ImGui::CollapsingHeader("Rigid body", &keep, ImGuiTreeNodeFlags_DefaultOpen))
 		{
-			f32 mass = 1.0f / rigidBody->invMass;
+			f32 mass = 1.0f / *invMass;
 			if (ImGui::DragFloat("Mass", &mass, 0.01f) && mass > 0)
 			{
-				rigidBody->invMass = 1.0f / mass;
+				*invMass = 1.0f / mass;
 				recalculateInersiaTensor = true;
 			}
 
 			ImGui::DragFloat("Restitution", &rigidBody->restitution, 0.01f);
 			ImGui::DragFloat("Static friction", &rigidBody->staticFriction, 0.01f);
 			ImGui::DragFloat("Dynamic friction", &rigidBody->dynamicFriction, 0.01f);
+			ImGui::Checkbox("Continuous collision", &rigidBody->continuousCollision);
 		}
 		if (recalculateInersiaTensor)
 		{
 			rigidBody->invMomentOfInertiaTensor = CalculateInverseMomentOfInertiaTensor(*collider,
-					rigidBody->invMass);
+					*invMass);
 		}
 		if (!keep)
 		{
@@ -232,13 +343,11 @@ void ImguiShowEntityTab(GameState *gameState)
 		{
 			rigidBody = ArrayAdd(&gameState->rigidBodies);
 			*rigidBody = {};
-			rigidBody->invMass = 1.0f;
 			rigidBody->restitution = 0.3f;
 			rigidBody->staticFriction = 0.4f;
 			rigidBody->dynamicFriction = 0.2f;
-			rigidBody->invMomentOfInertiaTensor = CalculateInverseMomentOfInertiaTensor(*collider,
-					rigidBody->invMass);
-			EntityAssignRigidBody(gameState, g_editorContext->selectedEntity, rigidBody);
+			rigidBody->invMomentOfInertiaTensor = CalculateInverseMomentOfInertiaTensor(*collider, 1.0f);
+			EntityAssignRigidBody(gameState, g_editorContext->selectedEntity, rigidBody, 1.0f);
 		}
 	}
 }
@@ -0,0 +1,338 @@
+struct WorkerThreadArgs
+{
+	JobSystem *jobSystem;
+	u32 threadIndex;
+};
+
+// Owner only. Returns false if the deque is full.
+bool JobDequePush(JobDeque *deque, Job job)
+{
+	s64 bottom = deque->bottom;
+	s64 top = deque->top;
+	if (bottom - top >= JOB_DEQUE_SIZE)
+		return false;
+
+	deque->buffer[bottom & (JOB_DEQUE_SIZE - 1)] = job;
+	// The job has to be in place before thieves can see it.
+	CompilerBarrier();
+	deque->bottom = bottom + 1;
+	return true;
+}
+
+// Owner only. Takes the newest job.
+bool JobDequePop(JobDeque *deque, Job *job)
+{
+	s64 bottom = deque->bottom - 1;
+	// Full barrier, thieves have to see the new bottom before we read top or we could both end up
+	// with the last job.
+	AtomicExchange64(&deque->bottom, bottom);
+	s64 top = deque->top;
+	if (top > bottom)
+	{
+		// Empty
+		deque->bottom = bottom + 1;
+		return false;
+	}
+
+	*job = deque->buffer[bottom & (JOB_DEQUE_SIZE - 1)];
+	if (top < bottom)
+		return true;
+
+	// Last job, race the thieves for it
+	bool won = AtomicCompareExchange64(&deque->top, top + 1, top) == top;
+	deque->bottom = bottom + 1;
+	return won;
+}
+
+// Any thread. Takes the oldest job, fails if the deque is empty or somebody else got there first.
+bool JobDequeSteal(JobDeque *deque, Job *job)
+{
+	s64 top = deque->top;
+	CompilerBarrier();
+	s64 bottom = deque->bottom;
+	if (top >= bottom)
+		return false;
+
+	*job = deque->buffer[top & (JOB_DEQUE_SIZE - 1)];
+	return AtomicCompareExchange64(&deque->top, top + 1, top) == top;
+}
+
+bool JobSystemGetJob(JobSystem *jobSystem, Job *job)
+{
+	const u32 threadIdx = t_threadIndex;
+	if (JobDequePop(&jobSystem->deques[threadIdx], job))
+		return true;
+
+	bool retry = true;
+	while (retry)
+	{
+		retry = false;
+		for (u32 i = 1; i < jobSystem->threadCount; ++i)
+		{
+			JobDeque *victim = &jobSystem->deques[(threadIdx + i) % jobSystem->threadCount];
+			if (JobDequeSteal(victim, job))
+				return true;
+			// Lost a race, there's still work around.
+			if (victim->top < victim->bottom)
+				retry = true;
+		}
+	}
+	return false;
+}
+
+void JobSystemRunJob(JobSystem *jobSystem, Job job)
+{
+	if (job.dependency)
+		JobSystemWaitForCounter(jobSystem, job.dependency);
+
+	job.proc(job.args);
+	AtomicDecrementGetNew(job.counter);
+}
+
+void WorkerThreadProc(void *args)
+{
+	WorkerThreadArgs *workerArgs = (WorkerThreadArgs *)args;
+	JobSystem *jobSystem = workerArgs->jobSystem;
+	t_threadIndex = workerArgs->threadIndex;
+
+	while (!jobSystem->shutdown)
+	{
+		Job job;
+		if (JobSystemGetJob(jobSystem, &job))
+			JobSystemRunJob(jobSystem, job);
+		else
+			PlatformWaitOnSemaphore(jobSystem->semaphore);
+	}
+	AtomicDecrementGetNew(&jobSystem->runningWorkerCount);
+}
+
+// Starts the workers on memory the caller owns: threadCount deques with their buffers already
+// allocated, and room for threadCount WorkerThreadArgs. Both can be reused once the job system is
+// shut down.
+void JobSystemStart(JobSystem *jobSystem, u32 threadCount, JobDeque *deques, WorkerThreadArgs *args)
+{
+	ASSERT(threadCount > 0 && threadCount <= JOB_SYSTEM_MAX_THREADS);
+
+	*jobSystem = {};
+	jobSystem->deques = deques;
+	for (u32 threadIdx = 0; threadIdx < threadCount; ++threadIdx)
+	{
+		deques[threadIdx].top = 0;
+		deques[threadIdx].bottom = 0;
+	}
+	jobSystem->semaphore = PlatformCreateSemaphore();
+	jobSystem->threadCount = threadCount;
+	jobSystem->runningWorkerCount = threadCount - 1;
+
+	t_threadIndex = 0;
+	for (u32 threadIdx = 1; threadIdx < threadCount; ++threadIdx)
+	{
+		args[threadIdx] = { jobSystem, threadIdx };
+		PlatformCreateThread(WorkerThreadProc, &args[threadIdx]);
+	}
+}
+
+template <typename Allocator>
+JobDeque *JobSystemAllocDeques(u32 threadCount)
+{
+	JobDeque *deques = ALLOC_N(Allocator, JobDeque, threadCount);
+	for (u32 threadIdx = 0; threadIdx < threadCount; ++threadIdx)
+	{
+		deques[threadIdx] = {};
+		deques[threadIdx].buffer = ALLOC_N(Allocator, Job, JOB_DEQUE_SIZE);
+	}
+	return deques;
+}
+
+template <typename Allocator>
+void JobSystemInit(JobSystem *jobSystem, u32 threadCount)
+{
+	JobDeque *deques = JobSystemAllocDeques<Allocator>(threadCount);
+	WorkerThreadArgs *args = ALLOC_N(Allocator, WorkerThreadArgs, threadCount);
+	JobSystemStart(jobSystem, threadCount, deques, args);
+}
+
+void JobSystemShutdown(JobSystem *jobSystem)
+{
+	jobSystem->shutdown = 1;
+	if (jobSystem->threadCount > 1)
+		PlatformSignalSemaphore(jobSystem->semaphore, jobSystem->threadCount - 1);
+	while (jobSystem->runningWorkerCount)
+		_mm_pause();
+	PlatformDestroySemaphore(jobSystem->semaphore);
+}
+
+void JobSystemPushJob(JobSystem *jobSystem, Job job)
+{
+	ASSERT(t_threadIndex < jobSystem->threadCount);
+	if (!JobDequePush(&jobSystem->deques[t_threadIndex], job))
+	{
+		// Deque is full, just do it here.
+		JobSystemRunJob(jobSystem, job);
+	}
+}
+
+void JobSystemWakeWorkers(JobSystem *jobSystem, u32 jobCount)
+{
+	u32 wakeCount = Min(jobCount, jobSystem->threadCount - 1);
+	if (wakeCount)
+		PlatformSignalSemaphore(jobSystem->semaphore, wakeCount);
+}
+
+void JobSystemAddJob(JobSystem *jobSystem, JobProc proc, void *args, volatile u32 *counter,
+		volatile u32 *dependency)
+{
+	AtomicIncrementGetNew(counter);
+	JobSystemPushJob(jobSystem, { proc, args, counter, dependency });
+	JobSystemWakeWorkers(jobSystem, 1);
+}
+
+void JobSystemWaitForCounter(JobSystem *jobSystem, volatile u32 *counter)
+{
+	while (*counter)
+	{
+		Job job;
+		if (JobSystemGetJob(jobSystem, &job))
+			JobSystemRunJob(jobSystem, job);
+		else
+			_mm_pause();
+	}
+}
+
+// Runs the same ParallelFor workload on job systems of 1 to N threads and logs how it scales.
+void JobSystemBenchmarkScaling()
+{
+	const u32 itemCount = 1 << 16;
+	const u32 grain = 256;
+	const int runCount = 5;
+	f32 *results = ALLOC_N(FrameAllocator, f32, itemCount);
+
+	u32 maxThreadCount = PlatformGetProcessorCount();
+	maxThreadCount = Min(maxThreadCount, JOB_SYSTEM_MAX_THREADS);
+	// Deques are 128KB each, allocate them once for the most threads and reuse them.
+	JobSystem *jobSystem = ALLOC(FrameAllocator, JobSystem);
+	JobDeque *deques = JobSystemAllocDeques<FrameAllocator>(maxThreadCount);
+	WorkerThreadArgs *args = ALLOC_N(FrameAllocator, WorkerThreadArgs, maxThreadCount);
+	f32 singleThreadTime = 0;
+	for (u32 threadCount = 1; threadCount <= maxThreadCount; ++threadCount)
+	{
+		JobSystemStart(jobSystem, threadCount, deques, args);
+
+		f32 bestTime = INFINITY;
+		for (int runIdx = 0; runIdx < runCount; ++runIdx)
+		{
+			u64 startCounter = PlatformGetPerformanceCounter();
+			ParallelFor(jobSystem, itemCount, grain, [results](u32 beginIdx, u32 endIdx)
+			{
+				for (u32 itemIdx = beginIdx; itemIdx < endIdx; ++itemIdx)
+				{
+					f32 x = (f32)itemIdx;
+					for (int i = 0; i < 64; ++i)
+						x = Sqrt(x * 1.0001f + 1.0f);
+					results[itemIdx] = x;
+				}
+			});
+			f32 time = (f32)(PlatformGetPerformanceCounter() - startCounter) /
+				(f32)PlatformGetPerformanceFrequency();
+			bestTime = Min(bestTime, time);
+		}
+
+		JobSystemShutdown(jobSystem);
+
+		if (threadCount == 1)
+			singleThreadTime = bestTime;
+		Log("Job system: %u threads, %.3f ms (%.2fx)\n", threadCount, bestTime * 1000.0f,
+				singleThreadTime / bestTime);
+	}
+}
+
+struct MTQueueBenchmarkShared
+{
+	MTQueue<u32> *queue;
+	u32 itemsPerProducer;
+	u32 totalItemCount;
+	volatile u32 go;
+	volatile u32 consumedCount;
+	volatile u64 consumedSum;
+	volatile u32 finishedThreadCount;
+};
+
+void MTQueueBenchmarkProducer(void *args)
+{
+	MTQueueBenchmarkShared *shared = (MTQueueBenchmarkShared *)args;
+	while (!shared->go)
+		_mm_pause();
+
+	for (u32 itemIdx = 1; itemIdx <= shared->itemsPerProducer; ++itemIdx)
+	{
+		while (!MTQueueEnqueue(shared->queue, itemIdx))
+			_mm_pause();
+	}
+	AtomicIncrementGetNew(&shared->finishedThreadCount);
+}
+
+void MTQueueBenchmarkConsumer(void *args)
+{
+	MTQueueBenchmarkShared *shared = (MTQueueBenchmarkShared *)args;
+	while (!shared->go)
+		_mm_pause();
+
+	u64 sum = 0;
+	while (shared->consumedCount < shared->totalItemCount)
+	{
+		u32 item;
+		if (MTQueueDequeue(shared->queue, &item))
+		{
+			sum += item;
+			AtomicIncrementGetNew(&shared->consumedCount);
+		}
+		else
+			_mm_pause();
+	}
+	AtomicAddGetOld(&shared->consumedSum, sum);
+	AtomicIncrementGetNew(&shared->finishedThreadCount);
+}
+
+// Pushes the same number of items through an MTQueue with 1 to 16 producers and consumers each and
+// logs the throughput. Also checks nothing got lost or duplicated on the way.
+void MTQueueBenchmarkContention()
+{
+	const u32 itemCount = 1 << 18;
+	const u32 threadCounts[] = { 1, 2, 4, 8, 16 };
+
+	MTQueue<u32> queue;
+	MTQueueInit<FrameAllocator>(&queue, 1024);
+
+	for (u32 producerCount : threadCounts)
+	{
+		for (u32 consumerCount : threadCounts)
+		{
+			MTQueueBenchmarkShared shared = {};
+			shared.queue = &queue;
+			shared.itemsPerProducer = itemCount / producerCount;
+			shared.totalItemCount = shared.itemsPerProducer * producerCount;
+
+			for (u32 i = 0; i < producerCount; ++i)
+				PlatformCreateThread(MTQueueBenchmarkProducer, &shared);
+			for (u32 i = 0; i < consumerCount; ++i)
+				PlatformCreateThread(MTQueueBenchmarkConsumer, &shared);
+
+			u64 startCounter = PlatformGetPerformanceCounter();
+			shared.go = 1;
+			while (shared.finishedThreadCount < producerCount + consumerCount)
+				_mm_pause();
+			f32 time = (f32)(PlatformGetPerformanceCounter() - startCounter) /
+				(f32)PlatformGetPerformanceFrequency();
+
+			const u64 n = shared.itemsPerProducer;
+			const u64 expectedSum = producerCount * (n * (n + 1) / 2);
+			if (shared.consumedSum != expectedSum)
+				Log("ERROR! MTQueue benchmark lost items (sum %llu, expected %llu)\n",
+						shared.consumedSum, expectedSum);
+			ASSERT(MTQueueIsEmpty(&queue));
+
+			Log("MTQueue: %2u producers, %2u consumers, %.3f ms (%.1f M items/s)\n", producerCount,
+					consumerCount, time * 1000.0f, (f32)shared.totalItemCount / time / 1000000.0f);
+		}
+	}
+}
@@ -0,0 +1,99 @@
+// Work-stealing job system. Every thread pushes and pops jobs at the bottom of its own deque, idle
+// threads steal from the top of the others'. Whoever waits on a counter runs jobs in the meantime,
+// so work submitted from the main thread always makes progress.
+const u32 JOB_SYSTEM_MAX_THREADS = 32;
+// Per thread, must be a power of 2. Jobs pushed on a full deque run right away instead.
+const u32 JOB_DEQUE_SIZE = 4096;
+
+typedef void (*JobProc)(void *args);
+
+struct Job
+{
+	JobProc proc;
+	void *args;
+	// Decremented once the job is done.
+	volatile u32 *counter;
+	// Optional, the job doesn't start until this reaches zero.
+	volatile u32 *dependency;
+};
+
+// Chase-Lev deque. Only the owner touches bottom, top is shared with thieves. Padded so the two
+// ends don't share a cache line.
+struct JobDeque
+{
+	volatile s64 top;
+	u8 topPadding[56];
+	volatile s64 bottom;
+	u8 bottomPadding[56];
+	Job *buffer;
+};
+
+struct JobSystem
+{
+	JobDeque *deques;
+	PlatformSemaphore semaphore;
+	// Including the main thread.
+	u32 threadCount;
+	volatile u32 runningWorkerCount;
+	volatile u32 shutdown;
+};
+
+// The calling thread becomes thread 0 and threadCount - 1 workers are started.
+template <typename Allocator>
+void JobSystemInit(JobSystem *jobSystem, u32 threadCount);
+// Returns once all workers have exited.
+void JobSystemShutdown(JobSystem *jobSystem);
+// Increments counter, which has to stay alive until JobSystemWaitForCounter returns. Jobs waiting on
+// a dependency help run other jobs until it's done, the same as JobSystemWaitForCounter.
+void JobSystemAddJob(JobSystem *jobSystem, JobProc proc, void *args, volatile u32 *counter,
+		volatile u32 *dependency = nullptr);
+// Can be called from inside jobs too.
+void JobSystemWaitForCounter(JobSystem *jobSystem, volatile u32 *counter);
+// Pushes without touching job.counter or waking anybody up, follow with JobSystemWakeWorkers.
+void JobSystemPushJob(JobSystem *jobSystem, Job job);
+void JobSystemWakeWorkers(JobSystem *jobSystem, u32 jobCount);
+void JobSystemBenchmarkScaling();
+void MTQueueBenchmarkContention();
+
+template <typename F>
+struct ParallelForJobArgs
+{
+	F *fn;
+	u32 beginIdx;
+	u32 endIdx;
+};
+
+template <typename F>
+void ParallelForJob(void *args)
+{
+	ParallelForJobArgs<F> *job = (ParallelForJobArgs<F> *)args;
+	(*job->fn)(job->beginIdx, job->endIdx);
+}
+
+// Calls fn(beginIdx, endIdx) over [0, count) in chunks of grain elements and returns once all are
+// done. Chunk k is always [k * grain, (k + 1) * grain), so results kept per chunk can be merged back
+// in order no matter which thread ran what.
+template <typename F>
+void ParallelFor(JobSystem *jobSystem, u32 count, u32 grain, F fn)
+{
+	ASSERT(grain > 0);
+	const u32 chunkCount = (count + grain - 1) / grain;
+	if (chunkCount <= 1 || jobSystem->threadCount == 1)
+	{
+		for (u32 beginIdx = 0; beginIdx < count; beginIdx += grain)
+			fn(beginIdx, Min(beginIdx + grain, count));
+		return;
+	}
+
+	ParallelForJobArgs<F> *jobs = ALLOC_N(FrameAllocator, ParallelForJobArgs<F>, chunkCount);
+	volatile u32 counter = chunkCount;
+	// Push the last chunks first so the owner pops them in order and thieves take the other end.
+	for (u32 chunkIdx = chunkCount; chunkIdx-- > 0; )
+	{
+		u32 beginIdx = chunkIdx * grain;
+		jobs[chunkIdx] = { &fn, beginIdx, Min(beginIdx + grain, count) };
+		JobSystemPushJob(jobSystem, { ParallelForJob<F>, &jobs[chunkIdx], &counter, nullptr });
+	}
+	JobSystemWakeWorkers(jobSystem, chunkCount);
+	JobSystemWaitForCounter(jobSystem, &counter);
+}
@@ -14,6 +14,15 @@
 
 #endif
 
+// Don't let the compiler fuse multiplies and adds on its own, results would then depend on the
+// build. The SIMD versions of the functions below don't fuse either, so they round like the scalar
+// ones step by step and give the same bits.
+#if IS_MSVC
+#pragma fp_contract(off)
+#else
+#pragma STDC FP_CONTRACT OFF
+#endif
+
 const f32 PI = 3.1415926535897932384626433832795f;
 const f32 HALFPI = 1.5707963267948966192313216916398f;
 const f32 PI2 = 6.283185307179586476925286766559f;
@@ -520,7 +529,7 @@ inline v3 V3CrossAVX2(const v3 &a, const v3 &b)
 	__m128 a_zxy0 = _mm_permute_ps(a_xyz0, 0b11010010);
 	__m128 b_zxy0 = _mm_permute_ps(b_xyz0, 0b11010010);
 	__m128 cross_yzx = _mm_mul_ps(a_xyz0, b_zxy0);
-	cross_yzx = _mm_fmsub_ps(a_zxy0, b_xyz0, cross_yzx);
+	cross_yzx = _mm_sub_ps(_mm_mul_ps(a_zxy0, b_xyz0), cross_yzx);
 	__m128 cross = _mm_permute_ps(cross_yzx, 0b11010010);
 
 	v4 result;
@@ -956,7 +965,7 @@ inline v3 QuaternionRotateVectorAVX2(const v4 &q, const v3 &v)
 	__m128 v_zxy0 = _mm_permute_ps(v_xyz0, 0b11010010);
 	__m128 q_zxyw = _mm_permute_ps(q_xyzw, 0b11010010);
 	__m128 q2vCross_yzx = _mm_mul_ps(q_xyzw, v_zxy0);
-	q2vCross_yzx = _mm_fmsub_ps(q_zxyw, v_xyz0, q2vCross_yzx);
+	q2vCross_yzx = _mm_sub_ps(_mm_mul_ps(q_zxyw, v_xyz0), q2vCross_yzx);
 	__m128 q2vCross = _mm_permute_ps(q2vCross_yzx, 0b11010010);
 
 	__m128 q2vDot = _mm_dp_ps(q_xyzw, v_xyz0, 0b01111111);
@@ -965,13 +974,13 @@ inline v3 QuaternionRotateVectorAVX2(const v4 &q, const v3 &v)
 	__m128 w = _mm_permute_ps(q_xyzw, 0b11111111);
 	__m128 w2 = _mm_add_ps(w, w);
 	__m128 qvecSqrLen = _mm_dp_ps(q_xyzw, q_xyzw, 0b01111111);
-	__m128 vCoef = _mm_fmsub_ps(w, w, qvecSqrLen);
+	__m128 vCoef = _mm_sub_ps(_mm_mul_ps(w, w), qvecSqrLen);
 
 	__m128 q2vDot2 = _mm_add_ps(q2vDot, q2vDot);
 
 	__m128 result = _mm_mul_ps(q_xyzw, q2vDot2);
-	result = _mm_fmadd_ps(v_xyz0, vCoef, result);
-	result = _mm_fmadd_ps(q2vCross, w2, result);
+	result = _mm_add_ps(result, _mm_mul_ps(v_xyz0, vCoef));
+	result = _mm_add_ps(result, _mm_mul_ps(q2vCross, w2));
 
 	_mm_store_ps(v_.v, result);
 
@@ -999,6 +1008,15 @@ inline v4 QuaternionMultiply(const v4 &a, const v4 &b)
 	return result;
 }
 
+// Normalized lerp, through the shorter way around.
+inline v4 QuaternionNlerp(const v4 &a, const v4 &b, f32 t)
+{
+	v4 from = a;
+	if (V4Dot(from, b) < 0)
+		from = -from;
+	return V4Normalize(from * (1.0f - t) + b * t);
+}
+
 inline v4 QuaternionFromEulerXYZ(const v3 &euler)
 {
 	const f32 halfYaw = euler.z * 0.5f;
@@ -5,6 +5,8 @@ void MemoryInit(Memory *memory)
 	memory->framePtr = memory->frameMem;
 	memory->stackPtr = memory->stackMem;
 	memory->transientPtr = memory->transientMem;
+	// Zeroed thread arenas start out stale.
+	memory->frameGeneration = 1;
 
 	// Init buddy allocator
 	const u32 maxOrder = Ntz(Memory::buddySize / Memory::buddySmallest);
@@ -17,27 +19,41 @@ void MemoryInit(Memory *memory)
 }
 
 // FRAME
-void *FrameAllocator::Alloc(u64 size, int alignment)
+// Each thread bumps through its own block of frame memory so jobs don't fight over framePtr. Blocks
+// are carved off framePtr, and the generation tells a thread its block didn't survive FrameWipe.
+struct FrameArena
 {
-	ASSERT((u8 *)g_memory->framePtr + size < (u8 *)g_memory->frameMem + Memory::frameSize); // Out of memory!
-
-	u8 *result;
+	u8 *ptr;
+	u8 *end;
+	u64 generation;
+};
+thread_local FrameArena t_frameArena;
 
-	result = (u8 *)g_memory->framePtr;
+inline u8 *FrameAllocShared(u64 size)
+{
+	u8 *result = (u8 *)AtomicAddGetOld((volatile u64 *)&g_memory->framePtr, size);
+	ASSERT(result + size < (u8 *)g_memory->frameMem + Memory::frameSize); // Out of memory!
+	return result;
+}
 
-#if ENABLE_ALIGNMENT
-	// Alignment
-	ASSERT(IsPowerOf2(alignment));
-	int alignmentMask = alignment - 1;
+void *FrameAllocator::Alloc(u64 size, int alignment)
+{
+	(void) alignment;
 
-	u64 shift = 0;
-	if (result & alignmentMask) shift = alignment;
-	result += shift;
-	result &= ~alignmentMask;
-#endif
+	FrameArena *arena = &t_frameArena;
+	if (arena->generation != g_memory->frameGeneration || arena->ptr + size > arena->end)
+	{
+		// Big allocations would waste most of a block
+		if (size > Memory::frameArenaBlockSize / 4)
+			return FrameAllocShared(size);
 
-	g_memory->framePtr = result + size;
+		arena->ptr = FrameAllocShared(Memory::frameArenaBlockSize);
+		arena->end = arena->ptr + Memory::frameArenaBlockSize;
+		arena->generation = g_memory->frameGeneration;
+	}
 
+	u8 *result = arena->ptr;
+	arena->ptr += size;
 	return result;
 }
 void *FrameAllocator::Realloc(void *ptr, u64 oldSize, u64 newSize, int alignment)
@@ -56,6 +72,7 @@ void FrameWipe()
 {
 	g_memory->lastFrameUsage = (u8 *)g_memory->framePtr - (u8 *)g_memory->frameMem;
 	g_memory->framePtr = g_memory->frameMem;
+	AtomicAddGetOld(&g_memory->frameGeneration, 1);
 }
 
 // STACK
@@ -6,6 +6,8 @@ struct Memory
 	void *frameMem, *stackMem, *transientMem, *buddyMem;
 	void *framePtr, *stackPtr, *transientPtr;
 	u64 lastFrameUsage;
+	// Bumped by FrameWipe so threads know their frame arena is stale.
+	volatile u64 frameGeneration;
 	u8 *buddyBookkeep;
 
 #if DEBUG_BUILD
@@ -14,6 +16,7 @@ struct Memory
 #endif
 
 	static const u64 frameSize = 64 * 1024 * 1024;
+	static const u64 frameArenaBlockSize = 64 * 1024;
 	static const u64 stackSize = 64 * 1024 * 1024;
 	static const u64 transientSize = 64 * 1024 * 1024;
 	static const u64 buddySize = 32 * 1024 * 1024;
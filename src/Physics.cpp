@@ -1,286 +1,1173 @@
-void SimulatePhysics(GameState *gameState, f32 deltaTime)
+const u32 NARROWPHASE_PAIRS_PER_JOB = 32;
+
+struct NarrowphaseResult
+{
+	u32 pairIdx;
+	CollisionInfo collisionInfo;
+	FixedArray<CachedHitPoint, 8> hitPointCache;
+};
+typedef DynamicArray<NarrowphaseResult, FrameAllocator> NarrowphaseChunkResults;
+
+// Sequential impulse contact solver. Each contact point keeps its accumulated impulses, which are
+// clamped as a whole rather than per iteration, and start out from last step's (warm starting).
+// Penetration is resolved with split impulses: a separate pseudo velocity that moves bodies apart
+// this step without adding momentum, so pushing boxes out of each other doesn't make them bounce.
+const f32 SOLVER_BAUMGARTE = 0.2f;
+const f32 SOLVER_PENETRATION_SLOP = 0.005f;
+// Closing speeds below this don't bounce, so resting contacts settle.
+const f32 SOLVER_RESTITUTION_THRESHOLD = 1.0f;
+// A point takes the impulses of last step's point closest to it in A's space, if within this.
+const f32 SOLVER_WARM_START_DISTANCE = 0.05f;
+// Warm starting is skipped if the contact normal turned more than this (cosine).
+const f32 SOLVER_WARM_START_MIN_NORMAL_DOT = 0.95f;
+
+struct ContactPoint
+{
+	v3 rA;
+	v3 rB;
+	// rA in A's frame, to find last step's point this one continues.
+	v3 localA;
+	f32 depth;
+	f32 normalMass;
+	f32 tangentMasses[2];
+	// Target normal velocity, from restitution.
+	f32 velocityBias;
+	f32 normalImpulse;
+	f32 tangentImpulses[2];
+	f32 positionImpulse;
+};
+
+struct ContactConstraint
+{
+	RigidBody *rigidBodyA;
+	RigidBody *rigidBodyB;
+	// Into GameState::rigidBodyMotion, RIGID_BODY_STATIC_IDX for RIGID_BODY_STATIC.
+	u32 rigidBodyIdxA;
+	u32 rigidBodyIdxB;
+	CollisionPair key;
+	// From B to A, like CollisionInfo.
+	v3 normal;
+	v3 tangents[2];
+	f32 restitution;
+	f32 staticFriction;
+	f32 dynamicFriction;
+	int pointCount;
+	ContactPoint points[8];
+};
+
+// Constraints per job when solving in parallel.
+const u32 SOLVER_CONSTRAINTS_PER_JOB = 32;
+// Islands with at least this many constraints get colored rather than solved by one job.
+const u32 SOLVER_COLORING_MIN_CONSTRAINTS = 128;
+const u32 SOLVER_MAX_COLORS = 64;
+
+// Bodies slower than this for SLEEP_TIME go to sleep, a whole island at a time.
+const f32 SLEEP_LINEAR_VELOCITY = 0.1f;
+const f32 SLEEP_ANGULAR_VELOCITY = 0.15f;
+const f32 SLEEP_TIME = 0.5f;
+
+// Bodies with continuous collision that moved less than this fraction of their smallest extent in
+// a step aren't swept, they can't have skipped past anything.
+const f32 CCD_MOTION_THRESHOLD = 0.25f;
+// Swept bodies are stopped this far into what they hit, so the next step has a contact to solve.
+const f32 CCD_TARGET_DISTANCE = 0.01f;
+const f32 CCD_PENETRATION = 0.01f;
+
+// How long every frame is taken to be in deterministic mode.
+const f64 DETERMINISTIC_FRAME_TIME = 1.0 / 60.0;
+
+void GetTangentBasis(v3 normal, v3 *tangentA, v3 *tangentB)
+{
+	if (Abs(normal.x) > 0.57735f)
+		*tangentA = V3Normalize(v3{ normal.y, -normal.x, 0 });
+	else
+		*tangentA = V3Normalize(v3{ 0, normal.z, -normal.y });
+	*tangentB = V3Cross(normal, *tangentA);
+}
+
+inline f32 ContactEffectiveMass(const RigidBodyMotion *motion, const ContactConstraint *constraint,
+		v3 rA, v3 rB, v3 dir)
+{
+	v3 crossA = V3Cross(Mat3TransformVector(constraint->rigidBodyA->worldInvMomentOfInertiaTensor,
+			V3Cross(rA, dir)), rA);
+	v3 crossB = V3Cross(Mat3TransformVector(constraint->rigidBodyB->worldInvMomentOfInertiaTensor,
+			V3Cross(rB, dir)), rB);
+	f32 k = motion->invMass[constraint->rigidBodyIdxA] +
+		motion->invMass[constraint->rigidBodyIdxB] + V3Dot(crossA + crossB, dir);
+	return k > 0 ? 1.0f / k : 0.0f;
+}
+
+// Velocity of A relative to B at the contact point.
+inline v3 ContactRelativeVelocity(const RigidBodyMotion *motion,
+		const ContactConstraint *constraint, v3 rA, v3 rB)
 {
-	// Calculate AABBs
-	struct AABB
+	const u32 idxA = constraint->rigidBodyIdxA;
+	const u32 idxB = constraint->rigidBodyIdxB;
+	v3 velA = V3SoAGet(&motion->velocity, idxA) +
+		V3Cross(V3SoAGet(&motion->angularVelocity, idxA), rA);
+	v3 velB = V3SoAGet(&motion->velocity, idxB) +
+		V3Cross(V3SoAGet(&motion->angularVelocity, idxB), rB);
+	return velA - velB;
+}
+
+// Impulse goes to A as is and to B negated.
+// RIGID_BODY_STATIC is left alone, it's shared by constraints solved on different threads.
+inline void ApplyContactImpulse(RigidBodyMotion *motion, const ContactConstraint *constraint, v3 rA,
+		v3 rB, v3 impulse)
+{
+	const u32 idxA = constraint->rigidBodyIdxA;
+	const u32 idxB = constraint->rigidBodyIdxB;
+	if (idxA != RIGID_BODY_STATIC_IDX)
 	{
-		v3 min;
-		v3 max;
-	};
-	Array<AABB, FrameAllocator> AABBs;
-	ArrayInit(&AABBs, gameState->colliders.count);
-	for (u32 colliderIdx = 0; colliderIdx < gameState->colliders.count; ++colliderIdx)
-	{
-		Collider *collider = &gameState->colliders[colliderIdx];
-		Transform *transform = GetEntityTransform(gameState, collider->entityHandle);
-		AABB *aabb = ArrayAdd(&AABBs);
-		GetAABB(transform, collider, &aabb->min, &aabb->max);
-	}
-
-	struct Collision
-	{
-		EntityHandle entityA;
-		EntityHandle entityB;
-		v3 hitNormal;
-		f32 depth;
-		int hitCount;
-		v3 hitPoints[8];
-		f32 hitDepths[8];
-		// We save these to calculate friction
-		f32 normalImpulseMags[8];
-	};
+		V3SoASet(&motion->velocity, idxA, V3SoAGet(&motion->velocity, idxA) +
+				impulse * motion->invMass[idxA]);
+		V3SoASet(&motion->angularVelocity, idxA, V3SoAGet(&motion->angularVelocity, idxA) +
+				Mat3TransformVector(constraint->rigidBodyA->worldInvMomentOfInertiaTensor,
+					V3Cross(rA, impulse)));
+	}
+	if (idxB != RIGID_BODY_STATIC_IDX)
+	{
+		V3SoASet(&motion->velocity, idxB, V3SoAGet(&motion->velocity, idxB) -
+				impulse * motion->invMass[idxB]);
+		V3SoASet(&motion->angularVelocity, idxB, V3SoAGet(&motion->angularVelocity, idxB) -
+				Mat3TransformVector(constraint->rigidBodyB->worldInvMomentOfInertiaTensor,
+					V3Cross(rB, impulse)));
+	}
+}
 
-	// Test for collisions
-	DynamicArray<Collision, FrameAllocator> collisions;
-	DynamicArrayInit(&collisions, 32);
-	for (u32 colliderAIdx = 0; colliderAIdx < gameState->colliders.count; ++colliderAIdx)
+// Picks up last step's impulses for the points but doesn't apply them, see WarmStartContactConstraint.
+void PrepareContactConstraint(GameState *gameState, ContactConstraint *constraint,
+		const CollisionInfo *collisionInfo, u32 step)
+{
+	const RigidBodyMotion *motion = &gameState->rigidBodyMotion;
+	RigidBody *rigidBodyA = constraint->rigidBodyA;
+	RigidBody *rigidBodyB = constraint->rigidBodyB;
+	Transform *transformA = GetEntityTransform(gameState, constraint->key.a);
+	Transform *transformB = GetEntityTransform(gameState, constraint->key.b);
+
+	constraint->normal = collisionInfo->hitNormal;
+	GetTangentBasis(constraint->normal, &constraint->tangents[0], &constraint->tangents[1]);
+	constraint->restitution = Min(rigidBodyA->restitution, rigidBodyB->restitution);
+	constraint->staticFriction = (rigidBodyA->staticFriction + rigidBodyB->staticFriction) * 0.5f;
+	constraint->dynamicFriction = (rigidBodyA->dynamicFriction + rigidBodyB->dynamicFriction) * 0.5f;
+	constraint->pointCount = collisionInfo->hitCount;
+
+	// The manifold was stamped when the pair was tested this step.
+	const ContactManifold *manifold = HashMapGet(gameState->contactManifolds, constraint->key);
+	bool warmStart = manifold->impulseStep == step - 1 && V3Dot(manifold->impulseNormal,
+			constraint->normal) >= SOLVER_WARM_START_MIN_NORMAL_DOT;
+#if DEBUG_BUILD
+	if (g_debugContext->disableWarmStarting)
+		warmStart = false;
+#endif
+	u8 usedImpulses = 0;
+
+	for (int pointIdx = 0; pointIdx < constraint->pointCount; ++pointIdx)
 	{
-		Collider *colliderA = &gameState->colliders[colliderAIdx];
-		Transform *transformA = GetEntityTransform(gameState, colliderA->entityHandle);
-		ASSERT(transformA); // There should never be an orphaned collider.
-		AABB aabbA = AABBs[colliderAIdx];
+		ContactPoint *point = &constraint->points[pointIdx];
+		v3 hit = collisionInfo->hitPoints[pointIdx];
+		point->rA = hit - transformA->translation;
+		point->rB = hit - transformB->translation;
+		point->localA = ReverseTransformDirection(*transformA, point->rA);
+		point->depth = collisionInfo->hitDepths[pointIdx];
+		point->normalMass = ContactEffectiveMass(motion, constraint, point->rA, point->rB,
+				constraint->normal);
+		for (int i = 0; i < 2; ++i)
+			point->tangentMasses[i] = ContactEffectiveMass(motion, constraint, point->rA, point->rB,
+					constraint->tangents[i]);
+
+		f32 normalSpeed = V3Dot(ContactRelativeVelocity(motion, constraint, point->rA, point->rB),
+				constraint->normal);
+		// Points slightly apart (depth < 0) are solved as touching. Letting them close the gap
+		// instead has warm started impulses pull the bodies together and makes stacks rock.
+		point->velocityBias = 0;
+		if (normalSpeed < -SOLVER_RESTITUTION_THRESHOLD)
+			point->velocityBias = -constraint->restitution * normalSpeed;
+
+		point->normalImpulse = 0;
+		point->tangentImpulses[0] = 0;
+		point->tangentImpulses[1] = 0;
+		point->positionImpulse = 0;
+		if (warmStart)
+		{
+			int closestIdx = -1;
+			f32 closestSqrDist = SOLVER_WARM_START_DISTANCE * SOLVER_WARM_START_DISTANCE;
+			for (int oldIdx = 0; oldIdx < manifold->impulseCount; ++oldIdx)
+			{
+				f32 sqrDist = V3SqrLen(manifold->impulseLocalA[oldIdx] - point->localA);
+				if (!(usedImpulses & (1 << oldIdx)) && sqrDist < closestSqrDist)
+				{
+					closestIdx = oldIdx;
+					closestSqrDist = sqrDist;
+				}
+			}
+			if (closestIdx >= 0)
+			{
+				usedImpulses |= 1 << closestIdx;
+				point->normalImpulse = manifold->normalImpulses[closestIdx];
+				for (int i = 0; i < 2; ++i)
+					point->tangentImpulses[i] = V3Dot(manifold->tangentImpulses[closestIdx],
+							constraint->tangents[i]);
+			}
+		}
+	}
+}
 
-		for (u32 colliderBIdx = colliderAIdx + 1; colliderBIdx < gameState->colliders.count; ++colliderBIdx)
+// Applies the impulses the points start out with. Done once every constraint is prepared, so none of
+// them sees velocities already changed by another's warm start.
+void WarmStartContactConstraint(RigidBodyMotion *motion, ContactConstraint *constraint,
+		bool enableFriction)
+{
+	for (int pointIdx = 0; pointIdx < constraint->pointCount; ++pointIdx)
+	{
+		ContactPoint *point = &constraint->points[pointIdx];
+		if (!enableFriction)
 		{
-			Collider *colliderB = &gameState->colliders[colliderBIdx];
-			Transform *transformB = GetEntityTransform(gameState, colliderB->entityHandle);
-			ASSERT(transformB); // There should never be an orphaned collider.
-			AABB aabbB = AABBs[colliderAIdx];
+			point->tangentImpulses[0] = 0;
+			point->tangentImpulses[1] = 0;
+		}
+		v3 impulse = constraint->normal * point->normalImpulse +
+			constraint->tangents[0] * point->tangentImpulses[0] +
+			constraint->tangents[1] * point->tangentImpulses[1];
+		ApplyContactImpulse(motion, constraint, point->rA, point->rB, impulse);
+	}
+}
 
-			if (!TestAABBs(aabbA.min, aabbA.max, aabbB.min, aabbB.max))
-				continue;
+void SolveContactVelocities(RigidBodyMotion *motion, ContactConstraint *constraint,
+		bool enableFriction)
+{
+	const v3 normal = constraint->normal;
 
-			CollisionInfo collisionInfo = TestCollision(gameState, transformA, transformB,
-					colliderA, colliderB);
-			if (collisionInfo.hitCount)
+	// Friction first, so the normal impulses that hold the stack up get the last word.
+	if (enableFriction)
+	{
+		for (int pointIdx = 0; pointIdx < constraint->pointCount; ++pointIdx)
+		{
+			ContactPoint *point = &constraint->points[pointIdx];
+			v3 relVel = ContactRelativeVelocity(motion, constraint, point->rA, point->rB);
+
+			f32 newImpulses[2];
+			for (int i = 0; i < 2; ++i)
+				newImpulses[i] = point->tangentImpulses[i] -
+					V3Dot(relVel, constraint->tangents[i]) * point->tangentMasses[i];
+
+			// Sticks while it takes less than static friction allows, slides with dynamic
+			// friction otherwise.
+			f32 sqrLen = newImpulses[0] * newImpulses[0] + newImpulses[1] * newImpulses[1];
+			f32 maxStatic = constraint->staticFriction * point->normalImpulse;
+			if (sqrLen > maxStatic * maxStatic)
 			{
-				Collision *newCollision = DynamicArrayAdd(&collisions);
-				*newCollision = {
-					.entityA = colliderA->entityHandle,
-					.entityB = colliderB->entityHandle,
-					.hitNormal = collisionInfo.hitNormal,
-					.depth = collisionInfo.depth,
-					.hitCount = collisionInfo.hitCount,
-				};
-				memcpy(newCollision->hitPoints, collisionInfo.hitPoints,
-						collisionInfo.hitCount * sizeof(v3));
-				memcpy(newCollision->hitDepths, collisionInfo.hitDepths,
-						collisionInfo.hitCount * sizeof(f32));
-				memset(newCollision->normalImpulseMags, 0,
-						collisionInfo.hitCount * sizeof(v3));
-
-#if DEBUG_BUILD
-				if (g_debugContext->pausePhysicsOnContact)
-					g_debugContext->pausePhysics = true;
-#endif
+				f32 scale = constraint->dynamicFriction * point->normalImpulse / Sqrt(sqrLen);
+				newImpulses[0] *= scale;
+				newImpulses[1] *= scale;
 			}
+
+			v3 impulse = constraint->tangents[0] * (newImpulses[0] - point->tangentImpulses[0]) +
+				constraint->tangents[1] * (newImpulses[1] - point->tangentImpulses[1]);
+			point->tangentImpulses[0] = newImpulses[0];
+			point->tangentImpulses[1] = newImpulses[1];
+			ApplyContactImpulse(motion, constraint, point->rA, point->rB, impulse);
 		}
 	}
 
+	for (int pointIdx = 0; pointIdx < constraint->pointCount; ++pointIdx)
+	{
+		ContactPoint *point = &constraint->points[pointIdx];
+		v3 relVel = ContactRelativeVelocity(motion, constraint, point->rA, point->rB);
+		f32 normalSpeed = V3Dot(relVel, normal);
+
+		f32 newImpulse = point->normalImpulse + (point->velocityBias - normalSpeed) *
+			point->normalMass;
+		newImpulse = Max(newImpulse, 0.0f);
+		f32 delta = newImpulse - point->normalImpulse;
+		point->normalImpulse = newImpulse;
+		ApplyContactImpulse(motion, constraint, point->rA, point->rB, normal * delta);
+	}
+}
+
+// Same as SolveContactVelocities but on the pseudo velocities, towards closing the penetration.
+void SolveContactPositions(RigidBodyMotion *motion, ContactConstraint *constraint, f32 deltaTime)
+{
+	const u32 idxA = constraint->rigidBodyIdxA;
+	const u32 idxB = constraint->rigidBodyIdxB;
+	const v3 normal = constraint->normal;
+	for (int pointIdx = 0; pointIdx < constraint->pointCount; ++pointIdx)
+	{
+		ContactPoint *point = &constraint->points[pointIdx];
+		f32 error = point->depth - SOLVER_PENETRATION_SLOP;
+		if (error <= 0)
+			continue;
+
+		v3 velA = V3SoAGet(&motion->pseudoVelocity, idxA) +
+			V3Cross(V3SoAGet(&motion->pseudoAngularVelocity, idxA), point->rA);
+		v3 velB = V3SoAGet(&motion->pseudoVelocity, idxB) +
+			V3Cross(V3SoAGet(&motion->pseudoAngularVelocity, idxB), point->rB);
+		f32 normalSpeed = V3Dot(velA - velB, normal);
+
+		f32 targetSpeed = SOLVER_BAUMGARTE * error / deltaTime;
+		f32 newImpulse = Max(point->positionImpulse + (targetSpeed - normalSpeed) * point->normalMass,
+				0.0f);
+		v3 impulse = normal * (newImpulse - point->positionImpulse);
+		point->positionImpulse = newImpulse;
+
+		if (idxA != RIGID_BODY_STATIC_IDX)
+		{
+			V3SoASet(&motion->pseudoVelocity, idxA, V3SoAGet(&motion->pseudoVelocity, idxA) +
+					impulse * motion->invMass[idxA]);
+			V3SoASet(&motion->pseudoAngularVelocity, idxA,
+					V3SoAGet(&motion->pseudoAngularVelocity, idxA) + Mat3TransformVector(
+						constraint->rigidBodyA->worldInvMomentOfInertiaTensor,
+						V3Cross(point->rA, impulse)));
+		}
+		if (idxB != RIGID_BODY_STATIC_IDX)
+		{
+			V3SoASet(&motion->pseudoVelocity, idxB, V3SoAGet(&motion->pseudoVelocity, idxB) -
+					impulse * motion->invMass[idxB]);
+			V3SoASet(&motion->pseudoAngularVelocity, idxB,
+					V3SoAGet(&motion->pseudoAngularVelocity, idxB) - Mat3TransformVector(
+						constraint->rigidBodyB->worldInvMomentOfInertiaTensor,
+						V3Cross(point->rB, impulse)));
+		}
+	}
+}
+
+// Keeps this step's impulses in the pair's manifold for the next step to warm start from.
+void StoreContactImpulses(GameState *gameState, const ContactConstraint *constraint, u32 step)
+{
+	ContactManifold *manifold = HashMapGet(gameState->contactManifolds, constraint->key);
+	manifold->impulseStep = step;
+	manifold->impulseNormal = constraint->normal;
+	manifold->impulseCount = constraint->pointCount;
+	for (int pointIdx = 0; pointIdx < constraint->pointCount; ++pointIdx)
+	{
+		const ContactPoint *point = &constraint->points[pointIdx];
+		manifold->impulseLocalA[pointIdx] = point->localA;
+		manifold->normalImpulses[pointIdx] = point->normalImpulse;
+		manifold->tangentImpulses[pointIdx] = constraint->tangents[0] * point->tangentImpulses[0] +
+			constraint->tangents[1] * point->tangentImpulses[1];
+	}
+}
+
+inline bool IsRigidBodyAwake(const RigidBody *rigidBody)
+{
+	return rigidBody && !rigidBody->sleeping;
+}
+
+inline u32 IslandFind(u32 *parents, u32 idx)
+{
+	while (parents[idx] != idx)
+	{
+		parents[idx] = parents[parents[idx]];
+		idx = parents[idx];
+	}
+	return idx;
+}
+
+// Lower index becomes the root, so islands come out the same regardless of pair order.
+inline void IslandUnion(u32 *parents, u32 idxA, u32 idxB)
+{
+	u32 rootA = IslandFind(parents, idxA);
+	u32 rootB = IslandFind(parents, idxB);
+	if (rootA < rootB)
+		parents[rootB] = rootA;
+	else if (rootB < rootA)
+		parents[rootA] = rootB;
+}
+
+// Groups awake bodies into islands over this step's contacts and springs. Returns the union-find
+// parent of each rigid body, follow it with IslandFind.
+u32 *BuildIslands(GameState *gameState, const ContactConstraint *constraints, u32 constraintCount)
+{
+	const u32 rigidBodyCount = gameState->rigidBodies.count;
+	u32 *parents = ALLOC_N(FrameAllocator, u32, rigidBodyCount);
+	for (u32 rigidBodyIdx = 0; rigidBodyIdx < rigidBodyCount; ++rigidBodyIdx)
+		parents[rigidBodyIdx] = rigidBodyIdx;
+
+	// Sleeping bodies show up as RIGID_BODY_STATIC in constraints, so these are all awake.
+	for (u32 constraintIdx = 0; constraintIdx < constraintCount; ++constraintIdx)
+	{
+		const ContactConstraint *constraint = &constraints[constraintIdx];
+		if (constraint->rigidBodyIdxA == RIGID_BODY_STATIC_IDX ||
+				constraint->rigidBodyIdxB == RIGID_BODY_STATIC_IDX)
+			continue;
+		IslandUnion(parents, constraint->rigidBodyIdxA, constraint->rigidBodyIdxB);
+	}
+	for (u32 springIdx = 0; springIdx < gameState->springs.count; ++springIdx)
+	{
+		const Spring *spring = &gameState->springs[springIdx];
+		RigidBody *rigidBodyA = GetEntityRigidBody(gameState, spring->entityA);
+		RigidBody *rigidBodyB = GetEntityRigidBody(gameState, spring->entityB);
+		if (!IsRigidBodyAwake(rigidBodyA) || !IsRigidBodyAwake(rigidBodyB))
+			continue;
+		IslandUnion(parents, RigidBodyIndex(gameState, rigidBodyA),
+				RigidBodyIndex(gameState, rigidBodyB));
+	}
+	return parents;
+}
+
+// Puts to sleep the islands where every body has been resting for long enough.
+void UpdateIslands(GameState *gameState, u32 *parents, f32 deltaTime)
+{
+	const u32 rigidBodyCount = gameState->rigidBodies.count;
+
+	bool enableSleeping = true;
 #if DEBUG_BUILD
-	if (g_debugContext->pausePhysics)
-		return;
+	enableSleeping = !g_debugContext->disableSleeping;
 #endif
 
-	for (u32 rigidBodyIdx = 0; rigidBodyIdx < gameState->rigidBodies.count; ++rigidBodyIdx)
+	// Shortest resting time in each island, kept at the root.
+	f32 *islandSleepTimers = ALLOC_N(FrameAllocator, f32, rigidBodyCount);
+	for (u32 rigidBodyIdx = 0; rigidBodyIdx < rigidBodyCount; ++rigidBodyIdx)
+		islandSleepTimers[rigidBodyIdx] = INFINITY;
+
+	RigidBodyMotion *motion = &gameState->rigidBodyMotion;
+	const f32 sqrLinearThreshold = SLEEP_LINEAR_VELOCITY * SLEEP_LINEAR_VELOCITY;
+	const f32 sqrAngularThreshold = SLEEP_ANGULAR_VELOCITY * SLEEP_ANGULAR_VELOCITY;
+	for (u32 rigidBodyIdx = 0; rigidBodyIdx < rigidBodyCount; ++rigidBodyIdx)
 	{
 		RigidBody *rigidBody = &gameState->rigidBodies[rigidBodyIdx];
-		Transform *transform = GetEntityTransform(gameState, rigidBody->entityHandle);
-		ASSERT(transform); // There should never be an orphaned rigid body.
+		if (rigidBody->sleeping)
+			continue;
 
-		// Gravity
-		rigidBody->velocity.z -= 9.8f * deltaTime;
+		if (enableSleeping &&
+				V3SqrLen(V3SoAGet(&motion->velocity, rigidBodyIdx)) < sqrLinearThreshold &&
+				V3SqrLen(V3SoAGet(&motion->angularVelocity, rigidBodyIdx)) < sqrAngularThreshold)
+			rigidBody->sleepTimer += deltaTime;
+		else
+			rigidBody->sleepTimer = 0;
 
-		// Calculate world-space inverse moment of inertia tensors for each rigid body
-		mat3 R = Mat3FromQuaternion(transform->rotation);
-		mat3 noR = Mat3Transpose(R);
-		rigidBody->worldInvMomentOfInertiaTensor = Mat3Multiply(
-				Mat3Multiply(R, rigidBody->invMomentOfInertiaTensor), noR);
+		u32 root = IslandFind(parents, rigidBodyIdx);
+		islandSleepTimers[root] = Min(islandSleepTimers[root], rigidBody->sleepTimer);
 	}
 
-	// Bounce impulse
-	for (u32 collisionIdx = 0; collisionIdx < collisions.count; ++collisionIdx)
+	SleepStats *stats = &gameState->sleepStats;
+	*stats = {};
+	for (u32 rigidBodyIdx = 0; rigidBodyIdx < rigidBodyCount; ++rigidBodyIdx)
 	{
-		Collision* collision = &collisions[collisionIdx];
-		if (collision->depth <= 0.0f)
+		RigidBody *rigidBody = &gameState->rigidBodies[rigidBodyIdx];
+		if (rigidBody->sleeping)
+		{
+			++stats->sleepingBodyCount;
 			continue;
+		}
 
-		RigidBody *rigidBodyA = GetEntityRigidBody(gameState, collision->entityA);
-		RigidBody *rigidBodyB = GetEntityRigidBody(gameState, collision->entityB);
-		bool hasRigidBodyA = rigidBodyA != nullptr;
-		bool hasRigidBodyB = rigidBodyB != nullptr;
+		u32 root = IslandFind(parents, rigidBodyIdx);
+		if (root == rigidBodyIdx)
+			++stats->islandCount;
+		if (islandSleepTimers[root] >= SLEEP_TIME)
+		{
+			rigidBody->sleeping = true;
+			V3SoASet(&motion->velocity, rigidBodyIdx, {});
+			V3SoASet(&motion->angularVelocity, rigidBodyIdx, {});
+			++stats->sleepingBodyCount;
+		}
+		else
+			++stats->awakeBodyCount;
+	}
+}
 
-		if (!hasRigidBodyA && !hasRigidBodyB)
-			continue;
+struct SolverSettings
+{
+	int iterations;
+	bool enableFriction;
+	bool enablePositionCorrection;
+	f32 deltaTime;
+};
+
+// Runs the whole solve on the given constraints in order. They can span several islands as long
+// as no other thread touches their bodies meanwhile.
+void SolveContactRange(RigidBodyMotion *motion, ContactConstraint *constraints,
+		const u32 *constraintIndices, u32 count, const SolverSettings *settings)
+{
+	for (u32 i = 0; i < count; ++i)
+		WarmStartContactConstraint(motion, &constraints[constraintIndices[i]],
+				settings->enableFriction);
+	for (int iteration = 0; iteration < settings->iterations; ++iteration)
+	{
+		for (u32 i = 0; i < count; ++i)
+			SolveContactVelocities(motion, &constraints[constraintIndices[i]],
+					settings->enableFriction);
+	}
+	if (settings->enablePositionCorrection)
+	{
+		for (int iteration = 0; iteration < settings->iterations; ++iteration)
+		{
+			for (u32 i = 0; i < count; ++i)
+				SolveContactPositions(motion, &constraints[constraintIndices[i]],
+						settings->deltaTime);
+		}
+	}
+}
 
-		if (!rigidBodyA) rigidBodyA = &RIGID_BODY_STATIC;
-		if (!rigidBodyB) rigidBodyB = &RIGID_BODY_STATIC;
+// Solves islands in parallel. Small islands are packed into jobs of about
+// SOLVER_CONSTRAINTS_PER_JOB constraints, each job solving its islands start to end. Islands too
+// big for one job are colored: constraints go into batches that share no body, and each batch is
+// solved in parallel in turn, for every iteration. Both layouts only depend on constraint order,
+// so results don't depend on the thread count.
+void SolveContactConstraints(GameState *gameState, ContactConstraint *constraints,
+		u32 constraintCount, u32 *islandParents, const SolverSettings *settings)
+{
+	u64 startCounter = PlatformGetPerformanceCounter();
+	SolverStats *stats = &gameState->solverStats;
+	*stats = {};
+	stats->constraintCount = constraintCount;
+	RigidBodyMotion *motion = &gameState->rigidBodyMotion;
+
+	// Constraint count of each island, at its root.
+	const u32 rigidBodyCount = gameState->rigidBodies.count;
+	u32 *islandCounts = ALLOC_N(FrameAllocator, u32, rigidBodyCount);
+	memset(islandCounts, 0, sizeof(u32) * rigidBodyCount);
+	u32 *constraintRoots = ALLOC_N(FrameAllocator, u32, constraintCount);
+	for (u32 constraintIdx = 0; constraintIdx < constraintCount; ++constraintIdx)
+	{
+		const ContactConstraint *constraint = &constraints[constraintIdx];
+		// Every constraint has at least one dynamic body.
+		const u32 rigidBodyIdx = constraint->rigidBodyIdxA != RIGID_BODY_STATIC_IDX ?
+			constraint->rigidBodyIdxA : constraint->rigidBodyIdxB;
+		u32 root = IslandFind(islandParents, rigidBodyIdx);
+		constraintRoots[constraintIdx] = root;
+		++islandCounts[root];
+	}
 
-		Transform *transformA = GetEntityTransform(gameState, collision->entityA);
-		Transform *transformB = GetEntityTransform(gameState, collision->entityB);
+	// Lay out constraints by island, small islands first, in constraint order within each.
+	u32 *islandOffsets = ALLOC_N(FrameAllocator, u32, rigidBodyCount);
+	u32 smallConstraintCount = 0;
+	for (u32 root = 0; root < rigidBodyCount; ++root)
+	{
+		if (islandCounts[root] && islandCounts[root] < SOLVER_COLORING_MIN_CONSTRAINTS)
+			smallConstraintCount += islandCounts[root];
+	}
+	u32 smallOffset = 0;
+	u32 largeOffset = smallConstraintCount;
+	for (u32 root = 0; root < rigidBodyCount; ++root)
+	{
+		u32 count = islandCounts[root];
+		if (!count)
+			continue;
+		++stats->islandCount;
+		if (count < SOLVER_COLORING_MIN_CONSTRAINTS)
+		{
+			islandOffsets[root] = smallOffset;
+			smallOffset += count;
+		}
+		else
+		{
+			++stats->coloredIslandCount;
+			islandOffsets[root] = largeOffset;
+			largeOffset += count;
+		}
+	}
+	u32 *order = ALLOC_N(FrameAllocator, u32, constraintCount);
+	for (u32 constraintIdx = 0; constraintIdx < constraintCount; ++constraintIdx)
+		order[islandOffsets[constraintRoots[constraintIdx]]++] = constraintIdx;
 
-		for (int hitIdx = 0; hitIdx < collision->hitCount; ++hitIdx)
+	// Small islands. Jobs are cut at island boundaries, same walk as the layout above.
+	DynamicArray<u32, FrameAllocator> jobEnds;
+	DynamicArrayInit(&jobEnds, 32);
+	{
+		u32 jobBegin = 0;
+		u32 offset = 0;
+		for (u32 root = 0; root < rigidBodyCount; ++root)
+		{
+			u32 count = islandCounts[root];
+			if (!count || count >= SOLVER_COLORING_MIN_CONSTRAINTS)
+				continue;
+			offset += count;
+			if (offset - jobBegin >= SOLVER_CONSTRAINTS_PER_JOB)
+			{
+				*DynamicArrayAdd(&jobEnds) = offset;
+				jobBegin = offset;
+			}
+		}
+		if (offset > jobBegin)
+			*DynamicArrayAdd(&jobEnds) = offset;
+	}
+	ParallelFor(g_jobSystem, (u32)jobEnds.count, 1,
+			[motion, constraints, order, &jobEnds, settings](u32 beginIdx, u32 endIdx)
+	{
+		for (u32 jobIdx = beginIdx; jobIdx < endIdx; ++jobIdx)
 		{
-			v3 hit = collision->hitPoints[hitIdx];
-			v3 hitNormal = collision->hitNormal;
-			v3 rA = hit - transformA->translation;
-			v3 rB = hit - transformB->translation;
+			u32 begin = jobIdx ? jobEnds[jobIdx - 1] : 0;
+			SolveContactRange(motion, constraints, &order[begin], jobEnds[jobIdx] - begin, settings);
+		}
+	});
 
-			v3 angVelAtHitPointA = V3Cross(rigidBodyA->angularVelocity, rA);
-			v3 velAtHitPointA = rigidBodyA->velocity + angVelAtHitPointA;
+	// Large islands. Greedy coloring, each constraint takes the first color neither of its bodies
+	// is in yet. What doesn't fit in SOLVER_MAX_COLORS is solved on one thread after the rest.
+	const u32 largeConstraintCount = constraintCount - smallConstraintCount;
+	if (largeConstraintCount)
+	{
+		const u32 *largeOrder = &order[smallConstraintCount];
+		u64 *bodyColors = ALLOC_N(FrameAllocator, u64, rigidBodyCount);
+		memset(bodyColors, 0, sizeof(u64) * rigidBodyCount);
+		u8 *constraintColors = ALLOC_N(FrameAllocator, u8, largeConstraintCount);
+		u32 colorCounts[SOLVER_MAX_COLORS + 1] = {};
+		for (u32 i = 0; i < largeConstraintCount; ++i)
+		{
+			const ContactConstraint *constraint = &constraints[largeOrder[i]];
+			u32 bodyA = U32_MAX;
+			u32 bodyB = U32_MAX;
+			u64 usedColors = 0;
+			if (constraint->rigidBodyIdxA != RIGID_BODY_STATIC_IDX)
+			{
+				bodyA = constraint->rigidBodyIdxA;
+				usedColors |= bodyColors[bodyA];
+			}
+			if (constraint->rigidBodyIdxB != RIGID_BODY_STATIC_IDX)
+			{
+				bodyB = constraint->rigidBodyIdxB;
+				usedColors |= bodyColors[bodyB];
+			}
 
-			v3 angVelAtHitPointB = V3Cross(rigidBodyB->angularVelocity, rB);
-			v3 velAtHitPointB = rigidBodyB->velocity + angVelAtHitPointB;
+			u32 color = SOLVER_MAX_COLORS;
+			if (~usedColors)
+			{
+				color = Ntz64(~usedColors);
+				if (bodyA != U32_MAX) bodyColors[bodyA] |= 1ull << color;
+				if (bodyB != U32_MAX) bodyColors[bodyB] |= 1ull << color;
+			}
+			constraintColors[i] = (u8)color;
+			++colorCounts[color];
+		}
 
-			v3 relVelAtHitPoint = velAtHitPointA - velAtHitPointB;
+		u32 colorOffsets[SOLVER_MAX_COLORS + 2];
+		colorOffsets[0] = 0;
+		for (u32 color = 0; color <= SOLVER_MAX_COLORS; ++color)
+		{
+			colorOffsets[color + 1] = colorOffsets[color] + colorCounts[color];
+			if (color < SOLVER_MAX_COLORS && colorCounts[color])
+				++stats->colorCount;
+		}
+		stats->uncoloredConstraintCount = colorCounts[SOLVER_MAX_COLORS];
 
-			f32 speedAlongHitNormal = V3Dot(relVelAtHitPoint, hitNormal);
-			if (speedAlongHitNormal > 0)
-				continue;
+		u32 *colorOrder = ALLOC_N(FrameAllocator, u32, largeConstraintCount);
+		{
+			u32 fill[SOLVER_MAX_COLORS + 1];
+			memcpy(fill, colorOffsets, sizeof(fill));
+			for (u32 i = 0; i < largeConstraintCount; ++i)
+				colorOrder[fill[constraintColors[i]]++] = largeOrder[i];
+		}
 
-			f32 restitution = Min(rigidBodyA->restitution, rigidBodyB->restitution);
+		// Calls fn on every constraint, a color at a time.
+		auto forEachColor = [constraints, colorOrder, &colorOffsets](auto fn)
+		{
+			for (u32 color = 0; color < SOLVER_MAX_COLORS; ++color)
+			{
+				const u32 begin = colorOffsets[color];
+				ParallelFor(g_jobSystem, colorOffsets[color + 1] - begin, SOLVER_CONSTRAINTS_PER_JOB,
+						[constraints, colorOrder, begin, &fn](u32 beginIdx, u32 endIdx)
+				{
+					for (u32 i = beginIdx; i < endIdx; ++i)
+						fn(&constraints[colorOrder[begin + i]]);
+				});
+			}
+			for (u32 i = colorOffsets[SOLVER_MAX_COLORS]; i < colorOffsets[SOLVER_MAX_COLORS + 1]; ++i)
+				fn(&constraints[colorOrder[i]]);
+		};
 
-			// Impulse scalar
-			f32 impulseScalar = -(1.0f + restitution) * speedAlongHitNormal;
+		forEachColor([motion, settings](ContactConstraint *constraint)
+		{
+			WarmStartContactConstraint(motion, constraint, settings->enableFriction);
+		});
+		for (int iteration = 0; iteration < settings->iterations; ++iteration)
+		{
+			forEachColor([motion, settings](ContactConstraint *constraint)
 			{
-				v3 armCrossNormalA = V3Cross(rA, hitNormal);
-				v3 armCrossNormalB = V3Cross(rB, hitNormal);
-
-				impulseScalar /= rigidBodyA->invMass + rigidBodyB->invMass + V3Dot(
-					V3Cross(Mat3TransformVector(rigidBodyA->worldInvMomentOfInertiaTensor,
-						armCrossNormalA), rA) +
-					V3Cross(Mat3TransformVector(rigidBodyB->worldInvMomentOfInertiaTensor,
-						armCrossNormalB), rB), hitNormal);
+				SolveContactVelocities(motion, constraint, settings->enableFriction);
+			});
+		}
+		if (settings->enablePositionCorrection)
+		{
+			for (int iteration = 0; iteration < settings->iterations; ++iteration)
+			{
+				forEachColor([motion, settings](ContactConstraint *constraint)
+				{
+					SolveContactPositions(motion, constraint, settings->deltaTime);
+				});
 			}
-			ASSERT(impulseScalar >= 0);
-			v3 impulseVector = hitNormal * impulseScalar;
+		}
+	}
 
-#if DEBUG_BUILD
-			DrawDebugArrow(hit, hit + impulseVector * 10.0f, {1,0,1});
-#endif
+	stats->lastStepTime = (f32)(PlatformGetPerformanceCounter() - startCounter) /
+		(f32)PlatformGetPerformanceFrequency();
+}
 
-			// Store normal impulse scalar to calculate friction
-			collision->normalImpulseMags[hitIdx] = impulseScalar;
+ColliderSweep GetColliderSweep(GameState *gameState, EntityHandle handle)
+{
+	ColliderSweep sweep;
+	sweep.end = *GetEntityTransform(gameState, handle);
+	sweep.start = sweep.end;
+	const RigidBody *rigidBody = GetEntityRigidBody(gameState, handle);
+	if (rigidBody)
+	{
+		sweep.start.translation = rigidBody->previousTranslation;
+		sweep.start.rotation = rigidBody->previousRotation;
+	}
+	return sweep;
+}
 
-			v3 force = impulseVector / deltaTime;
+// Runs after integration. Bodies with continuous collision that moved far this step are swept
+// against everything their stretched AABB paired up with, and moved back to their first impact.
+// Their velocity is left alone, the contact solver deals with it next step.
+void SolveContinuousCollisions(GameState *gameState, ArrayView<const BroadphasePair> pairs)
+{
+	ContinuousCollisionStats *stats = &gameState->continuousCollisionStats;
+	*stats = {};
 
-			rigidBodyA->totalForce += force;
-			rigidBodyB->totalForce -= force;
+	const u32 rigidBodyCount = gameState->rigidBodies.count;
+	bool *sweptBodies = ALLOC_N(FrameAllocator, bool, rigidBodyCount);
+	f32 *stopTimes = ALLOC_N(FrameAllocator, f32, rigidBodyCount);
+	for (u32 rigidBodyIdx = 0; rigidBodyIdx < rigidBodyCount; ++rigidBodyIdx)
+	{
+		const RigidBody *rigidBody = &gameState->rigidBodies[rigidBodyIdx];
+		sweptBodies[rigidBodyIdx] = false;
+		stopTimes[rigidBodyIdx] = 1.0f;
+		if (!rigidBody->continuousCollision || rigidBody->sleeping)
+			continue;
 
-			v3 torque;
-			torque = V3Cross(rA, impulseVector) / deltaTime;
-			rigidBodyA->totalTorque += torque;
-			torque = V3Cross(rB, impulseVector) / deltaTime;
-			rigidBodyB->totalTorque -= torque;
+		Collider *collider = GetEntityCollider(gameState, rigidBody->entityHandle);
+		if (!collider)
+			continue;
+		Transform identity = {};
+		v3 min, max;
+		GetAABB(&identity, collider, &min, &max);
+		f32 size = Min(Min(max.x - min.x, max.y - min.y), max.z - min.z);
+
+		ColliderSweep sweep = GetColliderSweep(gameState, rigidBody->entityHandle);
+		f32 cosHalfAngle = Min(Abs(V4Dot(sweep.start.rotation, sweep.end.rotation)), 1.0f);
+		f32 motion = V3Length(sweep.end.translation - sweep.start.translation) +
+			2.0f * Acos(cosHalfAngle) * ColliderBoundingRadius(collider);
+		if (motion > size * CCD_MOTION_THRESHOLD)
+		{
+			sweptBodies[rigidBodyIdx] = true;
+			++stats->sweptBodyCount;
 		}
 	}
+	if (!stats->sweptBodyCount)
+		return;
 
-	for (u32 rigidBodyIdx = 0; rigidBodyIdx < gameState->rigidBodies.count; ++rigidBodyIdx)
+	for (u32 pairIdx = 0; pairIdx < pairs.count; ++pairIdx)
 	{
-		RigidBody *rigidBody = &gameState->rigidBodies[rigidBodyIdx];
+		BroadphasePair pair = pairs[pairIdx];
+		Collider *colliderA = &gameState->colliders[pair.colliderA];
+		Collider *colliderB = &gameState->colliders[pair.colliderB];
+		const RigidBody *rigidBodyA = GetEntityRigidBody(gameState, colliderA->entityHandle);
+		const RigidBody *rigidBodyB = GetEntityRigidBody(gameState, colliderB->entityHandle);
+		const u32 idxA = rigidBodyA ? RigidBodyIndex(gameState, rigidBodyA) : U32_MAX;
+		const u32 idxB = rigidBodyB ? RigidBodyIndex(gameState, rigidBodyB) : U32_MAX;
+		const bool sweptA = idxA != U32_MAX && sweptBodies[idxA];
+		const bool sweptB = idxB != U32_MAX && sweptBodies[idxB];
+		if (!sweptA && !sweptB)
+			continue;
 
-		rigidBody->velocity += rigidBody->totalForce * rigidBody->invMass * deltaTime;
+		ColliderSweep sweepA = GetColliderSweep(gameState, colliderA->entityHandle);
+		ColliderSweep sweepB = GetColliderSweep(gameState, colliderB->entityHandle);
+		TimeOfImpactResult toi = TimeOfImpact(colliderA, colliderB, &sweepA, &sweepB,
+				CCD_TARGET_DISTANCE);
+		++stats->sweptPairCount;
+		stats->iterationCount += toi.iterations;
+		// Already touching at the start, that's a regular contact.
+		if (!toi.hit || toi.iterations == 0)
+			continue;
 
-		v3 angularAcceleration = Mat3TransformVector(rigidBody->worldInvMomentOfInertiaTensor,
-				rigidBody->totalTorque);
-		rigidBody->angularVelocity += angularAcceleration * deltaTime;
+		f32 stopTime = toi.t;
+		if (toi.linearClosingSpeed > 0)
+			stopTime = Min(1.0f, stopTime +
+					(CCD_TARGET_DISTANCE + CCD_PENETRATION) / toi.linearClosingSpeed);
+		if (sweptA)
+			stopTimes[idxA] = Min(stopTimes[idxA], stopTime);
+		if (sweptB)
+			stopTimes[idxB] = Min(stopTimes[idxB], stopTime);
+	}
 
-		rigidBody->totalForce = { 0, 0, 0 };
-		rigidBody->totalTorque = { 0, 0, 0 };
+	for (u32 rigidBodyIdx = 0; rigidBodyIdx < rigidBodyCount; ++rigidBodyIdx)
+	{
+		if (stopTimes[rigidBodyIdx] >= 1.0f)
+			continue;
+		EntityHandle handle = gameState->rigidBodies[rigidBodyIdx].entityHandle;
+		ColliderSweep sweep = GetColliderSweep(gameState, handle);
+		Transform stop = ColliderSweepAt(&sweep, stopTimes[rigidBodyIdx]);
+		Transform *transform = GetEntityTransform(gameState, handle);
+		transform->translation = stop.translation;
+		transform->rotation = stop.rotation;
+		++stats->clampedBodyCount;
 	}
+}
 
-	// Friction impulse
-#if DEBUG_BUILD
-	if (!g_debugContext->disableFriction)
-#endif
+// FNV-1a over the transforms of all entities and the velocities of their rigid bodies, by entity
+// id so it doesn't depend on the order of the component arrays. Bit exact, meant for telling
+// whether two runs diverged and when.
+u64 PhysicsChecksum(GameState *gameState)
+{
+	u64 checksum = 14695981039346656037ull;
+	auto hashBytes = [&checksum](const void *data, u64 size)
 	{
-		for (u32 collisionIdx = 0; collisionIdx < collisions.count; ++collisionIdx)
-		{
-			const Collision* collision = &collisions[collisionIdx];
+		const u8 *bytes = (const u8 *)data;
+		for (u64 byteIdx = 0; byteIdx < size; ++byteIdx)
+			checksum = (checksum ^ bytes[byteIdx]) * 1099511628211ull;
+	};
+
+	for (u32 entityId = 0; entityId < MAX_ENTITIES; ++entityId)
+	{
+		u32 transformIdx = gameState->entityTransforms[entityId];
+		if (transformIdx == ENTITY_ID_INVALID)
+			continue;
+		hashBytes(&entityId, sizeof(entityId));
+		const Transform *transform = &gameState->transforms[transformIdx];
+		hashBytes(&transform->translation, sizeof(transform->translation));
+		hashBytes(&transform->rotation, sizeof(transform->rotation));
+		hashBytes(&transform->scale, sizeof(transform->scale));
+
+		u32 rigidBodyIdx = gameState->entityRigidBodies[entityId];
+		if (rigidBodyIdx == ENTITY_ID_INVALID)
+			continue;
+		v3 velocity = V3SoAGet(&gameState->rigidBodyMotion.velocity, rigidBodyIdx);
+		v3 angularVelocity = V3SoAGet(&gameState->rigidBodyMotion.angularVelocity, rigidBodyIdx);
+		hashBytes(&velocity, sizeof(velocity));
+		hashBytes(&angularVelocity, sizeof(angularVelocity));
+	}
+	return checksum;
+}
 
-			RigidBody *rigidBodyA = GetEntityRigidBody(gameState, collision->entityA);
-			RigidBody *rigidBodyB = GetEntityRigidBody(gameState, collision->entityB);
-			bool hasRigidBodyA = rigidBodyA != nullptr;
-			bool hasRigidBodyB = rigidBodyB != nullptr;
+// Where to draw an entity. Rigid bodies are blended from where they were before the last physics
+// step to where they are now, so they move smoothly whatever the step rate.
+Transform GetEntityRenderTransform(GameState *gameState, EntityHandle handle)
+{
+	Transform result = *GetEntityTransform(gameState, handle);
+	const RigidBody *rigidBody = GetEntityRigidBody(gameState, handle);
+	if (!rigidBody)
+		return result;
+
+	const f32 t = gameState->physicsInterpolationAlpha;
+	result.translation = rigidBody->previousTranslation * (1.0f - t) + result.translation * t;
+	result.rotation = QuaternionNlerp(rigidBody->previousRotation, result.rotation, t);
+	return result;
+}
 
-			if (!hasRigidBodyA && !hasRigidBodyB)
+const f32 RIGID_BODY_DRAG = 0.01f;
+const f32 RIGID_BODY_ANGULAR_DRAG = 0.06f;
+
+// Integrates position and orientation from velocity plus pseudo velocity, resets the pseudo
+// velocities and applies drag, eight rigid bodies at a time. Velocities are updated in place in
+// motion. Poses are gathered straight from transforms and written back to them: transformIndices
+// has the transform of each rigid body, or ENTITY_ID_INVALID for those to leave alone, and is
+// padded to a multiple of 8 with ENTITY_ID_INVALID.
+// Orientation takes the first order step q += dt/2 * (w, 0) * q and is renormalized, which is what
+// the scalar axis-angle step converges to for small angles.
+void IntegrateRigidBodiesAVX2(RigidBodyMotion *motion, Transform *transforms,
+		const u32 *transformIndices, u32 rigidBodyCount, f32 deltaTime)
+{
+	ASSERTC(sizeof(Transform) % sizeof(f32) == 0);
+	const __m256i transformStride = _mm256_set1_epi32((int)(sizeof(Transform) / sizeof(f32)));
+	const __m256i translationOffset = _mm256_set1_epi32((int)(offsetof(Transform, translation) /
+				sizeof(f32)));
+	const __m256i rotationOffset = _mm256_set1_epi32((int)(offsetof(Transform, rotation) /
+				sizeof(f32)));
+	const __m256i yOffset = _mm256_set1_epi32(1);
+	const __m256i zOffset = _mm256_set1_epi32(2);
+	const __m256i wOffset = _mm256_set1_epi32(3);
+	const __m256i invalid = _mm256_set1_epi32((int)ENTITY_ID_INVALID);
+	const f32 *transformFloats = (const f32 *)transforms;
+
+	const __m256 dt = _mm256_set1_ps(deltaTime);
+	const __m256 halfDt = _mm256_set1_ps(deltaTime * 0.5f);
+	const __m256 linearDamping = _mm256_set1_ps(1.0f - deltaTime * RIGID_BODY_DRAG);
+	const __m256 angularDamping = _mm256_set1_ps(1.0f - deltaTime * RIGID_BODY_ANGULAR_DRAG);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+
+	for (u32 groupIdx = 0; groupIdx < rigidBodyCount; groupIdx += 8)
+	{
+		__m256i indices = _mm256_loadu_si256((const __m256i *)&transformIndices[groupIdx]);
+		__m256i awakeMask = _mm256_xor_si256(_mm256_cmpeq_epi32(indices, invalid),
+				_mm256_set1_epi32(-1));
+		if (_mm256_testz_si256(awakeMask, awakeMask))
+			continue;
+		__m256 awake = _mm256_castsi256_ps(awakeMask);
+		// In floats from the start of transforms, lanes left alone read nothing.
+		__m256i base = _mm256_and_si256(_mm256_mullo_epi32(indices, transformStride), awakeMask);
+		__m256i translationIdx = _mm256_add_epi32(base, translationOffset);
+		__m256i rotationIdx = _mm256_add_epi32(base, rotationOffset);
+
+		__m256 vx = _mm256_load_ps(&motion->velocity.x[groupIdx]);
+		__m256 vy = _mm256_load_ps(&motion->velocity.y[groupIdx]);
+		__m256 vz = _mm256_load_ps(&motion->velocity.z[groupIdx]);
+		__m256 wx = _mm256_load_ps(&motion->angularVelocity.x[groupIdx]);
+		__m256 wy = _mm256_load_ps(&motion->angularVelocity.y[groupIdx]);
+		__m256 wz = _mm256_load_ps(&motion->angularVelocity.z[groupIdx]);
+		__m256 pvx = _mm256_load_ps(&motion->pseudoVelocity.x[groupIdx]);
+		__m256 pvy = _mm256_load_ps(&motion->pseudoVelocity.y[groupIdx]);
+		__m256 pvz = _mm256_load_ps(&motion->pseudoVelocity.z[groupIdx]);
+		__m256 pwx = _mm256_load_ps(&motion->pseudoAngularVelocity.x[groupIdx]);
+		__m256 pwy = _mm256_load_ps(&motion->pseudoAngularVelocity.y[groupIdx]);
+		__m256 pwz = _mm256_load_ps(&motion->pseudoAngularVelocity.z[groupIdx]);
+
+		// Position
+		__m256 px = _mm256_mask_i32gather_ps(zero, transformFloats, translationIdx, awake, 4);
+		__m256 py = _mm256_mask_i32gather_ps(zero, transformFloats,
+				_mm256_add_epi32(translationIdx, yOffset), awake, 4);
+		__m256 pz = _mm256_mask_i32gather_ps(zero, transformFloats,
+				_mm256_add_epi32(translationIdx, zOffset), awake, 4);
+		px = _mm256_add_ps(px, _mm256_mul_ps(_mm256_add_ps(vx, pvx), dt));
+		py = _mm256_add_ps(py, _mm256_mul_ps(_mm256_add_ps(vy, pvy), dt));
+		pz = _mm256_add_ps(pz, _mm256_mul_ps(_mm256_add_ps(vz, pvz), dt));
+
+		// Orientation
+		__m256 spinX = _mm256_add_ps(wx, pwx);
+		__m256 spinY = _mm256_add_ps(wy, pwy);
+		__m256 spinZ = _mm256_add_ps(wz, pwz);
+		__m256 qx = _mm256_mask_i32gather_ps(zero, transformFloats, rotationIdx, awake, 4);
+		__m256 qy = _mm256_mask_i32gather_ps(zero, transformFloats,
+				_mm256_add_epi32(rotationIdx, yOffset), awake, 4);
+		__m256 qz = _mm256_mask_i32gather_ps(zero, transformFloats,
+				_mm256_add_epi32(rotationIdx, zOffset), awake, 4);
+		__m256 qw = _mm256_mask_i32gather_ps(one, transformFloats,
+				_mm256_add_epi32(rotationIdx, wOffset), awake, 4);
+
+		__m256 dqx = _mm256_add_ps(_mm256_mul_ps(spinX, qw),
+				_mm256_sub_ps(_mm256_mul_ps(spinY, qz), _mm256_mul_ps(spinZ, qy)));
+		__m256 dqy = _mm256_add_ps(_mm256_mul_ps(spinY, qw),
+				_mm256_sub_ps(_mm256_mul_ps(spinZ, qx), _mm256_mul_ps(spinX, qz)));
+		__m256 dqz = _mm256_add_ps(_mm256_mul_ps(spinZ, qw),
+				_mm256_sub_ps(_mm256_mul_ps(spinX, qy), _mm256_mul_ps(spinY, qx)));
+		__m256 dqw = _mm256_add_ps(_mm256_mul_ps(spinX, qx),
+				_mm256_add_ps(_mm256_mul_ps(spinY, qy), _mm256_mul_ps(spinZ, qz)));
+		qx = _mm256_add_ps(qx, _mm256_mul_ps(dqx, halfDt));
+		qy = _mm256_add_ps(qy, _mm256_mul_ps(dqy, halfDt));
+		qz = _mm256_add_ps(qz, _mm256_mul_ps(dqz, halfDt));
+		qw = _mm256_sub_ps(qw, _mm256_mul_ps(dqw, halfDt));
+
+		__m256 sqrLen = _mm256_add_ps(_mm256_mul_ps(qx, qx), _mm256_add_ps(_mm256_mul_ps(qy, qy),
+					_mm256_add_ps(_mm256_mul_ps(qz, qz), _mm256_mul_ps(qw, qw))));
+		__m256 invLen = _mm256_div_ps(one, _mm256_sqrt_ps(sqrLen));
+		qx = _mm256_mul_ps(qx, invLen);
+		qy = _mm256_mul_ps(qy, invLen);
+		qz = _mm256_mul_ps(qz, invLen);
+		qw = _mm256_mul_ps(qw, invLen);
+
+		// Drag. Bodies left alone keep their velocities, pseudo ones only last a step.
+		_mm256_store_ps(&motion->velocity.x[groupIdx],
+				_mm256_blendv_ps(vx, _mm256_mul_ps(vx, linearDamping), awake));
+		_mm256_store_ps(&motion->velocity.y[groupIdx],
+				_mm256_blendv_ps(vy, _mm256_mul_ps(vy, linearDamping), awake));
+		_mm256_store_ps(&motion->velocity.z[groupIdx],
+				_mm256_blendv_ps(vz, _mm256_mul_ps(vz, linearDamping), awake));
+		_mm256_store_ps(&motion->angularVelocity.x[groupIdx],
+				_mm256_blendv_ps(wx, _mm256_mul_ps(wx, angularDamping), awake));
+		_mm256_store_ps(&motion->angularVelocity.y[groupIdx],
+				_mm256_blendv_ps(wy, _mm256_mul_ps(wy, angularDamping), awake));
+		_mm256_store_ps(&motion->angularVelocity.z[groupIdx],
+				_mm256_blendv_ps(wz, _mm256_mul_ps(wz, angularDamping), awake));
+		_mm256_store_ps(&motion->pseudoVelocity.x[groupIdx], _mm256_andnot_ps(awake, pvx));
+		_mm256_store_ps(&motion->pseudoVelocity.y[groupIdx], _mm256_andnot_ps(awake, pvy));
+		_mm256_store_ps(&motion->pseudoVelocity.z[groupIdx], _mm256_andnot_ps(awake, pvz));
+		_mm256_store_ps(&motion->pseudoAngularVelocity.x[groupIdx], _mm256_andnot_ps(awake, pwx));
+		_mm256_store_ps(&motion->pseudoAngularVelocity.y[groupIdx], _mm256_andnot_ps(awake, pwy));
+		_mm256_store_ps(&motion->pseudoAngularVelocity.z[groupIdx], _mm256_andnot_ps(awake, pwz));
+
+		// No scatter in AVX2, poses go back a lane at a time.
+		alignas(32) f32 pose[7][8];
+		_mm256_store_ps(pose[0], px);
+		_mm256_store_ps(pose[1], py);
+		_mm256_store_ps(pose[2], pz);
+		_mm256_store_ps(pose[3], qx);
+		_mm256_store_ps(pose[4], qy);
+		_mm256_store_ps(pose[5], qz);
+		_mm256_store_ps(pose[6], qw);
+		const u32 *groupIndices = &transformIndices[groupIdx];
+		for (int lane = 0; lane < 8; ++lane)
+		{
+			if (groupIndices[lane] == ENTITY_ID_INVALID)
 				continue;
+			Transform *transform = &transforms[groupIndices[lane]];
+			transform->translation = { pose[0][lane], pose[1][lane], pose[2][lane] };
+			transform->rotation = { pose[3][lane], pose[4][lane], pose[5][lane], pose[6][lane] };
+		}
+	}
+}
 
-			if (!rigidBodyA) rigidBodyA = &RIGID_BODY_STATIC;
-			if (!rigidBodyB) rigidBodyB = &RIGID_BODY_STATIC;
-
-			Transform *transformA = GetEntityTransform(gameState, collision->entityA);
-			Transform *transformB = GetEntityTransform(gameState, collision->entityB);
+// Transform of every awake rigid body for IntegrateRigidBodiesAVX2, ENTITY_ID_INVALID for sleeping
+// ones and the padding.
+u32 *GetRigidBodyTransformIndices(GameState *gameState)
+{
+	const u32 rigidBodyCount = gameState->rigidBodies.count;
+	const u32 paddedCount = (rigidBodyCount + 7) & ~7;
+	u32 *transformIndices = ALLOC_N(FrameAllocator, u32, paddedCount);
+	for (u32 rigidBodyIdx = 0; rigidBodyIdx < rigidBodyCount; ++rigidBodyIdx)
+	{
+		const RigidBody *rigidBody = &gameState->rigidBodies[rigidBodyIdx];
+		transformIndices[rigidBodyIdx] = rigidBody->sleeping ? ENTITY_ID_INVALID :
+			gameState->entityTransforms[rigidBody->entityHandle.id];
+	}
+	for (u32 rigidBodyIdx = rigidBodyCount; rigidBodyIdx < paddedCount; ++rigidBodyIdx)
+		transformIndices[rigidBodyIdx] = ENTITY_ID_INVALID;
+	return transformIndices;
+}
 
-			v3 hitNormal = collision->hitNormal;
+void SimulatePhysics(GameState *gameState, f32 deltaTime)
+{
+#if DEBUG_BUILD
+	if (g_debugContext->disableSleeping)
+	{
+		for (u32 rigidBodyIdx = 0; rigidBodyIdx < gameState->rigidBodies.count; ++rigidBodyIdx)
+			gameState->rigidBodies[rigidBodyIdx].sleeping = false;
+	}
+#endif
 
-			for (int hitIdx = 0; hitIdx < collision->hitCount; ++hitIdx)
-			{
-				v3 hit = collision->hitPoints[hitIdx];
-				v3 rA = hit - transformA->translation;
-				v3 rB = hit - transformB->translation;
+	for (u32 rigidBodyIdx = 0; rigidBodyIdx < gameState->rigidBodies.count; ++rigidBodyIdx)
+	{
+		RigidBody *rigidBody = &gameState->rigidBodies[rigidBodyIdx];
+		const Transform *transform = GetEntityTransform(gameState, rigidBody->entityHandle);
+		rigidBody->previousTranslation = transform->translation;
+		rigidBody->previousRotation = transform->rotation;
+	}
 
-				v3 angVelAtHitPointA = V3Cross(rigidBodyA->angularVelocity, rA);
-				v3 velAtHitPointA = rigidBodyA->velocity + angVelAtHitPointA;
+	AABBSoA AABBs = BroadphaseComputeAABBs(gameState, deltaTime);
 
-				v3 angVelAtHitPointB = V3Cross(rigidBodyB->angularVelocity, rB);
-				v3 velAtHitPointB = rigidBodyB->velocity + angVelAtHitPointB;
+	DynamicArray<BroadphasePair, FrameAllocator> pairs = BroadphaseFindPairs(gameState, &AABBs);
 
-				v3 relVelAtHitPoint = velAtHitPointA - velAtHitPointB;
+	// Test for collisions
+	// Each chunk keeps its hits in pair order, so appending the chunks in order gives the same
+	// result no matter which thread ran what.
+	const u32 pairCount = (u32)pairs.count;
+	const u32 chunkCount = (pairCount + NARROWPHASE_PAIRS_PER_JOB - 1) / NARROWPHASE_PAIRS_PER_JOB;
+	NarrowphaseChunkResults *chunkResults =
+		ALLOC_N(FrameAllocator, NarrowphaseChunkResults, chunkCount);
+	// Written for every pair, hit or not.
+	GJKCache *gjkCaches = ALLOC_N(FrameAllocator, GJKCache, pairCount);
+	u32 *chunkGJKIterations = ALLOC_N(FrameAllocator, u32, chunkCount);
+	bool *analyticPairs = ALLOC_N(FrameAllocator, bool, pairCount);
+	// Pairs with a sleeping body and nothing awake aren't tested, their manifold is left as is.
+	bool *sleepingPairs = ALLOC_N(FrameAllocator, bool, pairCount);
+	ParallelFor(g_jobSystem, pairCount, NARROWPHASE_PAIRS_PER_JOB,
+			[gameState, &pairs, chunkResults, gjkCaches, chunkGJKIterations, analyticPairs,
+			sleepingPairs](u32 beginIdx, u32 endIdx)
+	{
+		const u32 chunkIdx = beginIdx / NARROWPHASE_PAIRS_PER_JOB;
+		NarrowphaseChunkResults *results = &chunkResults[chunkIdx];
+		DynamicArrayInit(results, 16);
+		u32 gjkIterations = 0;
+		for (u32 pairIdx = beginIdx; pairIdx < endIdx; ++pairIdx)
+		{
+			BroadphasePair pair = pairs[pairIdx];
+			Collider *colliderA = &gameState->colliders[pair.colliderA];
+			Collider *colliderB = &gameState->colliders[pair.colliderB];
+
+			const RigidBody *rigidBodyA = GetEntityRigidBody(gameState, colliderA->entityHandle);
+			const RigidBody *rigidBodyB = GetEntityRigidBody(gameState, colliderB->entityHandle);
+			sleepingPairs[pairIdx] = !IsRigidBodyAwake(rigidBodyA) && !IsRigidBodyAwake(rigidBodyB) &&
+				(rigidBodyA || rigidBodyB);
+			if (sleepingPairs[pairIdx])
+				continue;
 
-				f32 speedAlongHitNormal = V3Dot(relVelAtHitPoint, hitNormal);
+			Transform *transformA = GetEntityTransform(gameState, colliderA->entityHandle);
+			Transform *transformB = GetEntityTransform(gameState, colliderB->entityHandle);
 
-				v3 tangent = relVelAtHitPoint - hitNormal * speedAlongHitNormal;
-				f32 tangentSqrLen = V3SqrLen(tangent);
-				if (EqualWithEpsilon(tangentSqrLen, 0, 0.00001f))
-					continue;
-				tangent /= Sqrt(tangentSqrLen);
+			NarrowphaseResult result;
+			int pairGJKIterations;
+			result.collisionInfo = TestCollision(gameState, transformA, transformB, colliderA,
+					colliderB, &result.hitPointCache, &gjkCaches[pairIdx], &pairGJKIterations,
+					&analyticPairs[pairIdx]);
+			gjkIterations += pairGJKIterations;
+			if (result.collisionInfo.hitCount)
+			{
+				result.pairIdx = pairIdx;
+				*DynamicArrayAdd(results) = result;
+			}
+		}
+		chunkGJKIterations[chunkIdx] = gjkIterations;
+	});
+
+	const u32 step = ++gameState->physicsStepCount;
+	NarrowphaseStats *narrowphaseStats = &gameState->narrowphaseStats;
+	narrowphaseStats->pairCount = 0;
+	narrowphaseStats->sleepingPairCount = 0;
+	narrowphaseStats->gjkIterationCount = 0;
+	memset(narrowphaseStats->analyticCounts, 0, sizeof(narrowphaseStats->analyticCounts));
+	for (u32 chunkIdx = 0; chunkIdx < chunkCount; ++chunkIdx)
+		narrowphaseStats->gjkIterationCount += chunkGJKIterations[chunkIdx];
+
+	for (u32 pairIdx = 0; pairIdx < pairCount; ++pairIdx)
+	{
+		BroadphasePair pair = pairs[pairIdx];
+		const Collider *colliderA = &gameState->colliders[pair.colliderA];
+		const Collider *colliderB = &gameState->colliders[pair.colliderB];
+		CollisionPair key = { colliderA->entityHandle, colliderB->entityHandle };
+		ContactManifold *manifold = HashMapGet(gameState->contactManifolds, key);
+		if (sleepingPairs[pairIdx])
+		{
+			// Keep the manifold, and its impulses for when the island wakes up, as they were.
+			++narrowphaseStats->sleepingPairCount;
+			if (manifold)
+			{
+				if (manifold->impulseStep == manifold->lastStep)
+					manifold->impulseStep = step;
+				manifold->lastStep = step;
+			}
+			continue;
+		}
 
-				f32 staticFriction  = (rigidBodyA->staticFriction  + rigidBodyB->staticFriction)  * 0.5f;
-				f32 dynamicFriction = (rigidBodyA->dynamicFriction + rigidBodyB->dynamicFriction) * 0.5f;
+		++narrowphaseStats->pairCount;
+		if (analyticPairs[pairIdx])
+			++narrowphaseStats->analyticCounts[colliderA->type][colliderB->type];
+		if (!manifold)
+		{
+			manifold = HashMapGetOrAdd(&gameState->contactManifolds, key);
+			*manifold = {};
+		}
+		manifold->gjkCache = gjkCaches[pairIdx];
+		manifold->lastStep = step;
+	}
 
-				// Impulse scalar
-				f32 impulseScalar = -V3Dot(relVelAtHitPoint, tangent);
-				{
-					v3 armCrossTangentA = V3Cross(rA, tangent);
-					v3 armCrossTangentB = V3Cross(rB, tangent);
+	for (u32 chunkIdx = 0; chunkIdx < chunkCount; ++chunkIdx)
+	{
+		NarrowphaseChunkResults *results = &chunkResults[chunkIdx];
+		for (u32 resultIdx = 0; resultIdx < results->count; ++resultIdx)
+		{
+			NarrowphaseResult *result = &(*results)[resultIdx];
+			BroadphasePair pair = pairs[result->pairIdx];
+			CollisionPair key = { gameState->colliders[pair.colliderA].entityHandle,
+				gameState->colliders[pair.colliderB].entityHandle };
+			HashMapGet(gameState->contactManifolds, key)->hitPoints = result->hitPointCache;
 
-					v3 crossA = V3Cross(Mat3TransformVector(rigidBodyA->worldInvMomentOfInertiaTensor,
-							armCrossTangentA), rA);
-					v3 crossB = V3Cross(Mat3TransformVector(rigidBodyB->worldInvMomentOfInertiaTensor,
-							armCrossTangentB), rB);
+#if DEBUG_BUILD
+			if (g_debugContext->pausePhysicsOnContact)
+				g_debugContext->pausePhysics = true;
+#endif
+		}
+	}
 
-					impulseScalar /= rigidBodyA->invMass + rigidBodyB->invMass +
-						V3Dot(crossA + crossB, tangent);
-				}
+	EvictStaleContactManifolds(gameState, step);
 
-				f32 normalImpulseMag = collision->normalImpulseMags[hitIdx];
-				ASSERT(normalImpulseMag >= 0);
-				v3 impulseVector;
-				if (Abs(impulseScalar) <= normalImpulseMag * staticFriction)
-				{
-					impulseVector = tangent * impulseScalar;
-					DEBUG_ONLY(DrawDebugArrow(hit, hit + impulseVector * 10.0f, {1,0,0}));
-				}
-				else
-				{
-					impulseVector = tangent * -normalImpulseMag * dynamicFriction;
-					DEBUG_ONLY(DrawDebugArrow(hit, hit + impulseVector * 10.0f, {0,1,0}));
-				}
+#if DEBUG_BUILD
+	if (g_debugContext->pausePhysics)
+		return;
+#endif
 
-				v3 force = impulseVector / deltaTime;
+	RigidBodyMotion *motion = &gameState->rigidBodyMotion;
+	for (u32 rigidBodyIdx = 0; rigidBodyIdx < gameState->rigidBodies.count; ++rigidBodyIdx)
+	{
+		RigidBody *rigidBody = &gameState->rigidBodies[rigidBodyIdx];
+		if (rigidBody->sleeping)
+			continue;
+		Transform *transform = GetEntityTransform(gameState, rigidBody->entityHandle);
+		ASSERT(transform); // There should never be an orphaned rigid body.
 
-				rigidBodyA->totalForce += force;
-				rigidBodyB->totalForce -= force;
+		// Gravity
+		motion->velocity.z[rigidBodyIdx] -= GRAVITY * deltaTime;
 
-				v3 torque;
-				torque = V3Cross(rA, impulseVector) / deltaTime;
-				rigidBodyA->totalTorque += torque;
-				torque = V3Cross(rB, impulseVector) / deltaTime;
-				rigidBodyB->totalTorque -= torque;
-			}
-		}
+		// Calculate world-space inverse moment of inertia tensors for each rigid body
+		mat3 R = Mat3FromQuaternion(transform->rotation);
+		mat3 noR = Mat3Transpose(R);
+		rigidBody->worldInvMomentOfInertiaTensor = Mat3Multiply(
+				Mat3Multiply(R, rigidBody->invMomentOfInertiaTensor), noR);
 	}
 
+	// Sleeping bodies touched by awake ones this step. They're woken at the end of it, and in the
+	// meantime act as static.
+	DynamicArray<EntityHandle, FrameAllocator> bodiesToWake;
+	DynamicArrayInit(&bodiesToWake, 16);
+
 	// Springs
 	for (u32 springIdx = 0; springIdx < gameState->springs.count; ++springIdx)
 	{
@@ -298,6 +1185,23 @@ void SimulatePhysics(GameState *gameState, f32 deltaTime)
 		if (!hasRigidBodyA && !hasRigidBodyB)
 			continue;
 
+		// Springs tie their bodies into one island, so they sleep and wake together. One only ends
+		// up asleep next to an awake one when just woken up by the API.
+		if (!IsRigidBodyAwake(rigidBodyA) && !IsRigidBodyAwake(rigidBodyB))
+			continue;
+		if (hasRigidBodyA && rigidBodyA->sleeping)
+		{
+			*DynamicArrayAdd(&bodiesToWake) = spring->entityA;
+			continue;
+		}
+		if (hasRigidBodyB && rigidBodyB->sleeping)
+		{
+			*DynamicArrayAdd(&bodiesToWake) = spring->entityB;
+			continue;
+		}
+
+		const u32 idxA = rigidBodyA ? RigidBodyIndex(gameState, rigidBodyA) : RIGID_BODY_STATIC_IDX;
+		const u32 idxB = rigidBodyB ? RigidBodyIndex(gameState, rigidBodyB) : RIGID_BODY_STATIC_IDX;
 		if (!rigidBodyA) rigidBodyA = &RIGID_BODY_STATIC;
 		if (!rigidBodyB) rigidBodyB = &RIGID_BODY_STATIC;
 
@@ -313,11 +1217,11 @@ void SimulatePhysics(GameState *gameState, f32 deltaTime)
 		f32 currentDistance = V3Length(ab);
 		v3 abDir = ab / currentDistance;
 
-		v3 angVelA = V3Cross(rigidBodyA->angularVelocity, rA);
-		v3 velA = rigidBodyA->velocity + angVelA;
+		v3 angVelA = V3Cross(V3SoAGet(&motion->angularVelocity, idxA), rA);
+		v3 velA = V3SoAGet(&motion->velocity, idxA) + angVelA;
 
-		v3 angVelB = V3Cross(rigidBodyB->angularVelocity, rB);
-		v3 velB = rigidBodyB->velocity + angVelB;
+		v3 angVelB = V3Cross(V3SoAGet(&motion->angularVelocity, idxB), rB);
+		v3 velB = V3SoAGet(&motion->velocity, idxB) + angVelB;
 
 		v3 relVel = velB - velA;
 		f32 relVelAlongSpring = V3Dot(relVel, abDir);
@@ -329,7 +1233,7 @@ void SimulatePhysics(GameState *gameState, f32 deltaTime)
 			v3 armCrossNormalA = V3Cross(rA, abDir);
 			v3 armCrossNormalB = V3Cross(rB, abDir);
 
-			impulseScalar /= rigidBodyA->invMass + rigidBodyB->invMass + V3Dot(
+			impulseScalar /= motion->invMass[idxA] + motion->invMass[idxB] + V3Dot(
 				V3Cross(Mat3TransformVector(rigidBodyA->worldInvMomentOfInertiaTensor,
 					armCrossNormalA), rA) +
 				V3Cross(Mat3TransformVector(rigidBodyB->worldInvMomentOfInertiaTensor,
@@ -353,70 +1257,111 @@ void SimulatePhysics(GameState *gameState, f32 deltaTime)
 		rigidBodyB->totalTorque -= torque;
 	}
 
-	// Depenetrate
-#if DEBUG_BUILD
-	if (!g_debugContext->disableDepenetration)
-#endif
+	// Integrate forces, so contacts see the springs' pull
+	for (u32 rigidBodyIdx = 0; rigidBodyIdx < gameState->rigidBodies.count; ++rigidBodyIdx)
 	{
-		for (u32 collisionIdx = 0; collisionIdx < collisions.count; ++collisionIdx)
-		{
-			const Collision* collision = &collisions[collisionIdx];
+		RigidBody *rigidBody = &gameState->rigidBodies[rigidBodyIdx];
+		if (rigidBody->sleeping)
+			continue;
 
-			RigidBody *rigidBodyA = GetEntityRigidBody(gameState, collision->entityA);
-			RigidBody *rigidBodyB = GetEntityRigidBody(gameState, collision->entityB);
-			if (!rigidBodyA) rigidBodyA = &RIGID_BODY_STATIC;
-			if (!rigidBodyB) rigidBodyB = &RIGID_BODY_STATIC;
+		V3SoASet(&motion->velocity, rigidBodyIdx, V3SoAGet(&motion->velocity, rigidBodyIdx) +
+				rigidBody->totalForce * motion->invMass[rigidBodyIdx] * deltaTime);
 
-			if (rigidBodyA->invMass + rigidBodyB->invMass == 0)
-				continue;
+		v3 angularAcceleration = Mat3TransformVector(rigidBody->worldInvMomentOfInertiaTensor,
+				rigidBody->totalTorque);
+		V3SoASet(&motion->angularVelocity, rigidBodyIdx,
+				V3SoAGet(&motion->angularVelocity, rigidBodyIdx) + angularAcceleration * deltaTime);
 
-			Transform *transformA = GetEntityTransform(gameState, collision->entityA);
-			Transform *transformB = GetEntityTransform(gameState, collision->entityB);
+		rigidBody->totalForce = { 0, 0, 0 };
+		rigidBody->totalTorque = { 0, 0, 0 };
+	}
 
-			const float factor = 0.8f;
-			const float slop = 0.001f;
+	// Contacts
+	DynamicArray<ContactConstraint, FrameAllocator> constraints;
+	DynamicArrayInit(&constraints, 32);
+	for (u32 chunkIdx = 0; chunkIdx < chunkCount; ++chunkIdx)
+	{
+		NarrowphaseChunkResults *results = &chunkResults[chunkIdx];
+		for (u32 resultIdx = 0; resultIdx < results->count; ++resultIdx)
+		{
+			NarrowphaseResult *result = &(*results)[resultIdx];
+			BroadphasePair pair = pairs[result->pairIdx];
+			EntityHandle entityA = gameState->colliders[pair.colliderA].entityHandle;
+			EntityHandle entityB = gameState->colliders[pair.colliderB].entityHandle;
+
+			RigidBody *rigidBodyA = GetEntityRigidBody(gameState, entityA);
+			RigidBody *rigidBodyB = GetEntityRigidBody(gameState, entityB);
+			if (!rigidBodyA && !rigidBodyB)
+				continue;
 
-			v3 correction = collision->hitNormal * factor * Max(0.0f, collision->depth - slop);
-			correction /= rigidBodyA->invMass + rigidBodyB->invMass;
+			// Pairs with nothing awake were never tested, so the other one is awake here.
+			if (rigidBodyA && rigidBodyA->sleeping)
+			{
+				*DynamicArrayAdd(&bodiesToWake) = entityA;
+				rigidBodyA = nullptr;
+			}
+			if (rigidBodyB && rigidBodyB->sleeping)
+			{
+				*DynamicArrayAdd(&bodiesToWake) = entityB;
+				rigidBodyB = nullptr;
+			}
 
-			transformA->translation += correction * rigidBodyA->invMass;
-			transformB->translation -= correction * rigidBodyB->invMass;
+			ContactConstraint *constraint = DynamicArrayAdd(&constraints);
+			constraint->rigidBodyA = rigidBodyA ? rigidBodyA : &RIGID_BODY_STATIC;
+			constraint->rigidBodyB = rigidBodyB ? rigidBodyB : &RIGID_BODY_STATIC;
+			constraint->rigidBodyIdxA = rigidBodyA ? RigidBodyIndex(gameState, rigidBodyA) :
+				RIGID_BODY_STATIC_IDX;
+			constraint->rigidBodyIdxB = rigidBodyB ? RigidBodyIndex(gameState, rigidBodyB) :
+				RIGID_BODY_STATIC_IDX;
+			constraint->key = { entityA, entityB };
+			PrepareContactConstraint(gameState, constraint, &result->collisionInfo, step);
 		}
 	}
 
-	for (u32 rigidBodyIdx = 0; rigidBodyIdx < gameState->rigidBodies.count; ++rigidBodyIdx)
-	{
-		RigidBody *rigidBody = &gameState->rigidBodies[rigidBodyIdx];
-		Transform *transform = GetEntityTransform(gameState, rigidBody->entityHandle);
-
-		// Integrate velocities
-		rigidBody->velocity += rigidBody->totalForce * rigidBody->invMass * deltaTime;
-
-		v3 angularAcceleration = Mat3TransformVector(rigidBody->worldInvMomentOfInertiaTensor,
-				rigidBody->totalTorque);
-		rigidBody->angularVelocity += angularAcceleration * deltaTime;
+	u32 *islandParents = BuildIslands(gameState, constraints.data, (u32)constraints.count);
 
-		// Integrate position and orientation
-		transform->translation += rigidBody->velocity * deltaTime;
+	SolverSettings solverSettings;
+	solverSettings.iterations = gameState->solverIterations;
+	solverSettings.enableFriction = true;
+	solverSettings.enablePositionCorrection = true;
+	solverSettings.deltaTime = deltaTime;
+#if DEBUG_BUILD
+	solverSettings.enableFriction = !g_debugContext->disableFriction;
+	solverSettings.enablePositionCorrection = !g_debugContext->disableDepenetration;
+#endif
+	SolveContactConstraints(gameState, constraints.data, (u32)constraints.count, islandParents,
+			&solverSettings);
 
-		v3 deltaRot = rigidBody->angularVelocity * deltaTime;
-		if (deltaRot.x || deltaRot.y || deltaRot.z)
+	for (u32 constraintIdx = 0; constraintIdx < constraints.count; ++constraintIdx)
+	{
+		const ContactConstraint *constraint = &constraints[constraintIdx];
+		StoreContactImpulses(gameState, constraint, step);
+#if DEBUG_BUILD
+		Transform *transformA = GetEntityTransform(gameState, constraint->key.a);
+		for (int pointIdx = 0; pointIdx < constraint->pointCount; ++pointIdx)
 		{
-			f32 angle = V3Length(deltaRot);
-			transform->rotation = QuaternionMultiply(
-					QuaternionFromAxisAngle(deltaRot / angle, angle),
-					transform->rotation);
-			transform->rotation = V4Normalize(transform->rotation);
+			const ContactPoint *point = &constraint->points[pointIdx];
+			v3 hit = transformA->translation + point->rA;
+			DrawDebugArrow(hit, hit + constraint->normal * point->normalImpulse * 10.0f, {1,0,1});
 		}
+#endif
+	}
 
-		// Reset forces
-		rigidBody->totalForce = { 0, 0, 0 };
-		rigidBody->totalTorque = { 0, 0, 0 };
+	// Integrate position and orientation of the awake bodies
+	IntegrateRigidBodiesAVX2(motion, gameState->transforms.data,
+			GetRigidBodyTransformIndices(gameState), gameState->rigidBodies.count, deltaTime);
+
+	SolveContinuousCollisions(gameState, pairs);
+
+	WakeEntities(gameState, bodiesToWake);
+
+	UpdateIslands(gameState, islandParents, deltaTime);
 
-		f32 drag = 0.01f;
-		f32 angularDrag = 0.06f;
-		rigidBody->velocity -= rigidBody->velocity * deltaTime * drag;
-		rigidBody->angularVelocity -= rigidBody->angularVelocity * deltaTime * angularDrag;
+	if (gameState->deterministicPhysics || gameState->logPhysicsChecksum)
+	{
+		gameState->physicsChecksum = PhysicsChecksum(gameState);
+		if (gameState->logPhysicsChecksum)
+			Log("Physics step %u: checksum %016llx\n", step, gameState->physicsChecksum);
 	}
 
 #if DEBUG_BUILD
@@ -424,12 +1369,108 @@ void SimulatePhysics(GameState *gameState, f32 deltaTime)
 	{
 		for (u32 rigidBodyIdx = 0; rigidBodyIdx < gameState->rigidBodies.count; ++rigidBodyIdx)
 		{
-			RigidBody *rigidBody = &gameState->rigidBodies[rigidBodyIdx];
-
-			rigidBody->velocity = {};
-			rigidBody->angularVelocity = {};
+			V3SoASet(&motion->velocity, rigidBodyIdx, {});
+			V3SoASet(&motion->angularVelocity, rigidBodyIdx, {});
 		}
 		g_debugContext->resetMomentum = false;
 	}
 #endif
 }
+
+// Times integrating 4096 rigid bodies with their transforms spread over the transform array in
+// random order, like they end up in a level: the scalar per body loop with an axis-angle rotation
+// step, against the AVX2 kernel including gathering the poses and writing them back.
+void PhysicsBenchmarkIntegration()
+{
+	const u32 bodyCount = 4096;
+	const int runCount = 16;
+	const f32 deltaTime = 1.0f / 120.0f;
+
+	RigidBodyMotion motion;
+	RigidBodyMotionInit<FrameAllocator>(&motion);
+	RigidBodyMotion scalarMotion;
+	RigidBodyMotionInit<FrameAllocator>(&scalarMotion);
+	Transform *transforms = ALLOC_N(FrameAllocator, Transform, bodyCount);
+	Transform *scalarTransforms = ALLOC_N(FrameAllocator, Transform, bodyCount);
+	u32 *transformIndices = ALLOC_N(FrameAllocator, u32, bodyCount);
+	u32 seed = 0x9E3779B9;
+	for (u32 bodyIdx = 0; bodyIdx < bodyCount; ++bodyIdx)
+		transformIndices[bodyIdx] = bodyIdx;
+	for (u32 bodyIdx = bodyCount - 1; bodyIdx > 0; --bodyIdx)
+	{
+		u32 otherIdx = XorShift32(&seed) % (bodyIdx + 1);
+		u32 tmp = transformIndices[bodyIdx];
+		transformIndices[bodyIdx] = transformIndices[otherIdx];
+		transformIndices[otherIdx] = tmp;
+	}
+	for (u32 bodyIdx = 0; bodyIdx < bodyCount; ++bodyIdx)
+	{
+		v3 velocity = XorShift32V3Signed(&seed) * 4.0f;
+		v3 angularVelocity = XorShift32V3Signed(&seed) * 2.0f;
+		V3SoASet(&motion.velocity, bodyIdx, velocity);
+		V3SoASet(&motion.angularVelocity, bodyIdx, angularVelocity);
+		V3SoASet(&scalarMotion.velocity, bodyIdx, velocity);
+		V3SoASet(&scalarMotion.angularVelocity, bodyIdx, angularVelocity);
+
+		Transform *transform = &transforms[transformIndices[bodyIdx]];
+		*transform = TRANSFORM_IDENTITY;
+		transform->translation = XorShift32V3Signed(&seed) * 32.0f;
+		transform->rotation = QuaternionFromEulerZYX(XorShift32V3Signed(&seed) * PI);
+	}
+	memcpy(scalarTransforms, transforms, sizeof(Transform) * bodyCount);
+
+	const f64 frequency = (f64)PlatformGetPerformanceFrequency();
+
+	u64 start = PlatformGetPerformanceCounter();
+	for (int runIdx = 0; runIdx < runCount; ++runIdx)
+	{
+		for (u32 bodyIdx = 0; bodyIdx < bodyCount; ++bodyIdx)
+		{
+			Transform *transform = &scalarTransforms[transformIndices[bodyIdx]];
+			v3 velocity = V3SoAGet(&scalarMotion.velocity, bodyIdx);
+			v3 angularVelocity = V3SoAGet(&scalarMotion.angularVelocity, bodyIdx);
+			v3 pseudoVelocity = V3SoAGet(&scalarMotion.pseudoVelocity, bodyIdx);
+			v3 pseudoAngularVelocity = V3SoAGet(&scalarMotion.pseudoAngularVelocity, bodyIdx);
+			transform->translation += (velocity + pseudoVelocity) * deltaTime;
+			v3 deltaRot = (angularVelocity + pseudoAngularVelocity) * deltaTime;
+			if (deltaRot.x || deltaRot.y || deltaRot.z)
+			{
+				f32 angle = V3Length(deltaRot);
+				transform->rotation = QuaternionMultiply(
+						QuaternionFromAxisAngle(deltaRot / angle, angle), transform->rotation);
+				transform->rotation = V4Normalize(transform->rotation);
+			}
+			V3SoASet(&scalarMotion.pseudoVelocity, bodyIdx, {});
+			V3SoASet(&scalarMotion.pseudoAngularVelocity, bodyIdx, {});
+			V3SoASet(&scalarMotion.velocity, bodyIdx, velocity - velocity * deltaTime *
+					RIGID_BODY_DRAG);
+			V3SoASet(&scalarMotion.angularVelocity, bodyIdx, angularVelocity - angularVelocity *
+					deltaTime * RIGID_BODY_ANGULAR_DRAG);
+		}
+	}
+	f64 scalarTime = (PlatformGetPerformanceCounter() - start) / frequency / runCount;
+
+	start = PlatformGetPerformanceCounter();
+	for (int runIdx = 0; runIdx < runCount; ++runIdx)
+		IntegrateRigidBodiesAVX2(&motion, transforms, transformIndices, bodyCount, deltaTime);
+	f64 simdTime = (PlatformGetPerformanceCounter() - start) / frequency / runCount;
+
+	u32 mismatchCount = 0;
+	for (u32 bodyIdx = 0; bodyIdx < bodyCount; ++bodyIdx)
+	{
+		const f32 epsilon = 0.001f;
+		const u32 transformIdx = transformIndices[bodyIdx];
+		if (!V3EqualWithEpsilon(scalarTransforms[transformIdx].translation,
+					transforms[transformIdx].translation, epsilon) ||
+			!V3EqualWithEpsilon(V3SoAGet(&scalarMotion.angularVelocity, bodyIdx),
+					V3SoAGet(&motion.angularVelocity, bodyIdx), epsilon) ||
+			Abs(V4Dot(scalarTransforms[transformIdx].rotation, transforms[transformIdx].rotation)) <
+					1.0f - epsilon)
+			++mismatchCount;
+	}
+
+	Log("Integration, %u bodies: scalar %.3f ms, AVX2 with pose gather and write back %.3f ms "
+			"(%.2fx)\n", bodyCount, scalarTime * 1000.0, simdTime * 1000.0, scalarTime / simdTime);
+	if (mismatchCount)
+		Log("ERROR! AVX2 integration strayed from the scalar loop on %u bodies\n", mismatchCount);
+}
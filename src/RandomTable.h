@@ -525,3 +525,34 @@ inline f32 GetRandomF32()
 {
 	return GetRandom() / (f32)U32_MAX;
 }
+
+// xorshift32, for benchmarks that want the same values every run whatever else has drawn from the
+// table. The seed is the state, it can't be 0.
+inline u32 XorShift32(u32 *seed)
+{
+	*seed ^= *seed << 13;
+	*seed ^= *seed >> 17;
+	*seed ^= *seed << 5;
+	return *seed;
+}
+
+// In [0, 1)
+inline f32 XorShift32F32(u32 *seed)
+{
+	return (f32)(XorShift32(seed) & 0xFFFF) / 65536.0f;
+}
+
+// In [-1, 1)
+inline f32 XorShift32Signed(u32 *seed)
+{
+	return (f32)(XorShift32(seed) & 0xFFFF) / 32768.0f - 1.0f;
+}
+
+// Each component in [-1, 1), drawn x first.
+inline v3 XorShift32V3Signed(u32 *seed)
+{
+	f32 x = XorShift32Signed(seed);
+	f32 y = XorShift32Signed(seed);
+	f32 z = XorShift32Signed(seed);
+	return { x, y, z };
+}
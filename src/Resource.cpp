@@ -69,10 +69,10 @@ void ResourceLoadSkinnedMesh(Resource *resource, const u8 *fileBuffer, bool init
 		skinnedMesh->materialRes = nullptr;
 }
 
-void ResourceLoadLevelGeometryGrid(Resource *resource, const u8 *fileBuffer, bool initialize)
+bool ResourceLoadLevelGeometryGrid(Resource *resource, const u8 *fileBuffer, bool initialize)
 {
 	(void) initialize;
-	ReadTriangleGeometry(fileBuffer, &resource->geometryGrid);
+	return ReadTriangleGeometry(fileBuffer, &resource->geometryGrid);
 }
 
 void ResourceLoadCollisionMesh(Resource *resource, const u8 *fileBuffer, bool initialize)
@@ -29,6 +29,35 @@ struct ResourceSkinnedMesh
 	Animation *animations;
 };
 
+struct LevelBVHNode
+{
+	AABB aabb;
+	// Leaves: first block in bvhTriangleBlocks, the triangles take (triangleCount + 7) / 8 blocks
+	// from there. Inner nodes: the second child, the first one is the node right after this one.
+	u32 offset;
+	// 0 for inner nodes.
+	u32 triangleCount;
+};
+
+// Eight level triangles side by side for the ray kernels, corners are v0, v0 + edge1 and
+// v0 + edge2. Lanes past the end of a leaf are all zeros and never get hit. A block is six cache
+// lines and each array lines up with an AVX register, the kernels use aligned loads.
+struct alignas(64) LevelTriangleBlock
+{
+	f32 v0X[8];
+	f32 v0Y[8];
+	f32 v0Z[8];
+	f32 edge1X[8];
+	f32 edge1Y[8];
+	f32 edge1Z[8];
+	f32 edge2X[8];
+	f32 edge2Y[8];
+	f32 edge2Z[8];
+	f32 normalX[8];
+	f32 normalY[8];
+	f32 normalZ[8];
+};
+
 struct ResourceGeometryGrid
 {
 	v2 lowCorner;
@@ -37,7 +66,16 @@ struct ResourceGeometryGrid
 	u32 *offsets;
 	u32 positionCount;
 	v3 *positions;
-	IndexTriangle *triangles;
+	// Widened on load when the file has 16 bit indices.
+	IndexTriangle32 *triangles;
+
+	// Baked over the grid's triangles, each one once. Nodes are depth first from the root.
+	LevelBVHNode *bvhNodes;
+	u32 bvhNodeCount;
+	// Each leaf starts a block of its own.
+	LevelTriangleBlock *bvhTriangleBlocks;
+	u32 bvhTriangleBlockCount;
+	u32 bvhTriangleCount;
 };
 
 struct ResourceCollisionMesh
@@ -46,6 +84,30 @@ struct ResourceCollisionMesh
 	u32 positionCount;
 	IndexTriangle *triangleData;
 	u32 triangleCount;
+
+	// Hull neighbours of vertex i are adjacencyData[adjacencyOffsets[i]] up to
+	// adjacencyData[adjacencyOffsets[i + 1]].
+	u32 *adjacencyOffsets;
+	u16 *adjacencyData;
+	// Some vertex on the hull, to start hill climbing from when there's no better guess.
+	u32 hullStartVertex;
+
+	// Vertices of hull face i are hullFaceVertices[hullFaceOffsets[i]] up to
+	// hullFaceVertices[hullFaceOffsets[i + 1]], counter-clockwise seen from outside. Planes are the
+	// outward normal in xyz and the distance from the origin in w.
+	v4 *hullFacePlanes;
+	u32 *hullFaceOffsets;
+	u16 *hullFaceVertices;
+	u32 hullFaceCount;
+	HullEdge *hullEdges;
+	u32 hullEdgeCount;
+
+	// SoA copy of positionData for the AVX2 support scan, baked. paddedPositionCount is a multiple
+	// of 8, the extra entries repeat the first position.
+	f32 *positionsX;
+	f32 *positionsY;
+	f32 *positionsZ;
+	u32 paddedPositionCount;
 };
 
 struct ResourceShader
@@ -0,0 +1,541 @@
+const u32 SCENE_QUERIES_PER_JOB = 64;
+// Casts stop when the shape gets this close to what it hits.
+const f32 SCENE_QUERY_CAST_DISTANCE = 0.001f;
+
+// Keeps the hit in result if it's closer than what's there already.
+inline void RaycastCollider(const Collider *collider, const Transform *transform, v3 origin,
+		v3 direction, SceneQueryHit *result)
+{
+	v3 hit, hitNormal;
+	if (!RayColliderIntersection(origin, direction, true, transform, collider, &hit, &hitNormal))
+		return;
+
+	f32 distance = V3Dot(hit - origin, direction);
+	if (distance < 0 || distance > result->distance)
+		return;
+	result->hit = true;
+	result->entityHandle = collider->entityHandle;
+	result->distance = distance;
+	result->point = hit;
+	result->normal = hitNormal;
+}
+
+inline v3 RaycastLevelNormal(v3 triangleNormal, v3 direction)
+{
+	// Level triangles are hit from either side.
+	return V3Dot(triangleNormal, direction) > 0 ? -triangleNormal : triangleNormal;
+}
+
+// Closest hit among the given candidates, and the level if the query wants it. One ray at a time,
+// RaycastBatch gets the same hits with packets.
+SceneQueryHit RaycastCandidates(GameState *gameState, const RaycastQuery *query,
+		ArrayView<const u32> candidates)
+{
+	SceneQueryHit result = {};
+	result.distance = query->maxDistance;
+	for (u32 candidateIdx = 0; candidateIdx < candidates.count; ++candidateIdx)
+	{
+		u32 entityId = candidates[candidateIdx];
+		if (entityId == query->ignoreEntity.id)
+			continue;
+
+		const Collider *collider = &gameState->colliders[gameState->entityColliders[entityId]];
+		const Transform *transform = GetEntityTransform(gameState, collider->entityHandle);
+		RaycastCollider(collider, transform, query->origin, query->direction, &result);
+	}
+
+	if (query->hitLevel && gameState->levelGeometry.geometryGrid)
+	{
+		bool infinite = query->maxDistance == INFINITY;
+		v3 rayDir = infinite ? query->direction : query->direction * query->maxDistance;
+		v3 hit;
+		Triangle triangle;
+		if (HitTest(&gameState->levelGeometry.geometryGrid->geometryGrid, query->origin, rayDir,
+					infinite, &hit, &triangle))
+		{
+			f32 distance = V3Dot(hit - query->origin, query->direction);
+			if (distance <= result.distance)
+			{
+				result.hit = true;
+				result.entityHandle = ENTITY_HANDLE_INVALID;
+				result.distance = distance;
+				result.point = hit;
+				result.normal = RaycastLevelNormal(triangle.normal, query->direction);
+			}
+		}
+	}
+	return result;
+}
+
+// Queries go eight at a time through the AABB tree, convex hulls and the level. Other collider
+// types are tested one ray at a time.
+void RaycastBatch(GameState *gameState, ArrayView<const RaycastQuery> queries,
+		SceneQueryHit *outHits)
+{
+	ParallelFor(g_jobSystem, queries.count, SCENE_QUERIES_PER_JOB,
+			[gameState, queries, outHits](u32 beginIdx, u32 endIdx)
+	{
+		const AABBTree *tree = &gameState->broadphase.tree;
+		DynamicArray<AABBTreeRayPacketLeaf, FrameAllocator> leaves;
+		DynamicArrayInit(&leaves, 64);
+		for (u32 packetBegin = beginIdx; packetBegin < endIdx; packetBegin += 8)
+		{
+			const RaycastQuery *packetQueries = &queries[packetBegin];
+			SceneQueryHit *hits = &outHits[packetBegin];
+			const u32 laneCount = Min(8u, endIdx - packetBegin);
+
+			RayPacket packet;
+			u32 levelMask = 0;
+			for (u32 lane = 0; lane < 8; ++lane)
+			{
+				bool used = lane < laneCount;
+				v3 origin = used ? packetQueries[lane].origin : v3{};
+				v3 direction = used ? packetQueries[lane].direction : v3{ 1, 1, 1 };
+				packet.originX[lane] = origin.x;
+				packet.originY[lane] = origin.y;
+				packet.originZ[lane] = origin.z;
+				packet.dirX[lane] = direction.x;
+				packet.dirY[lane] = direction.y;
+				packet.dirZ[lane] = direction.z;
+				packet.maxT[lane] = used ? packetQueries[lane].maxDistance : -1.0f;
+				if (used)
+				{
+					hits[lane] = {};
+					hits[lane].distance = packetQueries[lane].maxDistance;
+					if (packetQueries[lane].hitLevel)
+						levelMask |= 1 << lane;
+				}
+			}
+
+			leaves.count = 0;
+			AABBTreeQueryRayPacket(tree, &packet, &leaves);
+			for (u32 leafIdx = 0; leafIdx < leaves.count; ++leafIdx)
+			{
+				u32 entityId = leaves[leafIdx].entityId;
+				u32 laneMask = leaves[leafIdx].laneMask;
+				for (u32 lane = 0; lane < laneCount; ++lane)
+					if (packetQueries[lane].ignoreEntity.id == entityId)
+						laneMask &= ~(1 << lane);
+
+				const Collider *collider = &gameState->colliders[gameState->entityColliders[entityId]];
+				const Transform *transform = GetEntityTransform(gameState, collider->entityHandle);
+				if (collider->type == COLLIDER_CONVEX_HULL)
+				{
+					v3 normals[8];
+					u32 hitMask = RayPacketConvexHull(&packet, laneMask, transform, collider, normals);
+					for (u32 lane = 0; lane < laneCount; ++lane)
+					{
+						if (!(hitMask & (1 << lane)))
+							continue;
+						const RaycastQuery *query = &packetQueries[lane];
+						hits[lane].hit = true;
+						hits[lane].entityHandle = collider->entityHandle;
+						hits[lane].distance = packet.maxT[lane];
+						hits[lane].point = query->origin + query->direction * packet.maxT[lane];
+						hits[lane].normal = normals[lane];
+					}
+					continue;
+				}
+
+				for (u32 lane = 0; lane < laneCount; ++lane)
+				{
+					if (!(laneMask & (1 << lane)))
+						continue;
+					RaycastCollider(collider, transform, packetQueries[lane].origin,
+							packetQueries[lane].direction, &hits[lane]);
+					packet.maxT[lane] = hits[lane].distance;
+				}
+			}
+
+			if (levelMask && gameState->levelGeometry.geometryGrid)
+			{
+				for (u32 lane = 0; lane < 8; ++lane)
+					if (!(levelMask & (1 << lane)))
+						packet.maxT[lane] = -1.0f;
+				u32 triangleIndices[8];
+				const ResourceGeometryGrid *geometryGrid =
+					&gameState->levelGeometry.geometryGrid->geometryGrid;
+				HitTestPacket(geometryGrid, &packet, triangleIndices);
+				for (u32 lane = 0; lane < laneCount; ++lane)
+				{
+					if (triangleIndices[lane] == U32_MAX)
+						continue;
+					const RaycastQuery *query = &packetQueries[lane];
+					hits[lane].hit = true;
+					hits[lane].entityHandle = ENTITY_HANDLE_INVALID;
+					hits[lane].distance = packet.maxT[lane];
+					hits[lane].point = query->origin + query->direction * packet.maxT[lane];
+					hits[lane].normal = RaycastLevelNormal(
+							LevelGetTriangle(geometryGrid, triangleIndices[lane]).normal, query->direction);
+				}
+			}
+		}
+	});
+}
+
+struct ShapeCastCandidate
+{
+	f32 entryDistance;
+	u32 entityId;
+};
+
+// Sweeps the shape against each candidate, by conservative advancement on GJK support points.
+// Candidates go nearest first, by where the cast enters their AABB grown by the shape's, so the
+// sweeping can stop as soon as the next one starts further than the closest hit so far.
+// sorted is scratch space, so it can be reused between queries.
+SceneQueryHit ShapeCastCandidates(GameState *gameState, const ShapeCastQuery *query,
+		ArrayView<const u32> candidates, DynamicArray<ShapeCastCandidate, FrameAllocator> *sorted)
+{
+	SceneQueryHit result = {};
+	result.distance = query->maxDistance;
+
+	Collider shape = query->shape;
+	ColliderSweep sweep;
+	sweep.start = query->start;
+	sweep.end = query->start;
+	sweep.end.translation += query->direction * query->maxDistance;
+
+	AABB shapeAABB;
+	GetAABB(&sweep.start, &shape, &shapeAABB.min, &shapeAABB.max);
+	v3 shapeMin = shapeAABB.min - sweep.start.translation;
+	v3 shapeMax = shapeAABB.max - sweep.start.translation;
+	v3 invDirection = { 1.0f / query->direction.x, 1.0f / query->direction.y,
+		1.0f / query->direction.z };
+
+	sorted->count = 0;
+	for (u32 candidateIdx = 0; candidateIdx < candidates.count; ++candidateIdx)
+	{
+		u32 entityId = candidates[candidateIdx];
+		if (entityId == query->ignoreEntity.id)
+			continue;
+
+		Collider *collider = &gameState->colliders[gameState->entityColliders[entityId]];
+		AABB aabb;
+		GetAABB(GetEntityTransform(gameState, collider->entityHandle), collider, &aabb.min, &aabb.max);
+		aabb.min -= shapeMax;
+		aabb.max -= shapeMin;
+
+		// Slab test of the cast's center against the grown AABB.
+		f32 tMin = 0;
+		f32 tMax = query->maxDistance;
+		for (int i = 0; i < 3; ++i)
+		{
+			f32 t0 = (aabb.min.v[i] - sweep.start.translation.v[i]) * invDirection.v[i];
+			f32 t1 = (aabb.max.v[i] - sweep.start.translation.v[i]) * invDirection.v[i];
+			tMin = Max(tMin, Min(t0, t1));
+			tMax = Min(tMax, Max(t0, t1));
+		}
+		if (tMin > tMax)
+			continue;
+
+		// Insertion sort, there are only a handful.
+		DynamicArrayAdd(sorted);
+		u64 insertIdx = sorted->count - 1;
+		for (; insertIdx > 0 && (*sorted)[insertIdx - 1].entryDistance > tMin; --insertIdx)
+			(*sorted)[insertIdx] = (*sorted)[insertIdx - 1];
+		(*sorted)[insertIdx] = { tMin, entityId };
+	}
+
+	for (u32 sortedIdx = 0; sortedIdx < sorted->count; ++sortedIdx)
+	{
+		if ((*sorted)[sortedIdx].entryDistance > result.distance)
+			break;
+
+		u32 entityId = (*sorted)[sortedIdx].entityId;
+		Collider *collider = &gameState->colliders[gameState->entityColliders[entityId]];
+		ColliderSweep target;
+		target.start = *GetEntityTransform(gameState, collider->entityHandle);
+		target.end = target.start;
+		TimeOfImpactResult toi = TimeOfImpact(&shape, collider, &sweep, &target,
+				SCENE_QUERY_CAST_DISTANCE);
+		if (!toi.hit)
+			continue;
+
+		f32 distance = toi.t * query->maxDistance;
+		if (distance > result.distance || (result.hit && distance == result.distance))
+			continue;
+		result.hit = true;
+		result.entityHandle = collider->entityHandle;
+		result.distance = distance;
+
+		Transform shapeTransform = ColliderSweepAt(&sweep, toi.t);
+		// Touching from the start, or out of iterations: there's no separating direction to use.
+		if (toi.iterations == 0 || V3SqrLen(toi.normal) == 0)
+		{
+			result.normal = -query->direction;
+			result.point = shapeTransform.translation;
+		}
+		else
+		{
+			result.normal = toi.normal;
+			result.point = FurthestInDirection(&shapeTransform, &shape, -toi.normal);
+		}
+	}
+	return result;
+}
+
+void ShapeCastBatch(GameState *gameState, ArrayView<const ShapeCastQuery> queries,
+		SceneQueryHit *outHits)
+{
+	ParallelFor(g_jobSystem, queries.count, SCENE_QUERIES_PER_JOB,
+			[gameState, queries, outHits](u32 beginIdx, u32 endIdx)
+	{
+		const AABBTree *tree = &gameState->broadphase.tree;
+		DynamicArray<u32, FrameAllocator> candidates;
+		DynamicArrayInit(&candidates, 32);
+		DynamicArray<ShapeCastCandidate, FrameAllocator> sorted;
+		DynamicArrayInit(&sorted, 32);
+		for (u32 queryIdx = beginIdx; queryIdx < endIdx; ++queryIdx)
+		{
+			const ShapeCastQuery *query = &queries[queryIdx];
+			Collider shape = query->shape;
+			Transform start = query->start;
+			Transform end = start;
+			end.translation += query->direction * query->maxDistance;
+			AABB startAABB, endAABB;
+			GetAABB(&start, &shape, &startAABB.min, &startAABB.max);
+			GetAABB(&end, &shape, &endAABB.min, &endAABB.max);
+
+			candidates.count = 0;
+			AABBTreeQueryAABB(tree, AABBUnion(startAABB, endAABB), &candidates);
+			outHits[queryIdx] = ShapeCastCandidates(gameState, query, candidates, &sorted);
+		}
+	});
+}
+
+u32 OverlapCandidates(GameState *gameState, const OverlapQuery *query,
+		ArrayView<const u32> candidates, EntityHandle *outEntities, u32 maxHits)
+{
+	Collider shape = query->shape;
+	Transform transform = query->transform;
+	u32 hitCount = 0;
+	for (u32 candidateIdx = 0; candidateIdx < candidates.count && hitCount < maxHits;
+			++candidateIdx)
+	{
+		u32 entityId = candidates[candidateIdx];
+		if (entityId == query->ignoreEntity.id)
+			continue;
+
+		Collider *collider = &gameState->colliders[gameState->entityColliders[entityId]];
+		Transform *colliderTransform = GetEntityTransform(gameState, collider->entityHandle);
+		u32 hullVertexA = U32_MAX;
+		u32 hullVertexB = U32_MAX;
+		GJKResult gjkResult = GJKTest(&transform, colliderTransform, &shape, collider, nullptr,
+				&hullVertexA, &hullVertexB);
+		if (gjkResult.hit)
+			outEntities[hitCount++] = collider->entityHandle;
+	}
+	return hitCount;
+}
+
+void OverlapBatch(GameState *gameState, ArrayView<const OverlapQuery> queries, u32 maxHitsPerQuery,
+		EntityHandle *outEntities, u32 *outHitCounts)
+{
+	ParallelFor(g_jobSystem, queries.count, SCENE_QUERIES_PER_JOB,
+			[gameState, queries, maxHitsPerQuery, outEntities, outHitCounts](u32 beginIdx,
+				u32 endIdx)
+	{
+		const AABBTree *tree = &gameState->broadphase.tree;
+		DynamicArray<u32, FrameAllocator> candidates;
+		DynamicArrayInit(&candidates, 32);
+		for (u32 queryIdx = beginIdx; queryIdx < endIdx; ++queryIdx)
+		{
+			const OverlapQuery *query = &queries[queryIdx];
+			Collider shape = query->shape;
+			Transform transform = query->transform;
+			AABB aabb;
+			GetAABB(&transform, &shape, &aabb.min, &aabb.max);
+
+			candidates.count = 0;
+			AABBTreeQueryAABB(tree, aabb, &candidates);
+			outHitCounts[queryIdx] = OverlapCandidates(gameState, query, candidates,
+					&outEntities[queryIdx * maxHitsPerQuery], maxHitsPerQuery);
+		}
+	});
+}
+
+SceneQueryHit Raycast(GameState *gameState, v3 origin, v3 direction, f32 maxDistance,
+		EntityHandle ignoreEntity, bool hitLevel)
+{
+	RaycastQuery query = { origin, direction, maxDistance, ignoreEntity, hitLevel };
+	SceneQueryHit result;
+	RaycastBatch(gameState, { &query, 1 }, &result);
+	return result;
+}
+
+SceneQueryHit SphereCast(GameState *gameState, v3 origin, f32 radius, v3 direction,
+		f32 maxDistance, EntityHandle ignoreEntity)
+{
+	ShapeCastQuery query = {};
+	query.shape.type = COLLIDER_SPHERE;
+	query.shape.sphere.radius = radius;
+	query.start.translation = origin;
+	query.direction = direction;
+	query.maxDistance = maxDistance;
+	query.ignoreEntity = ignoreEntity;
+	SceneQueryHit result;
+	ShapeCastBatch(gameState, { &query, 1 }, &result);
+	return result;
+}
+
+u32 OverlapBox(GameState *gameState, v3 center, f32 halfSize, v4 rotation,
+		EntityHandle *outEntities, u32 maxHits, EntityHandle ignoreEntity)
+{
+	OverlapQuery query = {};
+	query.shape.type = COLLIDER_CUBE;
+	query.shape.cube.radius = halfSize;
+	query.transform.translation = center;
+	query.transform.rotation = rotation;
+	query.ignoreEntity = ignoreEntity;
+	u32 hitCount;
+	OverlapBatch(gameState, { &query, 1 }, maxHits, outEntities, &hitCount);
+	return hitCount;
+}
+
+u32 OverlapSphere(GameState *gameState, v3 center, f32 radius, EntityHandle *outEntities,
+		u32 maxHits, EntityHandle ignoreEntity)
+{
+	OverlapQuery query = {};
+	query.shape.type = COLLIDER_SPHERE;
+	query.shape.sphere.radius = radius;
+	query.transform.translation = center;
+	query.ignoreEntity = ignoreEntity;
+	u32 hitCount;
+	OverlapBatch(gameState, { &query, 1 }, maxHits, outEntities, &hitCount);
+	return hitCount;
+}
+
+// Casts rays, spheres and overlap spheres around the scene, batched and one by one against every
+// collider, logs the times and checks both agree.
+void SceneQueryBenchmark(GameState *gameState)
+{
+	const u32 queryCount = 4096;
+	const u32 maxOverlaps = 16;
+	const f64 frequency = (f64)PlatformGetPerformanceFrequency();
+	u32 seed = 0x9E3779B9;
+
+	// Everything the brute force versions test against.
+	const u32 colliderCount = gameState->colliders.count;
+	u32 *allColliders = ALLOC_N(FrameAllocator, u32, colliderCount);
+	for (u32 colliderIdx = 0; colliderIdx < colliderCount; ++colliderIdx)
+		allColliders[colliderIdx] = gameState->colliders[colliderIdx].entityHandle.id;
+	ArrayView<const u32> everything = { allColliders, colliderCount };
+
+	RaycastQuery *rays = ALLOC_N(FrameAllocator, RaycastQuery, queryCount);
+	ShapeCastQuery *casts = ALLOC_N(FrameAllocator, ShapeCastQuery, queryCount);
+	OverlapQuery *overlaps = ALLOC_N(FrameAllocator, OverlapQuery, queryCount);
+	for (u32 queryIdx = 0; queryIdx < queryCount; ++queryIdx)
+	{
+		v3 origin = { XorShift32Signed(&seed) * 16.0f, XorShift32Signed(&seed) * 20.0f,
+			6.0f + XorShift32Signed(&seed) * 4.0f };
+		v3 direction = V3Normalize({ XorShift32Signed(&seed) * 0.5f, XorShift32Signed(&seed) * 0.5f,
+				-1.0f });
+		rays[queryIdx] = { origin, direction, 20.0f, ENTITY_HANDLE_INVALID, true };
+
+		casts[queryIdx] = {};
+		casts[queryIdx].shape.type = COLLIDER_SPHERE;
+		casts[queryIdx].shape.sphere.radius = 0.2f;
+		casts[queryIdx].start.translation = origin;
+		casts[queryIdx].direction = direction;
+		casts[queryIdx].maxDistance = 20.0f;
+		casts[queryIdx].ignoreEntity = ENTITY_HANDLE_INVALID;
+
+		overlaps[queryIdx] = {};
+		overlaps[queryIdx].shape.type = COLLIDER_SPHERE;
+		overlaps[queryIdx].shape.sphere.radius = 0.75f;
+		overlaps[queryIdx].transform.translation = { origin.x, origin.y,
+			0.5f + XorShift32Signed(&seed) * 2.0f };
+		overlaps[queryIdx].ignoreEntity = ENTITY_HANDLE_INVALID;
+	}
+
+	SceneQueryHit *batchHits = ALLOC_N(FrameAllocator, SceneQueryHit, queryCount);
+	SceneQueryHit *bruteHits = ALLOC_N(FrameAllocator, SceneQueryHit, queryCount);
+	EntityHandle *batchOverlaps = ALLOC_N(FrameAllocator, EntityHandle, queryCount * maxOverlaps);
+	EntityHandle *bruteOverlaps = ALLOC_N(FrameAllocator, EntityHandle, queryCount * maxOverlaps);
+	u32 *batchOverlapCounts = ALLOC_N(FrameAllocator, u32, queryCount);
+	u32 *bruteOverlapCounts = ALLOC_N(FrameAllocator, u32, queryCount);
+
+	auto hitsDiffer = [](const SceneQueryHit *a, const SceneQueryHit *b)
+	{
+		if (a->hit != b->hit)
+			return true;
+		return a->hit && Abs(a->distance - b->distance) > 0.001f;
+	};
+
+	// Rays
+	u64 start = PlatformGetPerformanceCounter();
+	RaycastBatch(gameState, { rays, queryCount }, batchHits);
+	u64 batchTicks = PlatformGetPerformanceCounter() - start;
+	start = PlatformGetPerformanceCounter();
+	for (u32 queryIdx = 0; queryIdx < queryCount; ++queryIdx)
+		bruteHits[queryIdx] = RaycastCandidates(gameState, &rays[queryIdx], everything);
+	u64 bruteTicks = PlatformGetPerformanceCounter() - start;
+	u32 hitCount = 0;
+	u32 mismatchCount = 0;
+	for (u32 queryIdx = 0; queryIdx < queryCount; ++queryIdx)
+	{
+		hitCount += batchHits[queryIdx].hit;
+		mismatchCount += hitsDiffer(&batchHits[queryIdx], &bruteHits[queryIdx]);
+	}
+	Log("Scene queries, %u rays (%u hit): batch %.3f ms, one by one against everything %.3f ms\n",
+			queryCount, hitCount, batchTicks * 1000.0 / frequency, bruteTicks * 1000.0 / frequency);
+	if (mismatchCount)
+		Log("ERROR! Scene queries: %u rays disagree with brute force\n", mismatchCount);
+
+	// Sphere casts
+	start = PlatformGetPerformanceCounter();
+	ShapeCastBatch(gameState, { casts, queryCount }, batchHits);
+	batchTicks = PlatformGetPerformanceCounter() - start;
+	DynamicArray<ShapeCastCandidate, FrameAllocator> sorted;
+	DynamicArrayInit(&sorted, colliderCount);
+	start = PlatformGetPerformanceCounter();
+	for (u32 queryIdx = 0; queryIdx < queryCount; ++queryIdx)
+		bruteHits[queryIdx] = ShapeCastCandidates(gameState, &casts[queryIdx], everything, &sorted);
+	bruteTicks = PlatformGetPerformanceCounter() - start;
+	hitCount = 0;
+	mismatchCount = 0;
+	for (u32 queryIdx = 0; queryIdx < queryCount; ++queryIdx)
+	{
+		hitCount += batchHits[queryIdx].hit;
+		mismatchCount += hitsDiffer(&batchHits[queryIdx], &bruteHits[queryIdx]);
+	}
+	Log("Scene queries, %u sphere casts (%u hit): batch %.3f ms, one by one against everything "
+			"%.3f ms\n", queryCount, hitCount, batchTicks * 1000.0 / frequency,
+			bruteTicks * 1000.0 / frequency);
+	if (mismatchCount)
+		Log("ERROR! Scene queries: %u sphere casts disagree with brute force\n", mismatchCount);
+
+	// Overlaps
+	start = PlatformGetPerformanceCounter();
+	OverlapBatch(gameState, { overlaps, queryCount }, maxOverlaps, batchOverlaps,
+			batchOverlapCounts);
+	batchTicks = PlatformGetPerformanceCounter() - start;
+	start = PlatformGetPerformanceCounter();
+	for (u32 queryIdx = 0; queryIdx < queryCount; ++queryIdx)
+		bruteOverlapCounts[queryIdx] = OverlapCandidates(gameState, &overlaps[queryIdx],
+				everything, &bruteOverlaps[queryIdx * maxOverlaps], maxOverlaps);
+	bruteTicks = PlatformGetPerformanceCounter() - start;
+	u32 totalOverlaps = 0;
+	mismatchCount = 0;
+	for (u32 queryIdx = 0; queryIdx < queryCount; ++queryIdx)
+	{
+		// Same entities, maybe in another order.
+		u32 count = batchOverlapCounts[queryIdx];
+		totalOverlaps += count;
+		bool mismatch = count != bruteOverlapCounts[queryIdx];
+		for (u32 hitIdx = 0; hitIdx < count && !mismatch; ++hitIdx)
+		{
+			EntityHandle entity = batchOverlaps[queryIdx * maxOverlaps + hitIdx];
+			bool found = false;
+			for (u32 otherIdx = 0; otherIdx < count; ++otherIdx)
+				found = found || bruteOverlaps[queryIdx * maxOverlaps + otherIdx] == entity;
+			mismatch = !found;
+		}
+		mismatchCount += mismatch;
+	}
+	Log("Scene queries, %u sphere overlaps (%u overlaps): batch %.3f ms, one by one against "
+			"everything %.3f ms\n", queryCount, totalOverlaps, batchTicks * 1000.0 / frequency,
+			bruteTicks * 1000.0 / frequency);
+	if (mismatchCount)
+		Log("ERROR! Scene queries: %u overlaps disagree with brute force\n", mismatchCount);
+}
@@ -0,0 +1,67 @@
+// Queries against the colliders in the scene: raycasts, shape casts and overlap tests. Candidates
+// come from the broadphase AABB tree, which gets brought up to date after physics every frame.
+// Batches take an array of queries and write to arrays the caller provides (usually frame
+// allocated), one entry per query, and are spread over the job system.
+
+struct RaycastQuery
+{
+	v3 origin;
+	// Normalized.
+	v3 direction;
+	f32 maxDistance;
+	// Left out of the query, for example whoever is casting it. Can be ENTITY_HANDLE_INVALID.
+	EntityHandle ignoreEntity;
+	// Also test the level geometry. Hits on it have no entity.
+	bool hitLevel;
+};
+
+struct ShapeCastQuery
+{
+	// Only the shape is used, its entity handle is ignored.
+	Collider shape;
+	Transform start;
+	// Normalized. The shape moves without turning.
+	v3 direction;
+	f32 maxDistance;
+	EntityHandle ignoreEntity;
+};
+
+struct OverlapQuery
+{
+	Collider shape;
+	Transform transform;
+	EntityHandle ignoreEntity;
+};
+
+// Closest hit of a ray or cast.
+struct SceneQueryHit
+{
+	bool hit;
+	EntityHandle entityHandle;
+	// Along the direction, from the origin or start. 0 for casts that start out touching something.
+	f32 distance;
+	v3 point;
+	// Out of the surface that was hit.
+	v3 normal;
+};
+
+void RaycastBatch(GameState *gameState, ArrayView<const RaycastQuery> queries,
+		SceneQueryHit *outHits);
+void ShapeCastBatch(GameState *gameState, ArrayView<const ShapeCastQuery> queries,
+		SceneQueryHit *outHits);
+// Query queryIdx gets the maxHitsPerQuery entries of outEntities from queryIdx * maxHitsPerQuery,
+// and how many it used in outHitCounts[queryIdx]. Overlaps past that are dropped.
+void OverlapBatch(GameState *gameState, ArrayView<const OverlapQuery> queries, u32 maxHitsPerQuery,
+		EntityHandle *outEntities, u32 *outHitCounts);
+
+SceneQueryHit Raycast(GameState *gameState, v3 origin, v3 direction, f32 maxDistance,
+		EntityHandle ignoreEntity = ENTITY_HANDLE_INVALID, bool hitLevel = false);
+SceneQueryHit SphereCast(GameState *gameState, v3 origin, f32 radius, v3 direction,
+		f32 maxDistance, EntityHandle ignoreEntity = ENTITY_HANDLE_INVALID);
+// Boxes are cubes here, like cube colliders.
+u32 OverlapBox(GameState *gameState, v3 center, f32 halfSize, v4 rotation,
+		EntityHandle *outEntities, u32 maxHits, EntityHandle ignoreEntity = ENTITY_HANDLE_INVALID);
+u32 OverlapSphere(GameState *gameState, v3 center, f32 radius, EntityHandle *outEntities,
+		u32 maxHits, EntityHandle ignoreEntity = ENTITY_HANDLE_INVALID);
+
+void SceneQueryBenchmark(GameState *gameState);
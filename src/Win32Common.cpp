@@ -1,4 +1,6 @@
 HANDLE g_hStdout;
+// Jobs can log from worker threads.
+volatile u32 g_logLock;
 
 typedef HANDLE FileHandle;
 
@@ -10,6 +12,8 @@ void Log(const char *format, ...)
 	va_list args;
 	va_start(args, format);
 
+	SpinlockLock(&g_logLock);
+
 	StringCbVPrintfA(buffer, sizeof(buffer), format, args);
 	OutputDebugStringA(buffer);
 
@@ -22,6 +26,8 @@ void Log(const char *format, ...)
 	g_imguiLogBuffer->appendfv(format, args);
 #endif
 
+	SpinlockUnlock(&g_logLock);
+
 	va_end(args);
 }
 
@@ -186,3 +192,81 @@ bool PlatformCanReadMemory(const void *ptr)
 
 	return true;
 }
+
+u64 PlatformGetPerformanceCounter()
+{
+	LARGE_INTEGER largeInteger;
+	QueryPerformanceCounter(&largeInteger);
+	return largeInteger.QuadPart;
+}
+
+u64 PlatformGetPerformanceFrequency()
+{
+	LARGE_INTEGER largeInteger;
+	QueryPerformanceFrequency(&largeInteger);
+	return largeInteger.QuadPart;
+}
+
+u32 PlatformGetProcessorCount()
+{
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo(&systemInfo);
+	return (u32)systemInfo.dwNumberOfProcessors;
+}
+
+typedef void (*PlatformThreadProc)(void *args);
+
+struct Win32ThreadStart
+{
+	PlatformThreadProc proc;
+	void *args;
+	volatile u32 started;
+};
+
+DWORD WINAPI Win32ThreadEntry(LPVOID param)
+{
+	Win32ThreadStart *start = (Win32ThreadStart *)param;
+	PlatformThreadProc proc = start->proc;
+	void *args = start->args;
+	// start lives on the creating thread's stack, don't touch it after this.
+	AtomicIncrementGetNew(&start->started);
+
+	proc(args);
+	return 0;
+}
+
+// Returns once the new thread is running. Threads exit when proc returns.
+void PlatformCreateThread(PlatformThreadProc proc, void *args)
+{
+	Win32ThreadStart start = { proc, args, 0 };
+	HANDLE thread = CreateThread(nullptr, 0, Win32ThreadEntry, &start, 0, nullptr);
+	ASSERT(thread);
+	CloseHandle(thread);
+
+	while (!start.started)
+		_mm_pause();
+}
+
+typedef HANDLE PlatformSemaphore;
+
+PlatformSemaphore PlatformCreateSemaphore()
+{
+	HANDLE semaphore = CreateSemaphoreA(nullptr, 0, S32_MAX, nullptr);
+	ASSERT(semaphore);
+	return semaphore;
+}
+
+void PlatformDestroySemaphore(PlatformSemaphore semaphore)
+{
+	CloseHandle(semaphore);
+}
+
+void PlatformWaitOnSemaphore(PlatformSemaphore semaphore)
+{
+	WaitForSingleObject(semaphore, INFINITE);
+}
+
+void PlatformSignalSemaphore(PlatformSemaphore semaphore, u32 count)
+{
+	ReleaseSemaphore(semaphore, (LONG)count, nullptr);
+}
@@ -76,7 +76,15 @@ const Resource *LoadResource(ResourceType type, const char *filename)
 	if (error == ERROR_SUCCESS)
 	{
 		newResource->type = type;
-		GameResourcePostLoad(newResource, fileBuffer, true);
+		if (!GameResourcePostLoad(newResource, fileBuffer, true))
+		{
+			// Don't leave a half loaded resource where GetResource can find it.
+			Log("ERROR! Couldn't load resource %s\n", filename);
+			ASSERT(newResource == &g_resourceBank->resources[g_resourceBank->resources.count - 1]);
+			--g_resourceBank->resources.count;
+			--g_resourceBank->lastWriteTimes.count;
+			newResource = nullptr;
+		}
 	}
 
 	StackAllocator::Free(oldStackPtr);